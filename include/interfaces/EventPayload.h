@@ -0,0 +1,108 @@
+#ifndef EVENTPAYLOAD_H
+#define EVENTPAYLOAD_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+
+/**
+ * @class EventPayload
+ * @brief Immutable, reference-counted event payload of any type.
+ * @details Copying a payload only bumps a reference count, so one allocation is shared by the
+ * queue, every mailbox and every subscriber of an event. The value itself is never copied.
+ * Short strings are the exception: they are stored inline, because copying a few bytes is cheaper
+ * than allocating and reference counting them.
+ */
+class EventPayload {
+public:
+    /**
+     * @brief Creates an empty payload.
+     */
+    EventPayload() = default;
+
+    /**
+     * @brief Wraps a shared value; the payload keeps a reference to it.
+     */
+    template<typename T>
+    explicit EventPayload(std::shared_ptr<const T> value)
+        : data(std::move(value)), type(data ? &typeid(T) : nullptr) {}
+
+    /**
+     * @brief Creates a string payload, as used by the string-based IEventService API.
+     */
+    static EventPayload FromString(const std::string& value) {
+        if (value.size() > kInlineStringSize) {
+            return EventPayload(std::make_shared<const std::string>(value));
+        }
+        EventPayload payload;
+        payload.inlineString = value;
+        payload.type = &typeid(std::string);
+        return payload;
+    }
+
+    /**
+     * @brief True if the payload holds a value of type T.
+     */
+    template<typename T>
+    bool Is() const {
+        return type != nullptr && *type == typeid(T);
+    }
+
+    /**
+     * @brief Returns the value if it is of type T, nullptr otherwise.
+     */
+    template<typename T>
+    const T* Get() const {
+        if (!Is<T>()) {
+            return nullptr;
+        }
+        if constexpr (std::is_same<T, std::string>::value) {
+            if (!data) {
+                return &inlineString;
+            }
+        }
+        return static_cast<const T*>(data.get());
+    }
+
+    /**
+     * @brief Returns a shared reference to the value if it is of type T, nullptr otherwise.
+     */
+    template<typename T>
+    std::shared_ptr<const T> As() const {
+        if (!Is<T>()) {
+            return nullptr;
+        }
+        if constexpr (std::is_same<T, std::string>::value) {
+            if (!data) {
+                return std::make_shared<const std::string>(inlineString);
+            }
+        }
+        return std::shared_ptr<const T>(data, static_cast<const T*>(data.get()));
+    }
+
+    bool Empty() const { return type == nullptr; }
+
+    /**
+     * @brief Correlation id of a request published with IEventService::Request(), 0 for plain events.
+     * @details Responders pass the request payload to IEventService::Respond() to answer it.
+     */
+    uint64_t RequestId() const { return requestId; }
+
+    /**
+     * @brief Set by IEventService::Request(); not meant to be called by plugins.
+     */
+    void SetRequestId(uint64_t id) { requestId = id; }
+
+    // Strings up to this size fit the small-string buffer of common standard libraries
+    static constexpr size_t kInlineStringSize = 15;
+
+private:
+    std::shared_ptr<const void> data;
+    const std::type_info* type = nullptr;
+    std::string inlineString;
+    uint64_t requestId = 0;
+};
+
+#endif // EVENTPAYLOAD_H
@@ -1,12 +1,40 @@
 #ifndef ICONFIGSERVICE_H
 #define ICONFIGSERVICE_H
 
+#include <cstdint>
 #include <string>
+#include "ThreadPolicy.h"
 
+/**
+ * @class IConfigService
+ * @brief Flat key=value settings, read from a file and overridable at runtime.
+ */
 class IConfigService {
 public:
     virtual ~IConfigService() = default;
+
+    /**
+     * @brief Reads "key = value" lines; '#' starts a comment. Later values replace earlier ones.
+     */
     virtual void LoadConfig(const std::string& filename) = 0;
+
+    virtual void Set(const std::string& key, const std::string& value) = 0;
+    virtual bool Has(const std::string& key) const = 0;
+    virtual std::string GetString(const std::string& key, const std::string& defaultValue) const = 0;
+
+    // defaultValue also if the value is not a number
+    virtual int64_t GetInt(const std::string& key, int64_t defaultValue) const = 0;
+
+    /**
+     * @brief Thread policy of a core service or plugin.
+     * @details Read from thread.<component>.<setting>, falling back to thread.default.<setting>:
+     * stack_size (bytes, k or m suffix), cpus ("2,3" or "0-3"), nice, realtime_priority, name.
+     * Core services are logger, event, timer, executor, long_running, frame and watchdog; plugins go by name.
+     */
+    virtual ThreadPolicy GetThreadPolicy(const std::string& component) const = 0;
+
+    // Whether any thread.<component>.<setting> is set, not counting thread.default
+    virtual bool HasThreadPolicy(const std::string& component) const = 0;
 };
 
 #endif // ICONFIGSERVICE_H
@@ -1,11 +1,141 @@
 #ifndef IEVENTSERVICE_H
 #define IEVENTSERVICE_H
 
+#include "EventPayload.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <future>
+#include <memory>
+#include <stdexcept>
 #include <unordered_map>
 #include <vector>
 #include <string>
 
+class IEventMailbox;
+
+/**
+ * @enum EventPriority
+ * @brief Dispatch lane of a topic.
+ * @details Control events are always dispatched before anything else. Normal and bulk events
+ * share the remaining capacity with a fixed weight in favour of normal events, so high-rate
+ * telemetry published as bulk can never delay playback control.
+ */
+enum class EventPriority : std::uint8_t {
+    Control = 0,
+    Normal = 1,
+    Bulk = 2
+};
+
+constexpr std::size_t kEventPriorityCount = 3;
+
+/**
+ * @enum DeliveryPolicy
+ * @brief What Trigger() does when a topic already has its maximum number of events queued.
+ */
+enum class DeliveryPolicy : std::uint8_t {
+    Block = 0,          // Wait until the dispatcher catches up (the default)
+    DropNewest = 1,     // Discard the event being triggered
+    DropOldest = 2,     // Replace the oldest queued event of the topic; never waits
+    CoalesceLatest = 3  // Keep only the newest payload; at most one event of the topic is queued
+};
+
+/**
+ * @enum MailboxDelivery
+ * @brief What IEventMailbox::Deliver() did with an event, counted in the topic's EventTopicStats.
+ */
+enum class MailboxDelivery : std::uint8_t {
+    Queued = 0,
+    Dropped = 1,   // The event, or an older one of the topic it displaced, was discarded
+    Coalesced = 2  // The event replaced an older payload of the topic that was still waiting
+};
+
+/**
+ * @enum RequestStatus
+ * @brief Outcome of IEventService::Request().
+ */
+enum class RequestStatus : std::uint8_t {
+    Ok = 0,          // A responder answered
+    Timeout = 1,     // No response within the timeout
+    Overloaded = 2,  // Too many requests pending; the request was not published
+    Cancelled = 3    // The event service stopped before a response arrived
+};
+
+/**
+ * @class RequestError
+ * @brief Thrown by the future of IEventService::Request() when no response arrives.
+ */
+class RequestError : public std::runtime_error {
+public:
+    RequestError(RequestStatus status, const std::string& message)
+        : std::runtime_error(message), status(status) {}
+
+    RequestStatus Status() const { return status; }
+
+private:
+    RequestStatus status;
+};
+
+/**
+ * @struct EventTopicStats
+ * @brief Per-topic delivery counters.
+ */
+struct EventTopicStats {
+    std::uint64_t pending = 0;    // Queued and not yet dispatched (bounded and coalesced topics only)
+    std::uint64_t dropped = 0;    // Discarded by DropNewest/DropOldest
+    std::uint64_t coalesced = 0;  // Payloads replaced by a newer one before dispatch
+};
+
+/**
+ * @struct EventLaneStats
+ * @brief Queue statistics of one priority lane, summed over all dispatcher workers.
+ */
+struct EventLaneStats {
+    std::uint64_t enqueued = 0;    // Events accepted into the lane so far
+    std::uint64_t dispatched = 0;  // Events taken out of the lane so far
+    std::uint64_t depth = 0;       // Events currently waiting
+    std::uint64_t maxDepth = 0;    // Highest depth seen by a dispatcher
+};
+
+/**
+ * @struct EventLatencyStats
+ * @brief Summary of a latency histogram; all times in nanoseconds.
+ * @details Percentiles are bucket upper bounds with a relative error of at most 12.5%.
+ */
+struct EventLatencyStats {
+    std::uint64_t count = 0;
+    std::uint64_t mean = 0;
+    std::uint64_t p50 = 0;
+    std::uint64_t p90 = 0;
+    std::uint64_t p99 = 0;
+    std::uint64_t max = 0;
+};
+
+/**
+ * @struct EventTopicLatency
+ * @brief Latency of one topic since it was registered.
+ * @details Measured on a sample of the events to keep the clock off the hot path; count is the
+ * number of samples, not of events.
+ */
+struct EventTopicLatency {
+    EventLatencyStats queueWait;  // Trigger() until a dispatcher picks the event up
+    EventLatencyStats handler;    // Each subscriber call; for mailboxes only the hand-over
+};
+
+/**
+ * @struct EventHandlerStats
+ * @brief Call counters of one subscriber of a topic; times in nanoseconds.
+ * @details Covers the same sample of events as EventTopicLatency.
+ */
+struct EventHandlerStats {
+    std::uint64_t subscription = 0;  // Token returned by Subscribe()
+    std::uint64_t calls = 0;         // Timed calls
+    std::uint64_t slowCalls = 0;     // Calls longer than the slow handler threshold
+    std::uint64_t totalTime = 0;
+    std::uint64_t maxTime = 0;
+};
+
 /**
  * @class IEventService
  * @brief Interface for an event service that allows subscribing to and triggering events.
@@ -25,19 +155,217 @@ public:
      */
     using EventCallback = std::function<void(const std::string&)>;
 
+    /**
+     * @typedef PayloadCallback
+     * @brief Callback receiving the shared payload of an event, whatever its type.
+     */
+    using PayloadCallback = std::function<void(const EventPayload&)>;
+
+    /**
+     * @typedef TopicId
+     * @brief Compact integer handle of an interned event name.
+     * @details Handles are dense (0, 1, 2, ...) and stay valid for the lifetime of the service.
+     */
+    using TopicId = std::uint32_t;
+
+    /**
+     * @typedef PatternCallback
+     * @brief Callback of a wildcard subscription; also receives the topic that matched.
+     */
+    using PatternCallback = std::function<void(TopicId, const EventPayload&)>;
+
+    /**
+     * @typedef SubscriptionId
+     * @brief Token returned by Subscribe(), used to unsubscribe again.
+     */
+    using SubscriptionId = std::uint64_t;
+
+    /**
+     * @typedef ResponseCallback
+     * @brief Continuation of a request; payload is empty unless status is RequestStatus::Ok.
+     */
+    using ResponseCallback = std::function<void(RequestStatus status, const EventPayload& payload)>;
+
+    /**
+     * @typedef TimerId
+     * @brief Token returned by TriggerAfter(), TriggerAt() and TriggerEvery(), used to cancel the timer.
+     */
+    using TimerId = std::uint64_t;
+
+    /**
+     * @typedef Activator
+     * @brief Starts creating a topic's subscribers and calls done once they exist, see SetTopicActivator().
+     */
+    using Activator = std::function<void(std::function<void()> done)>;
+
+    /**
+     * @brief Interns an event name and returns its handle.
+     * @param eventName The name of the event.
+     * @return The handle of the event; registering the same name twice returns the same handle.
+     */
+    virtual TopicId RegisterTopic(const std::string& eventName) = 0;
+
+    /**
+     * @brief Returns the name a handle was registered with.
+     * @param topic The handle returned by RegisterTopic().
+     */
+    virtual const std::string& GetTopicName(TopicId topic) const = 0;
+
+    /**
+     * @brief Assigns the dispatch lane of a topic; topics start as EventPriority::Normal.
+     * @details Set the priority before the topic is triggered: events already queued stay in
+     * their old lane, so changing it later can reorder them against new events.
+     */
+    virtual void SetTopicPriority(TopicId topic, EventPriority priority) = 0;
+
+    /**
+     * @brief Returns the queue statistics of a priority lane.
+     */
+    virtual EventLaneStats GetLaneStats(EventPriority priority) const = 0;
+
+    /**
+     * @brief Bounds the number of queued events of a topic.
+     * @details Topics start as DeliveryPolicy::Block with no per-topic limit, i.e. they are only
+     * bounded by the capacity of their lane. DropOldest keeps the newest maxPending events in a ring
+     * of the topic, with a single entry in the shared lane, so a burst neither blocks the publisher
+     * nor crowds out other topics. CoalesceLatest ignores maxPending: a slow consumer always gets the
+     * newest state in O(1), without replaying the backlog.
+     * @param topic The handle of the event.
+     * @param policy What to do once maxPending events are queued.
+     * @param maxPending Per-topic limit; 0 means no limit.
+     */
+    virtual void SetTopicPolicy(TopicId topic, DeliveryPolicy policy, std::size_t maxPending = 0) = 0;
+
+    /**
+     * @brief Runs activator once, on the first event of the topic, and holds the topic's events until it is done.
+     * @details Meant for creating subscribers on first use, e.g. loading a plugin. The activator is
+     * called on the publishing thread and should only hand the work to another thread, which calls done
+     * once the subscribers exist. No publisher waits for it: events of the topic are held meanwhile and
+     * queued in their order at done, so the new subscribers receive them. If the activator throws, the
+     * held events are queued and the next event tries again. An empty activator removes the one set
+     * before and queues what it held.
+     */
+    virtual void SetTopicActivator(TopicId topic, Activator activator) = 0;
+
+    /**
+     * @brief Returns the delivery counters of a topic.
+     */
+    virtual EventTopicStats GetTopicStats(TopicId topic) const = 0;
+
+    /**
+     * @brief Returns the queue wait and handler time histograms of a topic.
+     */
+    virtual EventTopicLatency GetTopicLatency(TopicId topic) const = 0;
+
+    /**
+     * @brief Returns the call counters of every current subscriber of a topic.
+     */
+    virtual std::vector<EventHandlerStats> GetHandlerStats(TopicId topic) const = 0;
+
+    /**
+     * @brief Calls taking longer than this are counted as slow and logged; the default is 1 ms.
+     * @details Logging is rate limited per subscriber: the 1st, 2nd, 4th, 8th, ... slow call is reported.
+     */
+    virtual void SetSlowHandlerThreshold(std::chrono::nanoseconds threshold) = 0;
+
     /**
      * @brief Subscribes to an event with a callback function.
      * @param eventName The name of the event to subscribe to.
      * @param callback The callback function to be called when the event is triggered.
+     * @return Token identifying the subscription.
+     */
+    virtual SubscriptionId Subscribe(const std::string& eventName, EventCallback callback) = 0;
+
+    /**
+     * @brief Subscribes to an event handle with a callback function.
+     * @param topic The handle of the event to subscribe to.
+     * @param callback The callback function to be called when the event is triggered.
+     * @return Token identifying the subscription.
+     */
+    virtual SubscriptionId Subscribe(TopicId topic, EventCallback callback) = 0;
+
+    /**
+     * @brief Subscribes to an event handle with a payload callback.
+     * @details The callback receives every payload of the topic, string or typed.
+     * @param topic The handle of the event to subscribe to.
+     * @param callback The callback function to be called when the event is triggered.
+     * @return Token identifying the subscription.
+     */
+    virtual SubscriptionId SubscribePayload(TopicId topic, PayloadCallback callback) = 0;
+
+    /**
+     * @brief Subscribes to typed payloads of an event handle.
+     * @details Usage: Subscribe<PlaybackState>(topic, [](const std::shared_ptr<const PlaybackState>& state) {...});
+     * Payloads of other types, including strings, are not passed to the callback.
+     */
+    template<typename T>
+    SubscriptionId Subscribe(TopicId topic, std::function<void(const std::shared_ptr<const T>&)> callback) {
+        return SubscribePayload(topic, [callback = std::move(callback)](const EventPayload& payload) {
+            if (auto value = payload.As<T>()) {
+                callback(value);
+            }
+        });
+    }
+
+    /**
+     * @brief Subscribes a non-blocking callback that may run on the publishing thread.
+     * @details For TriggerSync() the callback is invoked directly by the caller, without any
+     * thread hop; for Trigger() it is dispatched like any other subscriber. The callback must not
+     * block, lock contended mutexes or do I/O: it runs inside the publisher's critical path.
+     * Debug builds log inline callbacks that exceed a small time budget.
+     * @param topic The handle of the event to subscribe to.
+     * @param callback The callback function to be called when the event is triggered.
+     * @return Token identifying the subscription.
+     */
+    virtual SubscriptionId SubscribeInline(TopicId topic, EventCallback callback) = 0;
+
+    /**
+     * @brief Payload variant of SubscribeInline().
+     */
+    virtual SubscriptionId SubscribePayloadInline(TopicId topic, PayloadCallback callback) = 0;
+
+    /**
+     * @brief Subscribes a mailbox to an event handle.
+     * @details Instead of running a callback on the dispatcher thread, the event is handed to
+     * mailbox->Deliver() together with the handler pointer given here, so the receiver does not
+     * have to look the handler up again. Both pointers must stay valid until Unsubscribe() returns.
+     * @param topic The handle of the event to subscribe to.
+     * @param mailbox The receiving mailbox.
+     * @param handler Opaque to the event service, passed back unchanged on delivery.
+     * @return Token identifying the subscription.
+     */
+    virtual SubscriptionId Subscribe(TopicId topic, IEventMailbox* mailbox, const PayloadCallback* handler) = 0;
+
+    /**
+     * @brief Subscribes to every topic whose name matches a pattern, including topics registered later.
+     * @details Topic names are hierarchical, with levels separated by '/'. In a pattern, "*" matches
+     * exactly one level and "#" matches any number of trailing levels, including none; "#" may only be
+     * the last level. E.g. "playback/#" matches "playback", "playback/started" and
+     * "playback/state/paused"; with "*" in place of "#" only "playback/started" matches. Matching happens when the subscription or the
+     * topic is registered, never when an event is triggered.
+     * @param pattern The topic pattern.
+     * @param callback Called with the matching topic and the payload of each event.
+     * @return Token identifying the subscription; Unsubscribe() removes it from all matching topics.
+     * @throws std::invalid_argument if "#" is not the last level or a level mixes wildcards and text.
+     */
+    virtual SubscriptionId SubscribePattern(const std::string& pattern, PatternCallback callback) = 0;
+
+    /**
+     * @brief Subscribes a mailbox to every topic matching a pattern.
+     * @details See SubscribePattern() for the pattern syntax and Subscribe(TopicId, IEventMailbox*, ...)
+     * for mailbox delivery; the matching topic is passed to IEventMailbox::Deliver().
      */
-    virtual void Subscribe(const std::string& eventName, EventCallback callback) = 0;
+    virtual SubscriptionId SubscribePattern(const std::string& pattern, IEventMailbox* mailbox, const PayloadCallback* handler) = 0;
 
     /**
-     * @brief Unsubscribes from an event with a callback function.
-     * @param eventName The name of the event to unsubscribe from.
-     * @param callback The callback function to be removed from the event subscribers.
+     * @brief Removes a subscription.
+     * @details When called from outside the event service, this waits until no dispatcher thread is
+     * still running the callback, so objects captured by it can be destroyed right afterwards. When
+     * called from inside a callback it does not wait, and events that are already being dispatched
+     * may still reach the removed callback.
+     * @param subscription The token returned by Subscribe(); unknown tokens are ignored.
      */
-    virtual void Unsubscribe(const std::string& eventName, EventCallback callback) = 0;
+    virtual void Unsubscribe(SubscriptionId subscription) = 0;
 
     /**
      * @brief Triggers an event with an optional parameter.
@@ -46,10 +374,175 @@ public:
      */
     virtual void Trigger(const std::string& eventName, const std::string& param = "") = 0;
 
+    /**
+     * @brief Triggers an event by handle with an optional parameter.
+     * @details Preferred on hot paths: no string hashing and no copy of the event name.
+     * @param topic The handle of the event to trigger.
+     * @param param The optional parameter to pass to the event callback.
+     */
+    virtual void Trigger(TopicId topic, const std::string& param = "") = 0;
+
+    /**
+     * @brief Triggers an event with a shared payload.
+     * @details The payload is handed to every subscriber by reference count, it is never copied.
+     * @param topic The handle of the event to trigger.
+     * @param payload The payload to pass to the event callbacks.
+     */
+    virtual void TriggerPayload(TopicId topic, EventPayload payload) = 0;
+
+    /**
+     * @brief Triggers an event and runs its inline subscribers on the calling thread.
+     * @details Subscribers registered with SubscribeInline() have returned when this returns; all
+     * other subscribers are dispatched as with Trigger(). Nested TriggerSync() calls from inline
+     * callbacks fall back to queued dispatch beyond a small depth, so re-entrant publishing cannot
+     * recurse without bound.
+     * @param topic The handle of the event to trigger.
+     * @param param The optional parameter to pass to the event callback.
+     */
+    virtual void TriggerSync(TopicId topic, const std::string& param = "") = 0;
+
+    /**
+     * @brief Payload variant of TriggerSync().
+     */
+    virtual void TriggerPayloadSync(TopicId topic, EventPayload payload) = 0;
+
+    /**
+     * @brief Triggers an event with a typed payload.
+     * @details Usage: Trigger(topic, std::make_shared<const PlaybackState>(state));
+     */
+    template<typename T>
+    void Trigger(TopicId topic, std::shared_ptr<const T> value) {
+        TriggerPayload(topic, EventPayload(std::move(value)));
+    }
+
+    template<typename T>
+    void Trigger(TopicId topic, std::shared_ptr<T> value) {
+        TriggerPayload(topic, EventPayload(std::shared_ptr<const T>(std::move(value))));
+    }
+
     /**
      * @brief Starts the event service.
+     * @details Topics are sharded across the worker threads by handle, so events of one topic are
+     * always delivered in FIFO order by the same worker, while different topics are dispatched in
+     * parallel. With more than one worker, a callback subscribed to several topics may be invoked
+     * concurrently and has to be thread-safe.
+     * @param workerCount Number of dispatcher threads; 0 means one per hardware thread.
+     */
+    virtual void Start(size_t workerCount = 1) = 0;
+
+    /**
+     * @brief Triggers an event once, after a delay.
+     * @details Timers are kept in a timer wheel served by a single thread of the event service, which
+     * triggers the event when it is due. Timers only fire while the service is started.
+     * @param delay Time from now until the event is triggered.
+     * @param topic The handle of the event to trigger.
+     * @param param The optional parameter to pass to the event callback.
+     * @return Token for CancelTimer().
+     */
+    virtual TimerId TriggerAfter(std::chrono::nanoseconds delay, TopicId topic, const std::string& param = "") = 0;
+
+    /**
+     * @brief Triggers an event once, at a point in time.
+     * @details Times in the past fire right away. Use a common base time for a series of commands,
+     * e.g. TriggerAt(start + 3s, ...), TriggerAt(start + 6s, ...), so they keep their spacing.
+     * @param time When to trigger the event.
+     * @param topic The handle of the event to trigger.
+     * @param param The optional parameter to pass to the event callback.
+     * @return Token for CancelTimer().
+     */
+    virtual TimerId TriggerAt(std::chrono::steady_clock::time_point time, TopicId topic, const std::string& param = "") = 0;
+
+    /**
+     * @brief Triggers an event periodically, first after one period.
+     * @details Deadlines are computed from the first one, not from when the previous event fired, so
+     * the schedule does not drift. Periods missed because the process stalled are skipped, not caught up.
+     * @param period Time between two events.
+     * @param topic The handle of the event to trigger.
+     * @param param The optional parameter to pass to the event callback.
+     * @return Token for CancelTimer().
+     */
+    virtual TimerId TriggerEvery(std::chrono::nanoseconds period, TopicId topic, const std::string& param = "") = 0;
+
+    /**
+     * @brief General form of the timer functions above, with a shared payload.
+     * @param time When to trigger the event first.
+     * @param period Time between two events; zero for a one-shot timer.
+     */
+    virtual TimerId TriggerPayloadAt(std::chrono::steady_clock::time_point time, std::chrono::nanoseconds period, TopicId topic, EventPayload payload) = 0;
+
+    /**
+     * @brief Cancels a timer.
+     * @param timer The token returned when the timer was created.
+     * @return false if the timer is unknown or a one-shot timer has already fired.
+     */
+    virtual bool CancelTimer(TimerId timer) = 0;
+
+    /**
+     * @brief Publishes a request and returns a future of the response.
+     * @details The payload is triggered on the topic like any event, tagged with a correlation id
+     * (EventPayload::RequestId()); a subscriber answers it with Respond(). Pending requests live in a
+     * fixed-size table, so besides the shared state of the future nothing is allocated per call.
+     * Timeouts only fire while the service is started. Do not wait for the future inside an event
+     * callback: the response may have to be dispatched by the very thread that is waiting.
+     * @param topic The handle of the request topic.
+     * @param payload The request parameters.
+     * @param timeout Time to wait for a response; zero waits until Stop().
+     * @return Future of the response payload; it throws RequestError on timeout, overload or stop.
      */
-    virtual void Start() = 0;
+    virtual std::future<EventPayload> Request(TopicId topic, EventPayload payload,
+                                              std::chrono::nanoseconds timeout = std::chrono::seconds(1)) = 0;
+
+    /**
+     * @brief Publishes a request and calls a continuation with the response.
+     * @details Without a future, nothing at all is allocated per call as long as the callback fits
+     * the small buffer of std::function. The callback runs exactly once: on the responder's thread,
+     * on the timer thread after a timeout, on the caller's thread if the table is full, or in Stop().
+     * @param topic The handle of the request topic.
+     * @param payload The request parameters.
+     * @param callback Receives the outcome and the response payload.
+     * @param timeout Time to wait for a response; zero waits until Stop().
+     */
+    virtual void Request(TopicId topic, EventPayload payload, ResponseCallback callback,
+                         std::chrono::nanoseconds timeout = std::chrono::seconds(1)) = 0;
+
+    /**
+     * @brief Answers a request.
+     * @details Completes the future or runs the continuation of the requester. Only the first
+     * response of a request counts.
+     * @param request The payload received by the subscriber of the request topic.
+     * @param response The response payload.
+     * @return false if the payload is not a request, or the request already timed out or was answered.
+     */
+    virtual bool Respond(const EventPayload& request, EventPayload response) = 0;
+
+    /**
+     * @brief Starts recording every triggered event into a memory-mapped journal file.
+     * @details Recording is lock-free on the publishing path and cheap enough to leave enabled in
+     * production. Events are recorded as triggered, before any delivery policy applies; only string
+     * payloads are recorded. Once the file is full, further events are counted as dropped. A running
+     * recording is stopped first.
+     * @param path The journal file; created or truncated.
+     * @param capacity Maximum size of the file in bytes.
+     * @return false if the file cannot be created.
+     */
+    virtual bool StartRecording(const std::string& path, std::size_t capacity = std::size_t(64) << 20) = 0;
+
+    /**
+     * @brief Stops recording and closes the journal, cut to the recorded size.
+     */
+    virtual void StopRecording() = 0;
+
+    /**
+     * @brief Triggers all events of a journal again, on the calling thread.
+     * @details Topics are matched by name, so the journal can be replayed against a fresh process.
+     * Events that were triggered from inside event callbacks are skipped: running the callbacks
+     * again triggers them again.
+     * @param path The journal file.
+     * @param originalSpeed true to keep the recorded timing between events, false to replay as fast
+     * as possible.
+     * @return The number of events triggered.
+     */
+    virtual std::size_t Replay(const std::string& path, bool originalSpeed = true) = 0;
 
     /**
      * @brief Stops the event service.
@@ -59,4 +552,26 @@ public:
     virtual void Stop() = 0;
 };
 
+/**
+ * @class IEventMailbox
+ * @brief Receiver of events subscribed with IEventService::Subscribe(topic, mailbox, handler).
+ */
+class IEventMailbox {
+public:
+    virtual ~IEventMailbox() = default;
+
+    /**
+     * @brief Called on a dispatcher thread for every event of a subscribed topic.
+     * @details Should only enqueue the event; the handler is meant to run on the receiver's thread.
+     * A full mailbox applies the topic's policy instead of waiting, except for DeliveryPolicy::Block:
+     * then the dispatcher, and every topic of its shard, waits until the receiver makes room.
+     * @param topic The handle of the triggered event.
+     * @param handler The handler pointer given at subscription time.
+     * @param payload The event payload.
+     * @param policy The topic's delivery policy.
+     */
+    virtual MailboxDelivery Deliver(IEventService::TopicId topic, const IEventService::PayloadCallback* handler, const EventPayload& payload,
+                                    DeliveryPolicy policy) = 0;
+};
+
 #endif // IEVENTSERVICE_H
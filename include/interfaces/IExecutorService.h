@@ -0,0 +1,62 @@
+#ifndef IEXECUTORSERVICE_H
+#define IEXECUTORSERVICE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include "ThreadPolicy.h"
+
+/**
+ * @struct ExecutorStats
+ * @brief Counters of an IExecutorService, for diagnostics.
+ */
+struct ExecutorStats {
+    size_t workers = 0;
+    size_t longRunning = 0;  // Threads of SubmitLongRunning() tasks still running
+    uint64_t executed = 0;
+    uint64_t stolen = 0;     // Tasks run by another worker than the one that queued them
+    size_t queued = 0;       // Approximate, at the time of the call
+};
+
+/**
+ * @class IExecutorService
+ * @brief Shared pool of worker threads, sized to the machine instead of to the number of plugins.
+ * @details Tasks must not block for long: they share a handful of threads with every plugin's event
+ * handlers. Anything that waits indefinitely, such as a main loop of its own, belongs in
+ * SubmitLongRunning().
+ */
+class IExecutorService {
+public:
+    using Task = std::function<void()>;
+
+    virtual ~IExecutorService() = default;
+
+    /**
+     * @brief Queues a short task; safe to call from any thread.
+     * @details Tasks submitted from a worker run on that worker unless an idle one steals them.
+     * Exceptions thrown by the task are logged and swallowed. After Stop() the task runs on the
+     * calling thread.
+     */
+    virtual void Submit(Task task) = 0;
+
+    /**
+     * @brief Runs a task that may block for its whole lifetime on a thread of its own.
+     * @param policy Stack size, CPUs, priority and name of that thread.
+     */
+    virtual void SubmitLongRunning(Task task, const ThreadPolicy& policy) = 0;
+
+    /**
+     * @brief SubmitLongRunning() with the configured policy for long-running tasks.
+     */
+    virtual void SubmitLongRunning(Task task) = 0;
+
+    virtual size_t WorkerCount() const = 0;
+    virtual ExecutorStats GetStats() const = 0;
+
+    /**
+     * @brief Runs the tasks still queued, then joins all workers and long-running tasks.
+     */
+    virtual void Stop() = 0;
+};
+
+#endif // IEXECUTORSERVICE_H
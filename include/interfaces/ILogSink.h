@@ -0,0 +1,44 @@
+#ifndef ILOGSINK_H
+#define ILOGSINK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+enum class LogLevel : std::uint8_t;
+
+/*
+* A formatted log message, only valid during ILogSink::Write()
+*/
+struct LogMessage {
+    std::uint64_t time;     // System clock, nanoseconds since the epoch
+    LogLevel level;
+    std::string_view text;  // Without the trailing newline
+};
+
+/*
+* Destination of log messages, see ILoggerService::AddSink()
+* All calls come from one thread at a time, usually the log thread, so sinks need no locking
+*/
+class ILogSink {
+public:
+    virtual ~ILogSink() = default;
+
+    /*
+    * Take a batch of messages; may buffer them until Flush()
+    */
+    virtual void Write(const LogMessage* messages, std::size_t count) = 0;
+
+    /*
+    * Write out everything buffered; called after every batch, at shutdown and on a crash
+    */
+    virtual void Flush() = 0;
+
+    /*
+    * File descriptor the fatal signal handler writes the last messages to, as plain lines with ::write(),
+    * bypassing Write(); -1 if the sink takes no part. Read while no Write() or Flush() is running
+    */
+    virtual int CrashFd() const { return -1; }
+};
+
+#endif // ILOGSINK_H
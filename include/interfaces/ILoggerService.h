@@ -1,96 +1,180 @@
 #ifndef ILOGGERSERVICE_H
 #define ILOGGERSERVICE_H
 
+#include "LogBuffer.h"
+#include "ILogSink.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <sstream>
-#include <mutex>
-#include <queue>
 #include <thread>
-#include <condition_variable>
 #include <iostream>
 
-class ILoggerService {
+/*
+* Severity of a log message, in increasing order
+*/
+enum class LogLevel : std::uint8_t {
+    Trace = 0,    // Per-event and per-iteration detail
+    Debug = 1,    // Lifecycle detail useful while developing
+    Info = 2,     // Normal operation; the level of plain operator<< messages
+    Warning = 3,
+    Error = 4,
+    Off = 5
+};
+
+/*
+* Lowest level compiled in; the APX_LOG macros below it are removed by the compiler
+* Set APERTUS_LOG_MIN_LEVEL to the number of a LogLevel to override, release builds drop Trace by default
+*/
+#ifndef APERTUS_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define APERTUS_LOG_MIN_LEVEL 1
+#else
+#define APERTUS_LOG_MIN_LEVEL 0
+#endif
+#endif
+
+constexpr LogLevel kMinLogLevel = static_cast<LogLevel>(APERTUS_LOG_MIN_LEVEL);
+
+/*
+* Parse "trace", "debug", "info", "warning", "error" or "off", case-insensitive
+* @return false if the name is unknown, level is unchanged then
+*/
+inline bool ParseLogLevel(const std::string& name, LogLevel& level) {
+    static const char* const names[] = {"trace", "debug", "info", "warning", "error", "off"};
+    std::string lower;
+    for (char c : name) {
+        lower += static_cast<char>(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
+    }
+    for (std::uint8_t i = 0; i <= static_cast<std::uint8_t>(LogLevel::Off); ++i) {
+        if (lower == names[i]) {
+            level = static_cast<LogLevel>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+* Runtime level of one component, e.g. "EventService" or a plugin name
+* Obtained once from ILoggerService::Category() and kept, checking it is a single relaxed load
+*/
+class LogCategory {
 public:
-    /*
-    * Constructor
-    * Start the log thread
-    * @param running Set to true to start the log thread
-    */
-    ILoggerService() : running(true), logThread(&ILoggerService::ProcessLogs, this) {
-        std::cout << "[Logger] Log thread started!" << std::endl;
+    LogCategory(std::string name, LogLevel level) : name(std::move(name)), level(level) {}
+
+    const std::string& Name() const { return name; }
+    LogLevel Level() const { return level.load(std::memory_order_relaxed); }
+    void SetLevel(LogLevel value) { level.store(value, std::memory_order_relaxed); }
+
+    bool Enabled(LogLevel messageLevel) const {
+        return messageLevel >= kMinLogLevel && messageLevel >= level.load(std::memory_order_relaxed);
     }
 
+private:
+    const std::string name;
+    std::atomic<LogLevel> level;
+};
+
+/*
+* Log with a level, skipping the whole statement, arguments included, when the level is disabled
+* Usage: APX_LOG_DEBUG(logger, logCategory) << "[Class]::Method() message " << value << std::endl;
+* logger is an ILoggerService*, category a LogCategory*
+*/
+#define APX_LOG(logger, category, level) \
+    if (!(category)->Enabled(level)) {} else (logger)->At(level)
+
+#define APX_LOG_TRACE(logger, category) APX_LOG(logger, category, LogLevel::Trace)
+#define APX_LOG_DEBUG(logger, category) APX_LOG(logger, category, LogLevel::Debug)
+#define APX_LOG_INFO(logger, category) APX_LOG(logger, category, LogLevel::Info)
+#define APX_LOG_WARNING(logger, category) APX_LOG(logger, category, LogLevel::Warning)
+#define APX_LOG_ERROR(logger, category) APX_LOG(logger, category, LogLevel::Error)
+
+class ILoggerService {
+public:
     /*
     * Destructor
-    * Stop the log thread
     */
-    virtual ~ILoggerService() {
-        running = false;
-        logCondition.notify_all();
-        if (logThread.joinable()) {
-            logThread.join();
-        }
-    }
+    virtual ~ILoggerService() = default;
 
     /*
-    * Log a message
+    * Log a preformatted message
     * @param message The message to log
     */
-    virtual void Log(const std::string& message) {
-        std::lock_guard<std::mutex> lock(queueMutex);
-        logQueue.push(message);
-        logCondition.notify_one();
+    virtual void Log(const std::string& message) = 0;
+
+    /*
+    * Get the category of a component, created with the default level on first use
+    * The reference stays valid for the lifetime of the logger
+    */
+    virtual LogCategory& Category(const std::string& name) = 0;
+
+    /*
+    * Set the level of every category that has no level of its own; the default is Info
+    */
+    virtual void SetLevel(LogLevel level) = 0;
+
+    /*
+    * Set the level of one category, overriding the default level
+    */
+    virtual void SetLevel(const std::string& category, LogLevel level) = 0;
+
+    /*
+    * Add a destination for log messages; the console is one by default
+    */
+    virtual void AddSink(std::shared_ptr<ILogSink> sink) = 0;
+
+    /*
+    * Remove a sink added with AddSink(), flushing it first
+    */
+    virtual void RemoveSink(const std::shared_ptr<ILogSink>& sink) = 0;
+
+    /*
+    * Write every message committed so far to all sinks and flush them; blocks until done
+    */
+    virtual void Flush() = 0;
+
+    /*
+    * Set the level of the message the calling thread is composing; plain messages are Info
+    * Usually called through the APX_LOG macros
+    */
+    ILoggerService& At(LogLevel level) {
+        Buffer().SetLevel(static_cast<std::uint8_t>(level));
+        return *this;
     }
 
     /* 
     * Overload operator<< to allow logging with stream syntax
     * Usage: loggerService << "Log message" << std::endl;
+    * The value is stored in binary form in the calling thread's buffer and formatted later by
+    * the log thread, see LogBuffer
     */
     template<typename T>
     ILoggerService& operator<<(const T& value) {
-        std::lock_guard<std::mutex> lock(bufferMutex);
-        buffer << value;
+        Buffer().Append(value);
         return *this;
     }
 
     /*
-    * Handle std::endl or explicit flush
+    * Handle std::endl or explicit flush: ends the message of the calling thread
     * Usage: loggerService << "Log message" << std::endl;
     */
-    ILoggerService& operator<<(std::ostream& (*manip)(std::ostream&)) {
-        std::lock_guard<std::mutex> lock(bufferMutex);
-        Log(buffer.str());
-        buffer.str("");
-        buffer.clear();
+    ILoggerService& operator<<(std::ostream& (*)(std::ostream&)) {
+        Commit(Buffer());
         return *this;
     }
 
 protected:
-    std::stringstream buffer;
-    std::mutex bufferMutex;
-    std::queue<std::string> logQueue;
-    std::mutex queueMutex;
-    std::condition_variable logCondition;
-    bool running;
-    std::thread logThread;
+    /*
+    * The calling thread's buffer, created on first use
+    */
+    virtual LogBuffer& Buffer() = 0;
 
     /*
-    * Process log messages
-    * Wait for a log message to be available and print it
+    * Publish the message composed in buffer to the log thread
     */
-    void ProcessLogs() {
-        while (running || !logQueue.empty()) {
-            std::unique_lock<std::mutex> lock(queueMutex);
-            logCondition.wait(lock, [this] { return !logQueue.empty() || !running; });
-            while (!logQueue.empty()) {
-                std::string message = logQueue.front();
-                logQueue.pop();
-                lock.unlock();
-                std::cout << message << std::endl;
-                lock.lock();
-            }
-        }
-    }
+    virtual void Commit(LogBuffer& buffer) = 0;
 };
 
 #endif // ILOGGERSERVICE_H
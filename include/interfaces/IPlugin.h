@@ -1,19 +1,67 @@
 #ifndef IPLUGIN_H
 #define IPLUGIN_H
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <thread>
+#include <vector>
+#include "ThreadPolicy.h"
+#include "IEventService.h"
+
+/**
+ * @struct PluginActivity
+ * @brief What a plugin is doing right now, sampled by the IPluginService watchdog.
+ * @details Timestamps are steady_clock nanoseconds since its epoch, durations are nanoseconds.
+ */
+struct PluginActivity {
+    uint64_t cpuTime = 0;        // CPU used by handlers, Update(), submit() and long-running tasks
+    uint64_t handled = 0;        // Events handled so far
+    size_t backlog = 0;          // Events queued and not handled yet
+    uint64_t busySince = 0;      // Start of the handler running now, 0 while idle
+    uint64_t lastHeartbeat = 0;  // 0 if the plugin does not send heartbeats
+    EventLatencyStats handlerTime;
+};
 
 class IPlugin {
 public:
     virtual ~IPlugin() = default;
 
     virtual void Init() = 0;
+
+    // Runs once as a task on the shared executor after every plugin is initialized; it must return.
+    // Work that blocks for good goes to IExecutorService::SubmitLongRunning().
     virtual void Run() = 0;
     virtual void Destroy() = 0;
 
+    // Called every frame of the IPluginService frame clock if WantsUpdate() returns true. Plugins
+    // that are an IEventMailbox get it through their mailbox, so it never overlaps their handlers.
+    virtual void Update(std::chrono::nanoseconds /*deltaTime*/) {}
+    virtual bool WantsUpdate() const { return false; }
+
     virtual std::string GetName() const = 0;
     virtual std::thread::id GetThreadId() const = 0;
+
+    // Names of plugins whose Init() must complete before this one's
+    virtual std::vector<std::string> GetDependencies() const { return {}; }
+
+    // Capabilities this plugin offers, and the ones that must be offered by plugins initialized first
+    virtual std::vector<std::string> GetProvides() const { return {}; }
+    virtual std::vector<std::string> GetRequires() const { return {}; }
+
+    // Hot reload, see IPluginService::ReloadPlugin(): the old instance is asked for its state after
+    // Destroy(), the new one gets it before Init(), so its first event already sees the state.
+    // Init() must not reset what RestoreState() set. An empty state is not handed over.
+    virtual std::string SerializeState() const { return {}; }
+    virtual void RestoreState(const std::string& /*state*/) {}
+
+    // Set by the IPluginService before Init(), from the plugin's configuration; see IConfigService
+    virtual void SetThreadPolicy(const ThreadPolicy& /*policy*/) {}
+
+    // Polled by the watchdog from its own thread. The default reports nothing; the watchdog still
+    // times Init() and Run() itself.
+    virtual PluginActivity GetActivity() const { return {}; }
 };
 
 #endif // IPLUGIN_H
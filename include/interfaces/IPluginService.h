@@ -1,16 +1,138 @@
 #ifndef IPLUGINSERVICE_H
 #define IPLUGINSERVICE_H
 
+#include <chrono>
+#include <cstdint>
 #include <memory>
+#include <string>
 #include <vector>
 #include "IPlugin.h"
+#include "IEventService.h"
+
+/**
+ * @struct PluginStartupTiming
+ * @brief How one plugin's Init() went, see IPluginService::GetStartupReport().
+ */
+struct PluginStartupTiming {
+    std::string name;
+    size_t wave = 0;                         // Longest chain of dependencies below the plugin
+    std::chrono::nanoseconds start{0};       // Since InitPlugins() was called
+    std::chrono::nanoseconds duration{0};    // Of Init()
+    std::chrono::nanoseconds criticalPath{0};  // Init() of the plugin and its slowest chain of dependencies
+    bool initialized = false;
+    std::string error;                       // Why Init() failed or was skipped
+    std::string library;                     // Shared library the plugin was loaded from, empty if registered
+};
+
+/**
+ * @struct FrameStats
+ * @brief Measurements of the frame clock, see IPluginService::SetFrameRate(); times in nanoseconds.
+ */
+struct FrameStats {
+    double rate = 0;               // Frames per second, 0 while the clock is stopped
+    uint64_t frames = 0;
+    uint64_t overruns = 0;         // Frames whose Update() phase took longer than the period
+    uint64_t skipped = 0;          // Frames dropped because the clock fell a whole period behind
+    EventLatencyStats frameTime;   // Update() phase of a frame, all waves
+    EventLatencyStats jitter;      // How late frames started against their schedule
+};
+
+enum class PluginHealthState {
+    Healthy,
+    Overloaded,  // Over its backlog or CPU budget, still making progress
+    Stalled,     // A handler, Init() or Run() over its time budget, no progress, or heartbeats missing
+    Abandoned    // Did not stop within the StopPlugins() deadline and was left behind
+};
+
+/**
+ * @struct PluginHealth
+ * @brief A plugin as the watchdog last saw it; published on "plugin/health" whenever state changes.
+ */
+struct PluginHealth {
+    std::string name;
+    PluginHealthState state = PluginHealthState::Healthy;
+    std::string reason;           // Empty while healthy
+    uint64_t cpuTime = 0;         // Nanoseconds in total
+    double cpuLoad = 0;           // Share of one CPU since the previous check
+    uint64_t handled = 0;
+    size_t backlog = 0;
+    uint64_t busyFor = 0;         // Nanoseconds the running handler, Init() or Run() has taken so far
+    uint64_t sinceHeartbeat = 0;  // Nanoseconds, 0 if the plugin sends none
+    EventLatencyStats handlerTime;
+};
 
 class IPluginService {
 public:
     virtual ~IPluginService() = default;
     virtual void RegisterPlugin(std::shared_ptr<IPlugin> plugin) = 0;
+
+    /**
+     * @brief Registers the shared-library plugins of a directory, see PluginApi.h.
+     * @details Call before InitPlugins(). Libraries whose manifest names activation topics are not
+     * loaded yet: the first event on one of the topics loads, initializes and runs the plugin.
+     * @return Number of plugins registered or waiting for activation.
+     */
+    virtual size_t LoadPlugins(const std::string& directory) = 0;
+
+    /**
+     * @brief Initializes the plugins in dependency order, then runs them.
+     * @details Dependencies and required capabilities form a DAG; every plugin starts as soon as
+     * the plugins it depends on are initialized, so independent ones initialize in parallel.
+     * Plugins with missing or failed dependencies, or on a cycle, are skipped.
+     */
     virtual void InitPlugins() = 0;
+
+    /**
+     * @brief Destroys the plugins, dependents before their dependencies.
+     * @details Every Destroy(), and the wait for Run() calls still going, is bounded by
+     * watchdog.stop_timeout_ms. Plugins that take longer are left running and reported as Abandoned
+     * by GetPluginHealth(). The process should exit soon after, their threads may still use the services.
+     */
     virtual void StopPlugins() = 0;
+
+    /**
+     * @brief Stops and destroys one plugin while the others keep running.
+     * @details The plugin is unsubscribed, the events already queued for it are handled, then its
+     * tasks and Run() are waited for. Refused while an initialized plugin depends on it. Blocks until
+     * done. Called from a plugin's own code (an event handler, submit() task, Run() or Update()) it
+     * could wait for its caller, so there it is only queued on the executor and returns at once;
+     * the outcome is logged.
+     * @return false if there is no such initialized plugin or it is still needed; true once queued
+     * when called from plugin code.
+     */
+    virtual bool UnloadPlugin(const std::string& name) = 0;
+
+    /**
+     * @brief Replaces a shared-library plugin with the library currently on disk.
+     * @details The new library is loaded first; if that fails the old instance keeps running.
+     * Otherwise the old instance is unloaded like in UnloadPlugin(), the new one gets the old one's
+     * SerializeState() through RestoreState(), is initialized, and runs. Dependents keep running.
+     * Also brings back a plugin stopped with UnloadPlugin(). From plugin code it is queued on the
+     * executor like UnloadPlugin().
+     * @return false if the plugin was not loaded from a library or the new one did not initialize;
+     * true once queued when called from plugin code.
+     */
+    virtual bool ReloadPlugin(const std::string& name) = 0;
+
+    virtual std::vector<PluginStartupTiming> GetStartupReport() const = 0;
+
+    /**
+     * @brief Sets how often the frame clock calls IPlugin::Update(); 0 stops it.
+     * @details Frames are scheduled on a fixed grid, so the clock does not drift. Within a frame,
+     * plugins update in dependency waves: the plugins of a wave run in parallel, a plugin only after
+     * the ones it depends on. The clock starts with InitPlugins() and stops with StopPlugins().
+     */
+    virtual void SetFrameRate(double framesPerSecond) = 0;
+
+    virtual FrameStats GetFrameStats() const = 0;
+
+    /**
+     * @brief Latest check of the watchdog, one entry per plugin.
+     * @details The watchdog runs every watchdog.interval_ms from InitPlugins() on. Budgets are read
+     * as watchdog.<plugin>.<budget>, falling back to watchdog.<budget>: handler_ms, heartbeat_ms,
+     * backlog and cpu_percent (0 for no limit).
+     */
+    virtual std::vector<PluginHealth> GetPluginHealth() const = 0;
 };
 
 #endif // IPLUGINSERVICE_H
@@ -0,0 +1,430 @@
+#ifndef LOGBUFFER_H
+#define LOGBUFFER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+
+/**
+ * @class LogBuffer
+ * @brief Lock-free single-producer/single-consumer ring of binary log messages (NanoLog style).
+ * @details Each logging thread owns one buffer. Append() stores the raw argument, tagged with its
+ * type, instead of formatting it; the logger thread turns messages back into text with Format(). A
+ * message only becomes visible to the logger thread at Commit(), so messages of different threads
+ * never interleave. Strings, numbers, bools, chars and pointers are deferred; any other streamable
+ * type is formatted by the producer and stored as a string.
+ *
+ * Layout: a MessageHeader, then per argument a one-byte ArgType and its value; strings as a
+ * uint32_t length and the characters. Records wrap around the end of the ring.
+ */
+class LogBuffer {
+public:
+    static constexpr size_t kCapacity = size_t(64) << 10;
+
+    enum ArgType : uint8_t {
+        Bool = 1,
+        Char = 2,
+        Int64 = 3,
+        UInt64 = 4,
+        Double = 5,
+        String = 6,
+        Pointer = 7
+    };
+
+    struct MessageHeader {
+        uint32_t size;   // Whole message including the header
+        uint16_t flags;
+        uint8_t level;   // LogLevel of the message
+        uint8_t reserved;
+        uint64_t time;   // Steady clock at Commit(), nanoseconds
+    };
+
+    // Level of messages that do not set one, LogLevel::Info
+    static constexpr uint8_t kDefaultLevel = 2;
+
+    // MessageHeader::flags
+    static constexpr uint16_t kTruncated = 1;  // Arguments were dropped, the message did not fit
+
+    LogBuffer() : data(new char[kCapacity]) {}
+
+    LogBuffer(const LogBuffer&) = delete;
+    LogBuffer& operator=(const LogBuffer&) = delete;
+
+    /**
+     * @brief Adds one argument to the message being composed; producer thread only.
+     */
+    template<typename T>
+    void Append(const T& value) {
+        using U = std::decay_t<T>;
+        if constexpr (std::is_same<U, bool>::value) {
+            AppendValue(Bool, value);
+        } else if constexpr (std::is_same<U, char>::value || std::is_same<U, signed char>::value ||
+                             std::is_same<U, unsigned char>::value) {
+            AppendValue(Char, static_cast<char>(value));
+        } else if constexpr (std::is_integral<U>::value && std::is_signed<U>::value) {
+            AppendValue(Int64, static_cast<int64_t>(value));
+        } else if constexpr (std::is_integral<U>::value) {
+            AppendValue(UInt64, static_cast<uint64_t>(value));
+        } else if constexpr (std::is_same<U, float>::value || std::is_same<U, double>::value) {
+            AppendValue(Double, static_cast<double>(value));
+        } else if constexpr (std::is_array<T>::value && std::is_same<std::remove_cv_t<std::remove_extent_t<T>>, char>::value) {
+            // Literals and char buffers: never null, and not read past their end
+            AppendString(std::string_view(value, ::strnlen(value, std::extent<T>::value)));
+        } else if constexpr (std::is_same<U, const char*>::value || std::is_same<U, char*>::value) {
+            AppendString(value != nullptr ? std::string_view(value) : std::string_view("(null)"));
+        } else if constexpr (std::is_convertible<const T&, std::string_view>::value) {
+            AppendString(std::string_view(value));
+        } else if constexpr (std::is_pointer<U>::value && !std::is_function<std::remove_pointer_t<U>>::value) {
+            AppendValue(Pointer, reinterpret_cast<uintptr_t>(value));
+        } else {
+            // No binary form, format now with the caller's operator<<
+            thread_local std::ostringstream formatter;
+            formatter.str(std::string());
+            formatter.clear();
+            formatter << value;
+            AppendString(formatter.str());
+        }
+    }
+
+    /**
+     * @brief Sets the level of the message being composed; producer thread only.
+     */
+    void SetLevel(uint8_t level) { messageLevel = level; }
+
+    /**
+     * @brief Publishes the message composed so far; producer thread only.
+     */
+    void Commit() {
+        if (pending == messageStart) {
+            Begin();  // Empty message
+        }
+        MessageHeader header;
+        header.size = static_cast<uint32_t>(pending - messageStart);
+        header.flags = messageFlags;
+        header.level = messageLevel;
+        header.reserved = 0;
+        header.time = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+        Write(messageStart, &header, sizeof(header));
+        tail.store(pending, std::memory_order_release);
+        messageStart = pending;
+        messageFlags = 0;
+        messageLevel = kDefaultLevel;
+    }
+
+    /**
+     * @brief Reads the header of the oldest committed message; logger thread only.
+     * @return false if there is none.
+     */
+    bool Front(MessageHeader& header) const {
+        size_t position = head.load(std::memory_order_relaxed);
+        if (position == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        Read(position, &header, sizeof(header));
+        return true;
+    }
+
+    /**
+     * @brief Formats the oldest committed message into out and removes it; logger thread only.
+     * @details Call after Front() returned true.
+     */
+    void Format(std::ostream& out) {
+        size_t position = head.load(std::memory_order_relaxed);
+        MessageHeader header;
+        Read(position, &header, sizeof(header));
+        size_t end = position + header.size;
+        position += sizeof(header);
+        while (position < end) {
+            uint8_t type;
+            Read(position, &type, sizeof(type));
+            position += sizeof(type);
+            switch (type) {
+                case Bool:
+                    out << ReadValue<bool>(position);
+                    break;
+                case Char:
+                    out << ReadValue<char>(position);
+                    break;
+                case Int64:
+                    out << ReadValue<int64_t>(position);
+                    break;
+                case UInt64:
+                    out << ReadValue<uint64_t>(position);
+                    break;
+                case Double:
+                    out << ReadValue<double>(position);
+                    break;
+                case Pointer:
+                    out << reinterpret_cast<const void*>(ReadValue<uintptr_t>(position));
+                    break;
+                case String: {
+                    uint32_t length = ReadValue<uint32_t>(position);
+                    size_t index = position & (kCapacity - 1);
+                    size_t first = std::min<size_t>(length, kCapacity - index);
+                    out.write(data.get() + index, static_cast<std::streamsize>(first));
+                    out.write(data.get(), static_cast<std::streamsize>(length - first));
+                    position += length;
+                    break;
+                }
+                default:
+                    position = end;  // Cannot happen unless the buffer is corrupt
+                    break;
+            }
+        }
+        if (header.flags & kTruncated) {
+            out << " [truncated]";
+        }
+        head.store(end, std::memory_order_release);
+    }
+
+    /**
+     * @brief Formats the oldest committed message into out and removes it, like Format().
+     * @details For the fatal signal handler: no allocation, no streams, no locale. Doubles are
+     * written with up to six decimals. A message longer than capacity is cut off.
+     * @return The number of characters written.
+     */
+    size_t FormatRaw(char* out, size_t capacity) {
+        char* cursor = out;
+        char* limit = out + capacity;
+        size_t position = head.load(std::memory_order_relaxed);
+        MessageHeader header;
+        Read(position, &header, sizeof(header));
+        size_t end = position + header.size;
+        position += sizeof(header);
+        while (position < end) {
+            uint8_t type;
+            Read(position, &type, sizeof(type));
+            position += sizeof(type);
+            switch (type) {
+                case Bool:
+                    PutRaw(cursor, limit, ReadValue<bool>(position) ? "1" : "0", 1);
+                    break;
+                case Char: {
+                    char value = ReadValue<char>(position);
+                    PutRaw(cursor, limit, &value, 1);
+                    break;
+                }
+                case Int64: {
+                    int64_t value = ReadValue<int64_t>(position);
+                    if (value < 0) {
+                        PutRaw(cursor, limit, "-", 1);
+                    }
+                    PutUnsigned(cursor, limit, value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value), 10);
+                    break;
+                }
+                case UInt64:
+                    PutUnsigned(cursor, limit, ReadValue<uint64_t>(position), 10);
+                    break;
+                case Double:
+                    PutDouble(cursor, limit, ReadValue<double>(position));
+                    break;
+                case Pointer:
+                    PutRaw(cursor, limit, "0x", 2);
+                    PutUnsigned(cursor, limit, ReadValue<uintptr_t>(position), 16);
+                    break;
+                case String: {
+                    uint32_t length = ReadValue<uint32_t>(position);
+                    size_t index = position & (kCapacity - 1);
+                    size_t first = std::min<size_t>(length, kCapacity - index);
+                    PutRaw(cursor, limit, data.get() + index, first);
+                    PutRaw(cursor, limit, data.get(), length - first);
+                    position += length;
+                    break;
+                }
+                default:
+                    position = end;  // Cannot happen unless the buffer is corrupt
+                    break;
+            }
+        }
+        if (header.flags & kTruncated) {
+            PutRaw(cursor, limit, " [truncated]", 12);
+        }
+        head.store(end, std::memory_order_release);
+        return static_cast<size_t>(cursor - out);
+    }
+
+    bool Empty() const {
+        return head.load(std::memory_order_relaxed) == tail.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Makes the producer drop instead of waiting for space; set when the logger thread stops.
+     */
+    void Close() { closed.store(true, std::memory_order_relaxed); }
+
+    /**
+     * @brief Set when the producer thread exits; the logger frees the buffer once it is drained.
+     */
+    void Retire() { retired.store(true, std::memory_order_release); }
+    bool Retired() const { return retired.load(std::memory_order_acquire); }
+
+private:
+    template<typename T>
+    void AppendValue(ArgType type, T value) {
+        if (Reserve(sizeof(type) + sizeof(value))) {
+            Write(pending, &type, sizeof(type));
+            Write(pending + sizeof(type), &value, sizeof(value));
+            pending += sizeof(type) + sizeof(value);
+        }
+    }
+
+    void AppendString(std::string_view value) {
+        ArgType type = String;
+        size_t room = kCapacity - (pending == messageStart ? sizeof(MessageHeader) : pending - messageStart);
+        if (sizeof(type) + sizeof(uint32_t) + value.size() > room && room > sizeof(type) + sizeof(uint32_t)) {
+            value = value.substr(0, room - sizeof(type) - sizeof(uint32_t));  // Keep what fits
+            messageFlags |= kTruncated;
+        }
+        uint32_t length = static_cast<uint32_t>(value.size());
+        if (Reserve(sizeof(type) + sizeof(length) + length)) {
+            Write(pending, &type, sizeof(type));
+            Write(pending + sizeof(type), &length, sizeof(length));
+            Write(pending + sizeof(type) + sizeof(length), value.data(), length);
+            pending += sizeof(type) + sizeof(length) + length;
+        }
+    }
+
+    void Begin() {
+        pending = messageStart + sizeof(MessageHeader);
+        WaitForSpace();
+    }
+
+    // Makes room for size more bytes of the current message, waiting for the logger thread if the
+    // ring is full; false if they do not fit even into an empty ring
+    bool Reserve(size_t size) {
+        if (pending == messageStart) {
+            Begin();
+        }
+        if (pending + size - messageStart > kCapacity) {
+            messageFlags |= kTruncated;
+            return false;
+        }
+        pending += size;
+        bool reserved = WaitForSpace();
+        pending -= size;
+        if (!reserved) {
+            messageFlags |= kTruncated;
+        }
+        return reserved;
+    }
+
+    bool WaitForSpace() {
+        while (pending - head.load(std::memory_order_acquire) > kCapacity) {
+            if (closed.load(std::memory_order_relaxed)) {
+                return false;
+            }
+            std::this_thread::yield();
+        }
+        return true;
+    }
+
+    // Building blocks of FormatRaw(), they stop at limit
+    static void PutRaw(char*& cursor, char* limit, const char* text, size_t size) {
+        size = std::min(size, static_cast<size_t>(limit - cursor));
+        std::memcpy(cursor, text, size);
+        cursor += size;
+    }
+
+    static void PutUnsigned(char*& cursor, char* limit, uint64_t value, unsigned base) {
+        char digits[24];
+        size_t count = 0;
+        do {
+            digits[sizeof(digits) - ++count] = "0123456789abcdef"[value % base];
+            value /= base;
+        } while (value != 0);
+        PutRaw(cursor, limit, digits + sizeof(digits) - count, count);
+    }
+
+    static void PutDouble(char*& cursor, char* limit, double value) {
+        if (value != value) {
+            PutRaw(cursor, limit, "nan", 3);
+            return;
+        }
+        if (value < 0) {
+            PutRaw(cursor, limit, "-", 1);
+            value = -value;
+        }
+        if (value > 1.7976931348623157e308) {
+            PutRaw(cursor, limit, "inf", 3);
+            return;
+        }
+        unsigned exponent = 0;  // Scientific notation only where the integer part would overflow
+        if (value >= 1e18) {
+            while (value >= 10) {
+                value /= 10;
+                ++exponent;
+            }
+        }
+        uint64_t whole = static_cast<uint64_t>(value);
+        uint64_t fraction = static_cast<uint64_t>((value - static_cast<double>(whole)) * 1e6 + 0.5);
+        if (fraction >= 1000000) {
+            ++whole;
+            fraction -= 1000000;
+        }
+        PutUnsigned(cursor, limit, whole, 10);
+        if (fraction != 0) {
+            char decimals[7] = {'.'};
+            size_t count = 6;
+            for (size_t i = 6; i > 0; --i) {
+                decimals[i] = static_cast<char>('0' + fraction % 10);
+                fraction /= 10;
+            }
+            while (decimals[count] == '0') {
+                --count;
+            }
+            PutRaw(cursor, limit, decimals, count + 1);
+        }
+        if (exponent != 0) {
+            PutRaw(cursor, limit, "e+", 2);
+            PutUnsigned(cursor, limit, exponent, 10);
+        }
+    }
+
+    template<typename T>
+    T ReadValue(size_t& position) const {
+        T value;
+        Read(position, &value, sizeof(value));
+        position += sizeof(value);
+        return value;
+    }
+
+    void Write(size_t position, const void* source, size_t size) {
+        size_t index = position & (kCapacity - 1);
+        size_t first = std::min(size, kCapacity - index);
+        std::memcpy(data.get() + index, source, first);
+        std::memcpy(data.get(), static_cast<const char*>(source) + first, size - first);
+    }
+
+    void Read(size_t position, void* target, size_t size) const {
+        size_t index = position & (kCapacity - 1);
+        size_t first = std::min(size, kCapacity - index);
+        std::memcpy(target, data.get() + index, first);
+        std::memcpy(static_cast<char*>(target) + first, data.get(), size - first);
+    }
+
+    std::unique_ptr<char[]> data;
+
+    // Producer side: start of the message being composed and where its next argument goes
+    size_t messageStart = 0;
+    size_t pending = 0;
+    uint16_t messageFlags = 0;
+    uint8_t messageLevel = kDefaultLevel;
+
+    alignas(64) std::atomic<size_t> tail{0};  // End of the committed messages
+    alignas(64) std::atomic<size_t> head{0};  // Start of the oldest message not yet formatted
+    std::atomic<bool> closed{false};
+    std::atomic<bool> retired{false};
+};
+
+#endif // LOGBUFFER_H
@@ -0,0 +1,71 @@
+#ifndef PLUGINAPI_H
+#define PLUGINAPI_H
+
+#include <cstdint>
+#include "IPlugin.h"
+
+class IEventService;
+class ILoggerService;
+class IExecutorService;
+
+/**
+ * Entry point of plugins built as shared libraries, see IPluginService::LoadPlugins().
+ *
+ * A plugin library exports one unmangled function, ApertusPluginEntry, returning a static
+ * ApertusPluginInfo. The host checks apiVersion before touching anything else, creates the plugin
+ * through create() and hands it back to destroy(), so it is allocated and freed by the same module.
+ * Use APERTUS_PLUGIN() instead of writing the entry point by hand.
+ *
+ * A text file named like the library with the extension .plugin may sit next to it. Its line
+ * "activate=<topic> <topic> ..." keeps the library unloaded until the first event on one of the
+ * topics; it is read without loading the library. "process=isolated" runs the plugin in a child
+ * process, which receives the topics of "subscribe=<topic> ..." and may publish topics matching
+ * "publish=<pattern> ..." (default "#").
+ */
+
+#define APERTUS_PLUGIN_API_VERSION 6  // Raised whenever IPlugin or the services change layout
+
+#if defined(_WIN32)
+#define APERTUS_PLUGIN_EXPORT __declspec(dllexport)
+#else
+#define APERTUS_PLUGIN_EXPORT __attribute__((visibility("default")))
+#endif
+
+extern "C" {
+
+struct ApertusPluginServices {
+    uint32_t apiVersion;
+    IEventService* eventService;
+    ILoggerService* logger;
+    IExecutorService* executor;
+};
+
+struct ApertusPluginInfo {
+    uint32_t apiVersion;
+    const char* name;
+    IPlugin* (*create)(const ApertusPluginServices* services);
+    void (*destroy)(IPlugin* plugin);
+};
+
+typedef const ApertusPluginInfo* (*ApertusPluginEntryFunction)(void);
+
+}
+
+#define APERTUS_PLUGIN_ENTRY_NAME "ApertusPluginEntry"
+
+/**
+ * Defines the entry point for PluginClass, constructed as PluginClass(eventService, logger, executor).
+ */
+#define APERTUS_PLUGIN(PluginClass, pluginName)                                                     \
+    extern "C" APERTUS_PLUGIN_EXPORT const ApertusPluginInfo* ApertusPluginEntry() {               \
+        static const ApertusPluginInfo info = {                                                     \
+            APERTUS_PLUGIN_API_VERSION,                                                             \
+            pluginName,                                                                             \
+            [](const ApertusPluginServices* services) -> IPlugin* {                                 \
+                return new PluginClass(services->eventService, services->logger, services->executor); \
+            },                                                                                      \
+            [](IPlugin* plugin) { delete plugin; }};                                                \
+        return &info;                                                                               \
+    }
+
+#endif // PLUGINAPI_H
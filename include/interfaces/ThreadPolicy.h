@@ -0,0 +1,26 @@
+#ifndef THREADPOLICY_H
+#define THREADPOLICY_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @struct ThreadPolicy
+ * @brief How a thread is created and scheduled, see IConfigService::GetThreadPolicy().
+ * @details The default leaves everything to the system. Settings the system refuses, such as a
+ * real-time priority without CAP_SYS_NICE, are reported and the thread runs without them.
+ */
+struct ThreadPolicy {
+    size_t stackSize = 0;       // Bytes, 0 for the system default (8 MB on most Linux systems)
+    std::vector<int> cpus;      // CPUs the thread may run on, empty for all of them
+    int nice = 0;               // -20 (favored) to 19, for normally scheduled threads; 0 keeps the creator's
+    int realtimePriority = 0;   // 1 to 99 runs the thread with SCHED_FIFO, nice is ignored then
+    std::string name;           // Shown by top and debuggers; at most 15 characters on Linux
+
+    bool IsDefault() const {
+        return stackSize == 0 && cpus.empty() && nice == 0 && realtimePriority == 0 && name.empty();
+    }
+};
+
+#endif // THREADPOLICY_H
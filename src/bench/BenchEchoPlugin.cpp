@@ -0,0 +1,24 @@
+#include "core/plugin/Plugin.h"
+#include "interfaces/PluginApi.h"
+
+// Answers every bench/ping with a bench/pong carrying the same payload; loaded by apertus_plugin_bench
+class BenchEchoPlugin : public Plugin {
+public:
+    BenchEchoPlugin(IEventService* eventService, ILoggerService* logger, IExecutorService* executor)
+        : Plugin(eventService, logger, executor), pongTopic(eventService->RegisterTopic("bench/pong")) {}
+
+    void Init() override {
+        Plugin::Init();
+        subscribe("bench/ping", [this](const std::string& payload) {
+            eventService->Trigger(pongTopic, payload);
+        });
+    }
+
+    std::string GetName() const override { return "BenchEchoPlugin"; }
+    std::thread::id GetThreadId() const override { return std::this_thread::get_id(); }
+
+private:
+    IEventService::TopicId pongTopic;
+};
+
+APERTUS_PLUGIN(BenchEchoPlugin, "BenchEchoPlugin")
@@ -0,0 +1,109 @@
+#include "event/EventService.h"
+#include "logger/LoggerService.h"
+
+// std
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+// Measures EventService::Trigger() throughput with a growing number of publishing threads.
+// Usage: apertus_event_bench [events per producer] [dispatcher workers]
+// With more than one worker every producer publishes its own topic so the load spreads across shards.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+    double triggerSeconds;   // until every producer returned from its last Trigger()
+    double dispatchSeconds;  // until the subscriber saw every event
+    uint64_t waitP99;        // worst per-topic p99 queue wait, nanoseconds
+};
+
+Result RunContention(ILoggerService* logger, int producers, long eventsPerProducer, size_t workers) {
+    EventService eventService(logger);
+
+    std::atomic<long> received{0};
+    std::vector<IEventService::TopicId> topics;
+    for (int i = 0; i < (workers > 1 ? producers : 1); ++i) {
+        topics.push_back(eventService.RegisterTopic("Bench" + std::to_string(i)));
+        eventService.Subscribe(topics.back(), [&received](const std::string&) {
+            received.fetch_add(1, std::memory_order_relaxed);
+        });
+    }
+    eventService.Start(workers);
+
+    const long total = producers * eventsPerProducer;
+    const std::string payload = "telemetry";
+
+    std::atomic<bool> go{false};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < producers; ++i) {
+        auto topic = topics[i % topics.size()];
+        threads.emplace_back([&, topic] {
+            while (!go) {
+                std::this_thread::yield();
+            }
+            for (long n = 0; n < eventsPerProducer; ++n) {
+                eventService.Trigger(topic, payload);
+            }
+        });
+    }
+
+    auto start = Clock::now();
+    go = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    auto triggered = Clock::now();
+    while (received.load(std::memory_order_relaxed) < total) {
+        std::this_thread::yield();
+    }
+    auto dispatched = Clock::now();
+
+    eventService.Stop();
+    uint64_t waitP99 = 0;
+    for (auto topic : topics) {
+        waitP99 = std::max(waitP99, eventService.GetTopicLatency(topic).queueWait.p99);
+    }
+    return {std::chrono::duration<double>(triggered - start).count(),
+            std::chrono::duration<double>(dispatched - start).count(),
+            waitP99};
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    long eventsPerProducer = argc > 1 ? std::atol(argv[1]) : 200000;
+    size_t workers = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1;
+    LoggerService logger;
+
+    std::vector<std::string> rows;
+    for (int producers : {1, 2, 4, 8, 16, 32}) {
+        Result result = RunContention(&logger, producers, eventsPerProducer, workers);
+        double total = static_cast<double>(producers) * eventsPerProducer;
+
+        std::ostringstream row;
+        row << std::setw(9) << producers
+            << std::setw(16) << std::fixed << std::setprecision(2) << total / result.triggerSeconds / 1e6
+            << std::setw(16) << total / result.dispatchSeconds / 1e6
+            << std::setw(14) << result.triggerSeconds * 1e9 / total
+            << std::setw(14) << result.waitP99 / 1000;
+        rows.push_back(row.str());
+    }
+
+    // Let the logger drain its startup/shutdown lines before printing the table
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    std::cout << "dispatcher workers: " << workers << std::endl;
+    std::cout << "producers  trigger Mev/s  dispatch Mev/s  ns/trigger  p99 wait us" << std::endl;
+    for (const auto& row : rows) {
+        std::cout << row << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,181 @@
+#include "config/ConfigService.h"
+#include "event/EventService.h"
+#include "executor/ExecutorService.h"
+#include "logger/LoggerService.h"
+#include "metrics/LatencyHistogram.h"
+#include "plugin/PluginLoader.h"
+#include "plugin/PluginService.h"
+
+// std
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+// Compares event round trips to a plugin in the same process and to one hosted in a child process.
+// Every round trip is a bench/ping into BenchEchoPlugin and the bench/pong it triggers in answer.
+// Usage: apertus_plugin_bench [round trips] [echo plugin library]
+// apertus_plugin_host must sit next to this executable or be set as isolation.host.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+#ifndef APERTUS_BENCH_ECHO_LIBRARY
+#define APERTUS_BENCH_ECHO_LIBRARY ""
+#endif
+
+// Pings in flight during the throughput run; well below the plugin's mailbox capacity
+constexpr long kWindow = 256;
+
+struct Result {
+    EventLatencyStats latency;  // One ping at a time, nanoseconds
+    double roundTripsPerSecond;  // kWindow pings in flight
+};
+
+// A directory with the echo library and a manifest that hosts it in or out of process
+std::string MakePluginDirectory(const std::string& library, bool isolated) {
+    char pattern[] = "/tmp/apertus-bench-XXXXXX";
+    if (::mkdtemp(pattern) == nullptr) {
+        return std::string();
+    }
+    std::string directory = pattern;
+    std::string link = directory + "/bench_echo" + PluginLoader::kLibrarySuffix;
+    if (::symlink(library.c_str(), link.c_str()) != 0) {
+        return std::string();
+    }
+    std::ofstream manifest(directory + "/bench_echo" + PluginLoader::kManifestSuffix);
+    if (isolated) {
+        manifest << "process=isolated" << std::endl;
+        manifest << "subscribe=bench/ping" << std::endl;
+    }
+    return directory;
+}
+
+void RemovePluginDirectory(const std::string& directory) {
+    ::unlink((directory + "/bench_echo" + PluginLoader::kLibrarySuffix).c_str());
+    ::unlink((directory + "/bench_echo" + PluginLoader::kManifestSuffix).c_str());
+    ::rmdir(directory.c_str());
+}
+
+bool RunTransport(ILoggerService* logger, const std::string& library, bool isolated, long roundTrips, Result& result) {
+    std::string directory = MakePluginDirectory(library, isolated);
+    if (directory.empty()) {
+        std::cerr << "Cannot create a plugin directory" << std::endl;
+        return false;
+    }
+
+    ConfigService config;
+    ExecutorService executor(logger, size_t(0));
+    EventService eventService(logger);
+    eventService.Start();
+
+    auto pingTopic = eventService.RegisterTopic("bench/ping");
+    auto pongTopic = eventService.RegisterTopic("bench/pong");
+    std::atomic<long> pongs{0};
+    eventService.Subscribe(pongTopic, [&pongs](const std::string&) {
+        pongs.fetch_add(1, std::memory_order_release);
+    });
+
+    bool loaded;
+    {
+        PluginService pluginService(&eventService, logger, &executor, &config);
+        loaded = pluginService.LoadPlugins(directory) == 1;
+        pluginService.InitPlugins();
+        loaded = loaded && !pluginService.GetStartupReport().empty() && pluginService.GetStartupReport().front().initialized;
+
+        const std::string payload = "ping";
+        auto waitFor = [&pongs](long count) {
+            auto deadline = Clock::now() + std::chrono::seconds(5);
+            while (pongs.load(std::memory_order_acquire) < count) {
+                if (Clock::now() > deadline) {
+                    return false;
+                }
+                std::this_thread::yield();
+            }
+            return true;
+        };
+
+        // Latency: one ping at a time, after a warm-up
+        LatencyHistogram latency;
+        long sent = 0;
+        for (long i = 0; loaded && i < roundTrips + roundTrips / 10; ++i) {
+            uint64_t start = LatencyHistogram::Now();
+            eventService.Trigger(pingTopic, payload);
+            loaded = waitFor(++sent);
+            if (i >= roundTrips / 10) {
+                latency.Record(LatencyHistogram::Now() - start);
+            }
+        }
+        result.latency = latency.Snapshot();
+
+        // Throughput: keep a window of pings in flight
+        auto start = Clock::now();
+        long target = sent + roundTrips;
+        while (loaded && sent < target) {
+            if (sent - pongs.load(std::memory_order_acquire) < kWindow) {
+                eventService.Trigger(pingTopic, payload);
+                ++sent;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        loaded = loaded && waitFor(target);
+        result.roundTripsPerSecond = roundTrips / std::chrono::duration<double>(Clock::now() - start).count();
+
+        pluginService.StopPlugins();
+    }
+    eventService.Stop();
+    executor.Stop();
+    RemovePluginDirectory(directory);
+    if (!loaded) {
+        std::cerr << "Echo plugin did not answer " << (isolated ? "out of process" : "in process") << std::endl;
+    }
+    return loaded;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    long roundTrips = argc > 1 ? std::atol(argv[1]) : 20000;
+    std::string library = argc > 2 ? argv[2] : APERTUS_BENCH_ECHO_LIBRARY;
+    if (library.empty()) {
+        std::cerr << "Usage: " << argv[0] << " [round trips] <echo plugin library>" << std::endl;
+        return EXIT_FAILURE;
+    }
+    LoggerService logger;
+    logger.SetLevel(LogLevel::Warning);
+
+    std::vector<std::string> rows;
+    for (bool isolated : {false, true}) {
+        Result result{};
+        if (!RunTransport(&logger, library, isolated, roundTrips, result)) {
+            return EXIT_FAILURE;
+        }
+        std::ostringstream row;
+        row << std::left << std::setw(16) << (isolated ? "out of process" : "in process") << std::right << std::fixed << std::setprecision(1)
+            << std::setw(10) << result.latency.p50 / 1000.0
+            << std::setw(10) << result.latency.p90 / 1000.0
+            << std::setw(10) << result.latency.p99 / 1000.0
+            << std::setw(10) << result.latency.max / 1000.0
+            << std::setw(16) << std::setprecision(0) << result.roundTripsPerSecond;
+        rows.push_back(row.str());
+    }
+
+    // Let the logger drain its startup/shutdown lines before printing the table
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    std::cout << "round trips: " << roundTrips << ", window: " << kWindow << std::endl;
+    std::cout << "transport         p50 us    p90 us    p99 us    max us   round trips/s" << std::endl;
+    for (const auto& row : rows) {
+        std::cout << row << std::endl;
+    }
+    return 0;
+}
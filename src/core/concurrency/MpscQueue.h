@@ -0,0 +1,123 @@
+#ifndef MPSCQUEUE_H
+#define MPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/**
+ * @class MpscQueue
+ * @brief Bounded lock-free multi-producer/single-consumer ring.
+ * @details Each cell carries a sequence number (D. Vyukov's bounded queue), so producers only
+ * contend on a single fetch-and-increment of the enqueue position and never on a lock. TryPop()
+ * must only ever be called from one thread at a time. T must be default constructible and movable.
+ */
+template<typename T>
+class MpscQueue {
+public:
+    /**
+     * @param capacity Number of slots, rounded up to the next power of two.
+     */
+    explicit MpscQueue(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        mask = size - 1;
+        cells.reset(new Cell[size]);
+        for (size_t i = 0; i < size; ++i) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    /**
+     * @brief Appends a value; safe to call from any number of threads.
+     * @return false if the ring is full, in which case value is left untouched.
+     */
+    bool TryPush(T&& value) {
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &cells[pos & mask];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Removes the oldest value; consumer thread only.
+     * @return false if the ring is empty.
+     */
+    bool TryPop(T& value) {
+        size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        Cell* cell = &cells[pos & mask];
+        if (cell->sequence.load(std::memory_order_acquire) != pos + 1) {
+            return false;
+        }
+        value = std::move(cell->value);
+        cell->sequence.store(pos + mask + 1, std::memory_order_release);
+        dequeuePos.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * @brief True if the next TryPop() would fail; consumer thread only.
+     */
+    bool Empty() const {
+        size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        return cells[pos & mask].sequence.load(std::memory_order_acquire) != pos + 1;
+    }
+
+    /**
+     * @brief Number of pushes claimed so far; may be read from any thread.
+     */
+    size_t Pushed() const { return enqueuePos.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Number of values popped so far; may be read from any thread.
+     */
+    size_t Popped() const { return dequeuePos.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Approximate number of queued values; may be read from any thread.
+     */
+    size_t Size() const {
+        size_t pushed = Pushed();
+        size_t popped = Popped();
+        return pushed > popped ? pushed - popped : 0;
+    }
+
+    size_t Capacity() const { return mask + 1; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask;
+
+    // Keep the producer and consumer positions on separate cache lines
+    alignas(64) std::atomic<size_t> enqueuePos{0};
+    // Atomic only so statistics can be read from other threads; written by the consumer alone
+    alignas(64) std::atomic<size_t> dequeuePos{0};
+};
+
+#endif // MPSCQUEUE_H
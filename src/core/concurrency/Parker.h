@@ -0,0 +1,61 @@
+#ifndef PARKER_H
+#define PARKER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/**
+ * @class Parker
+ * @brief Wakeup primitive for one consumer thread polling lock-free queues.
+ * @details Producers pay a single atomic load in Unpark() unless the consumer is actually asleep;
+ * only then is the mutex taken to notify it. The consumer spins briefly before sleeping so bursts
+ * are picked up without a wakeup at all.
+ */
+class Parker {
+public:
+    /**
+     * @brief Blocks the consumer until ready() returns true.
+     * @param ready Checked before sleeping and after every wakeup, e.g. "queue not empty or stopping".
+     */
+    template<typename Predicate>
+    void Park(Predicate ready) {
+        for (int spin = 0; spin < kSpinCount; ++spin) {
+            if (ready()) {
+                return;
+            }
+            std::this_thread::yield();
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        parked.store(true, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        while (!ready()) {
+            condition.wait(lock);
+        }
+        parked.store(false, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Wakes the consumer if it is parked; call after publishing work.
+     */
+    void Unpark() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (parked.load(std::memory_order_seq_cst)) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+            }
+            condition.notify_one();
+        }
+    }
+
+private:
+    static constexpr int kSpinCount = 64;
+
+    std::atomic<bool> parked{false};
+    std::mutex mutex;
+    std::condition_variable condition;
+};
+
+#endif // PARKER_H
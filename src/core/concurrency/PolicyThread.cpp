@@ -0,0 +1,181 @@
+#include "PolicyThread.h"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <exception>
+#include <future>
+#include <memory>
+#include <system_error>
+#include <sched.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
+
+struct PolicyThread::Start {
+    ThreadPolicy policy;
+    std::function<void()> body;
+    std::promise<std::string> applied;
+};
+
+PolicyThread::PolicyThread(const ThreadPolicy& policy, std::function<void()> body) {
+    std::unique_ptr<Start> start(new Start{policy, std::move(body), {}});
+    std::future<std::string> applied = start->applied.get_future();
+
+    pthread_attr_t attributes;
+    pthread_attr_init(&attributes);
+    std::string stackError;
+    if (policy.stackSize != 0) {
+        // Some systems want whole pages, all of them at least PTHREAD_STACK_MIN
+        size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        size_t size = std::max(policy.stackSize, static_cast<size_t>(PTHREAD_STACK_MIN));
+        size = (size + page - 1) / page * page;
+        if (int error = pthread_attr_setstacksize(&attributes, size)) {
+            stackError = std::string("stack size: ") + std::strerror(error);
+        }
+    }
+    int error = pthread_create(&handle, &attributes, &PolicyThread::Entry, start.get());
+    pthread_attr_destroy(&attributes);
+    if (error != 0) {
+        throw std::system_error(error, std::generic_category(), "pthread_create");
+    }
+    start.release();  // Owned by the thread now
+    joinable = true;
+
+    policyError = applied.get();
+    if (!stackError.empty()) {
+        policyError = policyError.empty() ? stackError : stackError + "; " + policyError;
+    }
+}
+
+PolicyThread::~PolicyThread() {
+    Join();
+}
+
+PolicyThread::PolicyThread(PolicyThread&& other) noexcept
+    : handle(other.handle), joinable(other.joinable), policyError(std::move(other.policyError)) {
+    other.joinable = false;
+}
+
+PolicyThread& PolicyThread::operator=(PolicyThread&& other) noexcept {
+    if (this != &other) {
+        Join();
+        handle = other.handle;
+        joinable = other.joinable;
+        policyError = std::move(other.policyError);
+        other.joinable = false;
+    }
+    return *this;
+}
+
+bool PolicyThread::Joinable() const {
+    return joinable;
+}
+
+void PolicyThread::Join() {
+    if (joinable) {
+        pthread_join(handle, nullptr);
+        joinable = false;
+    }
+}
+
+const std::string& PolicyThread::PolicyError() const {
+    return policyError;
+}
+
+void* PolicyThread::Entry(void* argument) {
+    std::function<void()> body;
+    {
+        std::unique_ptr<Start> start(static_cast<Start*>(argument));
+        std::string error = ApplyToCurrentThread(start->policy);
+        body = std::move(start->body);
+        start->applied.set_value(std::move(error));
+    }
+    try {
+        body();
+    } catch (...) {
+        std::terminate();  // Like std::thread
+    }
+    return nullptr;
+}
+
+std::string PolicyThread::ApplyToCurrentThread(const ThreadPolicy& policy) {
+    std::string errors;
+    auto fail = [&errors](const std::string& what, int error) {
+        errors += (errors.empty() ? "" : "; ") + what + ": " + std::strerror(error);
+    };
+
+    if (!policy.name.empty()) {
+#if defined(__APPLE__)
+        pthread_setname_np(policy.name.c_str());
+#elif defined(__linux__)
+        if (int error = pthread_setname_np(pthread_self(), policy.name.substr(0, 15).c_str())) {
+            fail("name", error);
+        }
+#endif
+    }
+
+    if (!policy.cpus.empty()) {
+#if defined(__linux__)
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        for (int cpu : policy.cpus) {
+            if (cpu >= 0 && cpu < CPU_SETSIZE) {
+                CPU_SET(cpu, &cpus);
+            }
+        }
+        if (int error = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus)) {
+            fail("CPU affinity", error);
+        }
+#else
+        fail("CPU affinity", ENOTSUP);
+#endif
+    }
+
+    if (policy.realtimePriority > 0) {
+        sched_param parameters{};
+        parameters.sched_priority = policy.realtimePriority;
+        if (int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &parameters)) {
+            fail("SCHED_FIFO priority " + std::to_string(policy.realtimePriority), error);
+        }
+    } else if (policy.nice != 0) {
+#if defined(__linux__)
+        // Linux keeps the nice value per thread, addressed by its kernel thread id
+        if (::setpriority(PRIO_PROCESS, static_cast<id_t>(::syscall(SYS_gettid)), policy.nice) != 0) {
+            fail("nice " + std::to_string(policy.nice), errno);
+        }
+#else
+        fail("nice", ENOTSUP);
+#endif
+    }
+    return errors;
+}
+
+ThreadPolicy PolicyThread::Named(ThreadPolicy policy, const std::string& defaultName, int index) {
+    if (policy.name.empty()) {
+        policy.name = defaultName;
+    }
+    if (index >= 0) {
+        policy.name += "-" + std::to_string(index);
+    }
+    return policy;
+}
+
+uint64_t PolicyThread::CpuTime(clockid_t clock) {
+    timespec time{};
+    if (::clock_gettime(clock, &time) != 0) {
+        return 0;
+    }
+    return static_cast<uint64_t>(time.tv_sec) * 1000000000u + static_cast<uint64_t>(time.tv_nsec);
+}
+
+bool PolicyThread::CurrentCpuClock(clockid_t& clock) {
+#if defined(__linux__)
+    return pthread_getcpuclockid(pthread_self(), &clock) == 0;
+#else
+    (void)clock;
+    return false;
+#endif
+}
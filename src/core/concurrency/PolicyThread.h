@@ -0,0 +1,69 @@
+#ifndef POLICYTHREAD_H
+#define POLICYTHREAD_H
+
+#include "interfaces/ThreadPolicy.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <pthread.h>
+#include <time.h>
+
+/**
+ * @class PolicyThread
+ * @brief std::thread replacement that starts with a ThreadPolicy applied.
+ * @details The stack size can only be chosen when a thread is created, which std::thread does not
+ * allow. The other settings are applied by the new thread itself before body runs; the constructor
+ * waits for that, so PolicyError() is final once it returns. The destructor joins.
+ */
+class PolicyThread {
+public:
+    PolicyThread() = default;
+    PolicyThread(const ThreadPolicy& policy, std::function<void()> body);
+    ~PolicyThread();
+
+    PolicyThread(PolicyThread&& other) noexcept;
+    PolicyThread& operator=(PolicyThread&& other) noexcept;
+    PolicyThread(const PolicyThread&) = delete;
+    PolicyThread& operator=(const PolicyThread&) = delete;
+
+    bool Joinable() const;
+    void Join();
+
+    /**
+     * @brief The parts of the policy that could not be applied, empty if all of them were.
+     */
+    const std::string& PolicyError() const;
+
+    /**
+     * @brief Applies everything but the stack size to the calling thread.
+     * @return What could not be applied, empty on success.
+     */
+    static std::string ApplyToCurrentThread(const ThreadPolicy& policy);
+
+    /**
+     * @brief policy with defaultName if it has no name of its own; index numbers the threads of a pool.
+     */
+    static ThreadPolicy Named(ThreadPolicy policy, const std::string& defaultName, int index = -1);
+
+    /**
+     * @brief CPU time used so far, in nanoseconds; by default that of the calling thread.
+     * @param clock A clock from CurrentCpuClock(), to read another thread's while it exists.
+     */
+    static uint64_t CpuTime(clockid_t clock = CLOCK_THREAD_CPUTIME_ID);
+
+    /**
+     * @brief The CPU time clock of the calling thread, readable from other threads.
+     * @return false where threads cannot read each other's clocks.
+     */
+    static bool CurrentCpuClock(clockid_t& clock);
+
+private:
+    struct Start;
+    static void* Entry(void* argument);
+
+    pthread_t handle{};
+    bool joinable = false;
+    std::string policyError;
+};
+
+#endif // POLICYTHREAD_H
@@ -0,0 +1,112 @@
+#ifndef WORKSTEALINGDEQUE_H
+#define WORKSTEALINGDEQUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/**
+ * @class WorkStealingDeque
+ * @brief Bounded lock-free Chase-Lev deque of pointers.
+ * @details The owning thread pushes and pops at the bottom (LIFO, so its freshest and cache-hot
+ * work runs first); any other thread steals from the top (FIFO, the oldest work). Owner and thieves
+ * only contend on the very last element. Push() and Pop() must only be called by the owner.
+ */
+template<typename T>
+class WorkStealingDeque {
+public:
+    /**
+     * @param capacity Number of slots, rounded up to the next power of two.
+     */
+    explicit WorkStealingDeque(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        mask = size - 1;
+        slots.reset(new std::atomic<T*>[size]);
+        for (size_t i = 0; i < size; ++i) {
+            slots[i].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    /**
+     * @brief Adds an element at the bottom; owner thread only.
+     * @return false if the deque is full.
+     */
+    bool Push(T* value) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        if (b - t > static_cast<int64_t>(mask)) {
+            return false;
+        }
+        slots[static_cast<size_t>(b) & mask].store(value, std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Removes the newest element; owner thread only.
+     * @return nullptr if the deque is empty.
+     */
+    T* Pop() {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);  // Was empty
+            return nullptr;
+        }
+        T* value = slots[static_cast<size_t>(b) & mask].load(std::memory_order_relaxed);
+        if (t == b) {
+            // Last element, race the thieves for it
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                value = nullptr;
+            }
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return value;
+    }
+
+    /**
+     * @brief Removes the oldest element; safe to call from any thread.
+     * @return nullptr if the deque is empty or another thread got the element first.
+     */
+    T* Steal() {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b) {
+            return nullptr;
+        }
+        T* value = slots[static_cast<size_t>(t) & mask].load(std::memory_order_relaxed);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return value;
+    }
+
+    /**
+     * @brief Approximate number of elements; may be read from any thread.
+     */
+    size_t Size() const {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_relaxed);
+        return b > t ? static_cast<size_t>(b - t) : 0;
+    }
+
+private:
+    std::unique_ptr<std::atomic<T*>[]> slots;
+    size_t mask;
+
+    // Thieves only touch top, keep it away from the owner's bottom
+    alignas(64) std::atomic<int64_t> top{0};
+    alignas(64) std::atomic<int64_t> bottom{0};
+};
+
+#endif // WORKSTEALINGDEQUE_H
@@ -1,5 +1,180 @@
 #include "ConfigService.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <sched.h>
+
+namespace {
+// CPUs a thread can be pinned to, see PolicyThread
+#if defined(CPU_SETSIZE)
+constexpr int64_t kMaxCpus = CPU_SETSIZE;
+#else
+constexpr int64_t kMaxCpus = 1024;
+#endif
+
+std::string Trim(const std::string& text) {
+    size_t begin = text.find_first_not_of(" \t\r");
+    if (begin == std::string::npos) {
+        return std::string();
+    }
+    return text.substr(begin, text.find_last_not_of(" \t\r") - begin + 1);
+}
+
+bool ParseInt(const std::string& text, int64_t& value) {
+    if (text.empty()) {
+        return false;
+    }
+    char* end = nullptr;
+    long long parsed = std::strtoll(text.c_str(), &end, 10);
+    if (*end != '\0') {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+}
 
 void ConfigService::LoadConfig(const std::string& filename) {
     std::cout << "[ConfigService] Loading config: " << filename << std::endl;
+    std::ifstream file(filename);
+    if (!file) {
+        std::cerr << "[ConfigService] Cannot open config: " << filename << std::endl;
+        return;
+    }
+
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        line = Trim(line.substr(0, line.find('#')));
+        if (line.empty()) {
+            continue;
+        }
+        size_t separator = line.find('=');
+        if (separator == std::string::npos || Trim(line.substr(0, separator)).empty()) {
+            std::cerr << "[ConfigService] " << filename << ":" << lineNumber << ": expected key = value" << std::endl;
+            continue;
+        }
+        Set(Trim(line.substr(0, separator)), Trim(line.substr(separator + 1)));
+    }
+}
+
+void ConfigService::Set(const std::string& key, const std::string& value) {
+    std::lock_guard<std::mutex> lock(mutex);
+    values[key] = value;
+}
+
+bool ConfigService::Has(const std::string& key) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return values.count(key) != 0;
+}
+
+std::string ConfigService::GetString(const std::string& key, const std::string& defaultValue) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = values.find(key);
+    return it != values.end() ? it->second : defaultValue;
+}
+
+int64_t ConfigService::GetInt(const std::string& key, int64_t defaultValue) const {
+    int64_t value;
+    return ParseInt(GetString(key, std::string()), value) ? value : defaultValue;
+}
+
+bool ConfigService::FindThreadSetting(const std::string& component, const std::string& setting, std::string& value) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const std::string& key : {"thread." + component + "." + setting, "thread.default." + setting}) {
+        auto it = values.find(key);
+        if (it != values.end()) {
+            value = it->second;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ConfigService::HasThreadPolicy(const std::string& component) const {
+    const std::string prefix = "thread." + component + ".";
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& entry : values) {
+        if (entry.first.compare(0, prefix.size(), prefix) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+ThreadPolicy ConfigService::GetThreadPolicy(const std::string& component) const {
+    ThreadPolicy policy;
+    std::string value;
+    auto invalid = [&component](const std::string& setting, const std::string& text) {
+        std::cerr << "[ConfigService] Ignoring thread." << component << "." << setting << " = " << text << std::endl;
+    };
+
+    if (FindThreadSetting(component, "stack_size", value)) {
+        // 256k and 1m are easier to read than byte counts
+        int64_t size;
+        int64_t unit = 1;
+        std::string digits = value;
+        if (!digits.empty() && (digits.back() == 'k' || digits.back() == 'K')) {
+            unit = 1024;
+            digits.pop_back();
+        } else if (!digits.empty() && (digits.back() == 'm' || digits.back() == 'M')) {
+            unit = 1024 * 1024;
+            digits.pop_back();
+        }
+        if (ParseInt(digits, size) && size >= 0) {
+            policy.stackSize = static_cast<size_t>(size * unit);
+        } else {
+            invalid("stack_size", value);
+        }
+    }
+
+    if (FindThreadSetting(component, "cpus", value)) {
+        std::istringstream list(value);
+        std::string item;
+        while (std::getline(list, item, ',')) {
+            item = Trim(item);
+            size_t dash = item.find('-');
+            int64_t first;
+            int64_t last;
+            bool parsed = dash == std::string::npos
+                              ? ParseInt(item, first) && ParseInt(item, last)
+                              : ParseInt(Trim(item.substr(0, dash)), first) && ParseInt(Trim(item.substr(dash + 1)), last);
+            if (!parsed || first > last || last < 0 || first >= kMaxCpus) {
+                invalid("cpus", item);
+                continue;
+            }
+            // Clamped, so "0-99999999" cannot loop for long or allocate gigabytes
+            for (int64_t cpu = std::max<int64_t>(first, 0); cpu <= std::min(last, kMaxCpus - 1); ++cpu) {
+                policy.cpus.push_back(static_cast<int>(cpu));
+            }
+        }
+        std::sort(policy.cpus.begin(), policy.cpus.end());
+        policy.cpus.erase(std::unique(policy.cpus.begin(), policy.cpus.end()), policy.cpus.end());
+    }
+
+    int64_t number;
+    if (FindThreadSetting(component, "nice", value)) {
+        if (ParseInt(value, number) && number >= -20 && number <= 19) {
+            policy.nice = static_cast<int>(number);
+        } else {
+            invalid("nice", value);
+        }
+    }
+    if (FindThreadSetting(component, "realtime_priority", value)) {
+        if (ParseInt(value, number) && number >= 0 && number <= 99) {
+            policy.realtimePriority = static_cast<int>(number);
+        } else {
+            invalid("realtime_priority", value);
+        }
+    }
+
+    // A name only makes sense for the component it was given for
+    std::lock_guard<std::mutex> lock(mutex);
+    auto name = values.find("thread." + component + ".name");
+    if (name != values.end()) {
+        policy.name = name->second;
+    }
+    return policy;
 }
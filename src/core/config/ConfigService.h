@@ -3,12 +3,28 @@
 
 #include "interfaces/IConfigService.h"
 #include <iostream>
+#include <mutex>
+#include <unordered_map>
 #include <fruit/fruit.h>
 
 class ConfigService : public IConfigService {
 public:
     INJECT(ConfigService()) = default;
     void LoadConfig(const std::string& filename) override;
+
+    void Set(const std::string& key, const std::string& value) override;
+    bool Has(const std::string& key) const override;
+    std::string GetString(const std::string& key, const std::string& defaultValue) const override;
+    int64_t GetInt(const std::string& key, int64_t defaultValue) const override;
+    ThreadPolicy GetThreadPolicy(const std::string& component) const override;
+    bool HasThreadPolicy(const std::string& component) const override;
+
+private:
+    // thread.<component>.<setting>, else thread.default.<setting>; false if neither is set
+    bool FindThreadSetting(const std::string& component, const std::string& setting, std::string& value) const;
+
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, std::string> values;
 };
 
 #endif // CONFIGSERVICE_H
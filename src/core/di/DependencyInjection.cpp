@@ -1,9 +1,10 @@
 #include "DependencyInjection.h"
 
-fruit::Component<IEventService, ILoggerService, IConfigService, IPluginService> getApertusComponent() {
+fruit::Component<IEventService, ILoggerService, IConfigService, IPluginService, IExecutorService> getApertusComponent() {
     return fruit::createComponent()
         .bind<IEventService, EventService>()
         .bind<ILoggerService, LoggerService>()
         .bind<IConfigService, ConfigService>()
-        .bind<IPluginService, PluginService>();
+        .bind<IPluginService, PluginService>()
+        .bind<IExecutorService, ExecutorService>();
 }
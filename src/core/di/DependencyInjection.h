@@ -6,11 +6,13 @@
 #include "interfaces/ILoggerService.h"
 #include "interfaces/IConfigService.h"
 #include "interfaces/IPluginService.h"
+#include "interfaces/IExecutorService.h"
 #include "../event/EventService.h"
 #include "../logger/LoggerService.h"
 #include "../config/ConfigService.h"
 #include "../plugin/PluginService.h"
+#include "../executor/ExecutorService.h"
 
-fruit::Component<IEventService, ILoggerService, IConfigService, IPluginService> getApertusComponent();
+fruit::Component<IEventService, ILoggerService, IConfigService, IPluginService, IExecutorService> getApertusComponent();
 
 #endif // DEPENDENCYINJECTION_H
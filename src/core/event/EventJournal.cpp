@@ -0,0 +1,194 @@
+#include "EventJournal.h"
+#include "TopicRegistry.h"
+#include "metrics/LatencyHistogram.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+constexpr size_t kRecordAlignment = 8;
+
+size_t AlignRecord(size_t size) {
+    return (size + kRecordAlignment - 1) & ~(kRecordAlignment - 1);
+}
+}
+
+EventJournal::~EventJournal() {
+    Close();
+}
+
+bool EventJournal::Open(const std::string& path, size_t capacity, std::string& errorMessage) {
+    Close();
+
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        errorMessage = "cannot create " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    // Reserve the whole file now, so Append() never has to grow it
+    if (::ftruncate(fd, static_cast<off_t>(capacity)) != 0) {
+        errorMessage = "cannot size " + path + ": " + std::strerror(errno);
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+    void* mapping = ::mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        errorMessage = "cannot map " + path + ": " + std::strerror(errno);
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+
+    base = static_cast<char*>(mapping);
+    this->capacity = capacity;
+    openTime = LatencyHistogram::Now();
+    topicWritten.reset(new std::atomic<bool>[TopicRegistry::kMaxTopics]());
+    recorded = 0;
+    dropped = 0;
+    skipped = 0;
+
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.headerSize = static_cast<uint32_t>(AlignRecord(sizeof(Header)));
+    header.startTime = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    std::memcpy(base, &header, sizeof(header));
+    tail.store(header.headerSize);
+    return true;
+}
+
+void EventJournal::Close() {
+    if (base == nullptr) {
+        return;
+    }
+    size_t used = std::min(tail.load(), capacity);
+    ::msync(base, used, MS_SYNC);
+    ::munmap(base, capacity);
+    if (::ftruncate(fd, static_cast<off_t>(used)) != 0) {
+        // Keep the full-size file, the zero-filled rest reads as end of journal
+    }
+    ::close(fd);
+    base = nullptr;
+    fd = -1;
+}
+
+void EventJournal::Append(TopicId topic, const std::string& topicName, const EventPayload& payload, uint16_t flags) {
+    const std::string* param = payload.Get<std::string>();
+    if (param == nullptr && !payload.Empty()) {
+        skipped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    uint64_t time = LatencyHistogram::Now() - openTime;
+    if (topic < TopicRegistry::kMaxTopics && !topicWritten[topic].load(std::memory_order_relaxed) &&
+        !topicWritten[topic].exchange(true)) {
+        Write(TopicRecord, 0, topic, topicName.data(), topicName.size(), time);
+    }
+    if (Write(EventRecord, flags, topic, param ? param->data() : nullptr, param ? param->size() : 0, time)) {
+        recorded.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+bool EventJournal::Write(RecordType type, uint16_t flags, TopicId topic, const char* data, size_t dataSize, uint64_t time) {
+    size_t size = AlignRecord(sizeof(Record) + dataSize);
+    size_t offset = tail.fetch_add(size, std::memory_order_relaxed);
+    if (offset + size > capacity) {
+        return false;  // Full; the remaining bytes stay zero and end the journal
+    }
+
+    Record* record = reinterpret_cast<Record*>(base + offset);
+    record->type = type;
+    record->flags = flags;
+    record->topic = topic;
+    record->dataSize = static_cast<uint32_t>(dataSize);
+    record->time = time;
+    if (dataSize != 0) {
+        std::memcpy(record + 1, data, dataSize);
+    }
+    // Publish the record: size stays zero until everything else is in place
+    reinterpret_cast<std::atomic<uint32_t>*>(&record->size)->store(static_cast<uint32_t>(size), std::memory_order_release);
+    return true;
+}
+
+EventJournalReader::~EventJournalReader() {
+    if (base != nullptr) {
+        ::munmap(const_cast<char*>(base), size);
+    }
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+bool EventJournalReader::Open(const std::string& path, std::string& errorMessage) {
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        errorMessage = "cannot open " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    struct stat status;
+    if (::fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < sizeof(EventJournal::Header)) {
+        errorMessage = path + " is not an event journal";
+        return false;
+    }
+    size = static_cast<size_t>(status.st_size);
+    void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+        errorMessage = "cannot map " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    base = static_cast<const char*>(mapping);
+
+    EventJournal::Header header;
+    std::memcpy(&header, base, sizeof(header));
+    if (std::memcmp(header.magic, EventJournal::kMagic, sizeof(header.magic)) != 0 ||
+        header.version != EventJournal::kVersion || header.headerSize > size) {
+        errorMessage = path + " is not an event journal";
+        return false;
+    }
+
+    // Topic records may trail the first events of their topic, collect them all up front
+    for (size_t position = header.headerSize; const auto* record = RecordAt(position); position += record->size) {
+        if (record->type == EventJournal::TopicRecord) {
+            topicNames[record->topic].assign(reinterpret_cast<const char*>(record + 1), record->dataSize);
+        }
+    }
+    offset = header.headerSize;
+    return true;
+}
+
+bool EventJournalReader::Next(Event& event) {
+    while (const auto* record = RecordAt(offset)) {
+        offset += record->size;
+        if (record->type != EventJournal::EventRecord) {
+            continue;
+        }
+        auto name = topicNames.find(record->topic);
+        event.time = record->time;
+        event.topicName = name != topicNames.end() ? &name->second : &unknownTopic;
+        event.param.assign(reinterpret_cast<const char*>(record + 1), record->dataSize);
+        event.flags = record->flags;
+        return true;
+    }
+    return false;
+}
+
+const EventJournal::Record* EventJournalReader::RecordAt(size_t position) const {
+    if (position + sizeof(EventJournal::Record) > size) {
+        return nullptr;
+    }
+    const auto* record = reinterpret_cast<const EventJournal::Record*>(base + position);
+    if (record->size < sizeof(EventJournal::Record) || position + record->size > size ||
+        sizeof(EventJournal::Record) + record->dataSize > record->size) {
+        return nullptr;  // End of the journal, or a record cut short by a crash
+    }
+    return record;
+}
@@ -0,0 +1,143 @@
+#ifndef EVENTJOURNAL_H
+#define EVENTJOURNAL_H
+
+#include "interfaces/IEventService.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+/**
+ * @class EventJournal
+ * @brief Append-only, memory-mapped binary recording of triggered events.
+ * @details The file is sized up front and mapped once. Append() reserves its record with a single
+ * fetch_add on the write offset and copies into the mapping, so any number of publishing threads
+ * record without a lock or a system call. The record size is written last: a zero size marks the
+ * end of the journal, also in a file left behind by a crash.
+ *
+ * Layout: a Header, then 8-byte aligned records. Every topic is described by one TopicRecord
+ * holding its name before (or, under concurrency, close to) its first EventRecord; ids are only
+ * meaningful within one journal. Only string payloads are stored, events with typed payloads are
+ * counted as skipped.
+ */
+class EventJournal {
+public:
+    using TopicId = IEventService::TopicId;
+
+    static constexpr size_t kDefaultCapacity = size_t(64) << 20;
+
+    enum RecordType : uint16_t {
+        TopicRecord = 1,  // Data is the topic name
+        EventRecord = 2   // Data is the string payload
+    };
+
+    // EventRecord::flags
+    static constexpr uint16_t kSyncEvent = 1;    // Published with TriggerSync()
+    static constexpr uint16_t kNestedEvent = 2;  // Published from inside an event callback
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t headerSize;
+        uint64_t startTime;  // System clock at Open(), nanoseconds since the epoch
+    };
+
+    struct Record {
+        uint32_t size;   // Whole record including padding; written last
+        uint16_t type;
+        uint16_t flags;
+        uint32_t topic;
+        uint32_t dataSize;
+        uint64_t time;   // Nanoseconds since Open()
+    };
+
+    EventJournal() = default;
+    ~EventJournal();
+
+    EventJournal(const EventJournal&) = delete;
+    EventJournal& operator=(const EventJournal&) = delete;
+
+    /**
+     * @brief Creates or truncates the file and maps capacity bytes of it.
+     * @return false if the file cannot be created or mapped; errorMessage tells why.
+     */
+    bool Open(const std::string& path, size_t capacity, std::string& errorMessage);
+
+    /**
+     * @brief Unmaps the file and cuts it to the recorded size. No Append() may be running.
+     */
+    void Close();
+
+    /**
+     * @brief Records one event; thread-safe and lock-free.
+     * @details Events that do not fit the remaining capacity are counted as dropped.
+     */
+    void Append(TopicId topic, const std::string& topicName, const EventPayload& payload, uint16_t flags);
+
+    uint64_t Recorded() const { return recorded.load(std::memory_order_relaxed); }
+    uint64_t Dropped() const { return dropped.load(std::memory_order_relaxed); }
+    uint64_t Skipped() const { return skipped.load(std::memory_order_relaxed); }
+
+    static constexpr char kMagic[8] = {'A', 'P', 'X', 'J', 'R', 'N', 'L', '1'};
+    static constexpr uint32_t kVersion = 1;
+
+private:
+    bool Write(RecordType type, uint16_t flags, TopicId topic, const char* data, size_t dataSize, uint64_t time);
+
+    int fd = -1;
+    char* base = nullptr;
+    size_t capacity = 0;
+    uint64_t openTime = 0;
+
+    std::atomic<size_t> tail{0};
+    std::unique_ptr<std::atomic<bool>[]> topicWritten;  // Indexed by TopicId
+    std::atomic<uint64_t> recorded{0};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> skipped{0};
+};
+
+/**
+ * @class EventJournalReader
+ * @brief Reads a journal written by EventJournal, in recording order.
+ */
+class EventJournalReader {
+public:
+    struct Event {
+        uint64_t time = 0;  // Nanoseconds since the start of the recording
+        const std::string* topicName = nullptr;
+        std::string param;
+        uint16_t flags = 0;  // EventJournal::kSyncEvent, kNestedEvent
+    };
+
+    EventJournalReader() = default;
+    ~EventJournalReader();
+
+    EventJournalReader(const EventJournalReader&) = delete;
+    EventJournalReader& operator=(const EventJournalReader&) = delete;
+
+    /**
+     * @brief Maps the file and collects the topic names.
+     * @return false if the file cannot be read or is not a journal; errorMessage tells why.
+     */
+    bool Open(const std::string& path, std::string& errorMessage);
+
+    /**
+     * @brief Reads the next event.
+     * @return false at the end of the journal.
+     */
+    bool Next(Event& event);
+
+private:
+    const EventJournal::Record* RecordAt(size_t offset) const;
+
+    int fd = -1;
+    const char* base = nullptr;
+    size_t size = 0;
+    size_t offset = 0;
+    std::unordered_map<uint32_t, std::string> topicNames;
+    std::string unknownTopic;
+};
+
+#endif // EVENTJOURNAL_H
@@ -1,78 +1,1111 @@
 #include "EventService.h"
+#include <algorithm>
 #include <iostream>
 
-EventService::EventService(ILoggerService* logger)
-    : logger(logger) {}
+namespace {
+// Set on dispatcher threads so Trigger() can tell when it is called from a callback
+thread_local const EventService* currentDispatcher = nullptr;
 
-void EventService::Subscribe(const std::string& eventName, EventCallback callback) {
-    std::lock_guard<std::mutex> lock(eventMutex);
-    subscribers[eventName].push_back(callback);
+// Nesting depth of inline callbacks on this thread
+thread_local int inlineDepth = 0;
+
+// Events published by this thread, for picking the ones whose latency is measured
+thread_local uint32_t publishedEvents = 0;
+
+std::atomic<uint64_t> nextInstanceId{1};
+}
+
+EventService::EventService(ILoggerService* logger, IConfigService* config)
+    : EventService(logger, config->GetThreadPolicy("event"), config->GetThreadPolicy("timer")) {}
+
+EventService::EventService(ILoggerService* logger, const ThreadPolicy& eventPolicy, const ThreadPolicy& timerPolicy)
+    : logger(logger),
+      logCategory(&logger->Category("EventService")),
+      subscriberTable(std::make_shared<const SubscriberTable>()),
+      instanceId(nextInstanceId.fetch_add(1)),
+      eventPolicy(eventPolicy),
+      timerPolicy(timerPolicy),
+      timers(TimerWheel::Clock::now()),
+      shards(new std::unique_ptr<Shard>[kMaxWorkers]) {
+    // Events triggered before Start() are buffered in the first shard
+    shards[0].reset(new Shard());
+}
+
+EventService::TopicId EventService::RegisterTopic(const std::string& eventName) {
+    TopicId topic = topics.Register(eventName);
+    if (topic >= matchedTopics.load()) {
+        // New topic, attach the wildcard subscriptions matching it before anyone can trigger it
+        std::lock_guard<std::mutex> lock(subscriberMutex);
+        std::shared_ptr<SubscriberTable> table;
+        MatchPatterns(table);
+        if (table) {
+            PublishSubscribers(std::move(table));
+        }
+    }
+    return topic;
+}
+
+const std::string& EventService::GetTopicName(TopicId topic) const {
+    return topics.Get(topic).name;
+}
+
+void EventService::SetTopicPriority(TopicId topic, EventPriority priority) {
+    topics.Get(topic).priority.store(priority, std::memory_order_relaxed);
+}
+
+EventLaneStats EventService::GetLaneStats(EventPriority priority) const {
+    size_t lane = static_cast<size_t>(priority);
+    EventLaneStats stats;
+    size_t workerCount = shardCount.load(std::memory_order_acquire);
+    for (size_t i = 0; i < workerCount; ++i) {
+        const Shard& shard = *shards[i];
+        stats.enqueued += shard.lanes[lane].Pushed();
+        stats.dispatched += shard.lanes[lane].Popped();
+        stats.depth += shard.lanes[lane].Size();
+        stats.maxDepth = std::max<uint64_t>(stats.maxDepth, shard.maxDepth[lane].load(std::memory_order_relaxed));
+    }
+    return stats;
+}
+
+void EventService::SetTopicPolicy(TopicId topic, DeliveryPolicy policy, size_t maxPending) {
+    TopicInfo& info = topics.Get(topic);
+    info.maxPending.store(maxPending, std::memory_order_relaxed);
+    info.policy.store(policy, std::memory_order_relaxed);
+}
+
+void EventService::SetTopicActivator(TopicId topic, Activator activator) {
+    std::shared_ptr<TopicActivator> previous;
+    {
+        std::lock_guard<std::mutex> lock(activatorMutex);
+        auto it = activators.find(topic);
+        if (it != activators.end()) {
+            previous = std::move(it->second);
+            activators.erase(it);
+        }
+        bool pending = static_cast<bool>(activator);
+        if (pending) {
+            auto entry = std::make_shared<TopicActivator>();
+            entry->activate = std::move(activator);
+            activators[topic] = std::move(entry);
+        }
+        topics.Get(topic).activatorPending.store(pending, std::memory_order_release);
+    }
+    if (previous) {
+        Release(*previous, true);  // Nothing would queue what it holds anymore
+    }
+}
+
+bool EventService::Hold(TopicId topic, TopicInfo& info, Event& event) {
+    std::shared_ptr<TopicActivator> activator;
+    {
+        std::lock_guard<std::mutex> lock(activatorMutex);
+        auto it = activators.find(topic);
+        if (it == activators.end()) {
+            return false;
+        }
+        activator = it->second;
+    }
+    {
+        std::lock_guard<std::mutex> lock(activator->mutex);
+        if (activator->done) {
+            return false;
+        }
+        activator->held.push_back(std::move(event));
+        if (activator->started) {
+            return true;
+        }
+        activator->started = true;
+    }
+
+    // The first event starts the activation; done queues it and everything held after it
+    std::weak_ptr<TopicActivator> weak = activator;
+    try {
+        activator->activate([this, topic, weak] {
+            auto entry = weak.lock();
+            if (!entry) {
+                return;  // Removed, SetTopicActivator() queued the events
+            }
+            Release(*entry, true);
+            std::lock_guard<std::mutex> lock(activatorMutex);
+            auto it = activators.find(topic);
+            if (it != activators.end() && it->second == entry) {
+                activators.erase(it);
+                topics.Get(topic).activatorPending.store(false, std::memory_order_release);
+            }
+        });
+    } catch (const std::exception& e) {
+        APX_LOG_ERROR(logger, logCategory) << "[EventService]::Hold() Activator of " << info.name << " failed: " << e.what() << std::endl;
+        Release(*activator, false);
+    } catch (...) {
+        APX_LOG_ERROR(logger, logCategory) << "[EventService]::Hold() Activator of " << info.name << " encountered an unknown error!" << std::endl;
+        Release(*activator, false);
+    }
+    return true;
+}
+
+void EventService::Release(TopicActivator& activator, bool done) {
+    // Queued in batches without the lock, Enqueue() may wait for a dispatcher that publishes to the
+    // topic itself. Meanwhile new events still line up behind the held ones, so none overtakes them.
+    {
+        std::lock_guard<std::mutex> lock(activator.mutex);
+        if (activator.releasing || activator.done) {
+            return;
+        }
+        activator.releasing = true;
+    }
+    std::vector<Event> batch;
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> lock(activator.mutex);
+            if (activator.held.empty()) {
+                activator.releasing = false;
+                activator.done = done;
+                activator.started = false;  // Only matters if not done: the next event tries again
+                return;
+            }
+            batch.swap(activator.held);
+        }
+        for (Event& event : batch) {
+            if (Admit(topics.Get(event.topic), event)) {
+                Enqueue(event);
+            }
+        }
+        batch.clear();
+    }
+}
+
+EventTopicStats EventService::GetTopicStats(TopicId topic) const {
+    const TopicInfo& info = topics.Get(topic);
+    EventTopicStats stats;
+    stats.pending = static_cast<uint64_t>(std::max<int64_t>(0, info.pending.load(std::memory_order_relaxed)));
+    stats.dropped = info.dropped.load(std::memory_order_relaxed);
+    stats.coalesced = info.coalesced.load(std::memory_order_relaxed);
+    return stats;
+}
+
+EventTopicLatency EventService::GetTopicLatency(TopicId topic) const {
+    const TopicInfo& info = topics.Get(topic);
+    EventTopicLatency latency;
+    latency.queueWait = info.latency->queueWait.Snapshot();
+    latency.handler = info.latency->handler.Snapshot();
+    return latency;
+}
+
+std::vector<EventHandlerStats> EventService::GetHandlerStats(TopicId topic) const {
+    std::vector<EventHandlerStats> result;
+    auto table = std::atomic_load(&subscriberTable);
+    if (topic >= table->topics.size() || !table->topics[topic]) {
+        return result;
+    }
+    for (const auto& subscriber : *table->topics[topic]) {
+        EventHandlerStats stats;
+        stats.subscription = subscriber.id;
+        stats.calls = subscriber.stats->calls.load(std::memory_order_relaxed);
+        stats.slowCalls = subscriber.stats->slowCalls.load(std::memory_order_relaxed);
+        stats.totalTime = subscriber.stats->totalTime.load(std::memory_order_relaxed);
+        stats.maxTime = subscriber.stats->maxTime.load(std::memory_order_relaxed);
+        result.push_back(stats);
+    }
+    return result;
+}
+
+void EventService::SetSlowHandlerThreshold(std::chrono::nanoseconds threshold) {
+    slowHandlerThreshold.store(static_cast<uint64_t>(threshold.count()), std::memory_order_relaxed);
+}
+
+EventService::SubscriptionId EventService::Subscribe(const std::string& eventName, EventCallback callback) {
+    return Subscribe(RegisterTopic(eventName), std::move(callback));
+}
+
+EventService::SubscriptionId EventService::Subscribe(TopicId topic, EventCallback callback) {
+    // String subscribers only see string payloads
+    return SubscribePayload(topic, [callback = std::move(callback)](const EventPayload& payload) {
+        if (const std::string* param = payload.Get<std::string>()) {
+            callback(*param);
+        }
+    });
+}
+
+EventService::SubscriptionId EventService::SubscribePayload(TopicId topic, PayloadCallback callback) {
+    return AddSubscriber(topic, {0, std::move(callback)});
+}
+
+EventService::SubscriptionId EventService::SubscribeInline(TopicId topic, EventCallback callback) {
+    return SubscribePayloadInline(topic, [callback = std::move(callback)](const EventPayload& payload) {
+        if (const std::string* param = payload.Get<std::string>()) {
+            callback(*param);
+        }
+    });
+}
+
+EventService::SubscriptionId EventService::SubscribePayloadInline(TopicId topic, PayloadCallback callback) {
+    Subscriber subscriber{0, std::move(callback)};
+    subscriber.inlineSafe = true;
+    return AddSubscriber(topic, std::move(subscriber));
+}
+
+EventService::SubscriptionId EventService::Subscribe(TopicId topic, IEventMailbox* mailbox, const PayloadCallback* handler) {
+    return AddSubscriber(topic, {0, nullptr, mailbox, handler});
+}
+
+EventService::SubscriptionId EventService::SubscribePattern(const std::string& pattern, PatternCallback callback) {
+    PatternSubscription subscription;
+    subscription.callback = std::make_shared<const PatternCallback>(std::move(callback));
+    return AddPattern(pattern, std::move(subscription));
+}
+
+EventService::SubscriptionId EventService::SubscribePattern(const std::string& pattern, IEventMailbox* mailbox, const PayloadCallback* handler) {
+    PatternSubscription subscription;
+    subscription.mailbox = mailbox;
+    subscription.handler = handler;
+    return AddPattern(pattern, std::move(subscription));
+}
+
+EventService::SubscriptionId EventService::AddSubscriber(TopicId topic, Subscriber subscriber) {
+    std::lock_guard<std::mutex> lock(subscriberMutex);
+    auto table = std::make_shared<SubscriberTable>(*std::atomic_load(&subscriberTable));
+    SubscriptionId id = nextSubscriptionId++;
+    subscriber.id = id;
+    AttachSubscriber(*table, topic, std::move(subscriber));
+
+    subscriptionTopics.emplace(id, topic);
+    PublishSubscribers(std::move(table));
+    return id;
+}
+
+EventService::SubscriptionId EventService::AddPattern(const std::string& pattern, PatternSubscription subscription) {
+    TopicTrie::Validate(pattern);
+
+    std::lock_guard<std::mutex> lock(subscriberMutex);
+    std::shared_ptr<SubscriberTable> table;
+    MatchPatterns(table);  // Catch up first, so the loop below covers every registered topic
+    if (!table) {
+        table = std::make_shared<SubscriberTable>(*std::atomic_load(&subscriberTable));
+    }
+
+    SubscriptionId id = nextSubscriptionId++;
+    subscription.pattern = pattern;
+    size_t topicCount = matchedTopics.load();
+    for (size_t topic = 0; topic < topicCount; ++topic) {
+        if (TopicTrie::Matches(pattern, topics.Get(static_cast<TopicId>(topic)).name)) {
+            AttachSubscriber(*table, static_cast<TopicId>(topic), BindPattern(id, subscription, static_cast<TopicId>(topic)));
+            subscription.topics.push_back(static_cast<TopicId>(topic));
+        }
+    }
+    patterns.Insert(pattern, id);
+    patternSubscriptions.emplace(id, std::move(subscription));
+
+    PublishSubscribers(std::move(table));
+    return id;
 }
 
-void EventService::Unsubscribe(const std::string& eventName, EventCallback callback) {
-    // std::lock_guard<std::mutex> lock(eventMutex);
-    // if (subscribers.find(eventName) != subscribers.end()) {
-    //     auto& callbacks = subscribers[eventName];
-    //     callbacks.erase(std::remove(callbacks.begin(), callbacks.end(), callback), callbacks.end());
-    // }
+void EventService::MatchPatterns(std::shared_ptr<SubscriberTable>& table) {
+    // Caller holds subscriberMutex; table is created on the first change
+    size_t topicCount = topics.Size();
+    std::vector<TopicTrie::PatternId> matches;
+    for (size_t topic = matchedTopics.load(); topic < topicCount; ++topic) {
+        matches.clear();
+        patterns.Match(topics.Get(static_cast<TopicId>(topic)).name, matches);
+        for (auto id : matches) {
+            auto& subscription = patternSubscriptions.at(id);
+            if (!table) {
+                table = std::make_shared<SubscriberTable>(*std::atomic_load(&subscriberTable));
+            }
+            AttachSubscriber(*table, static_cast<TopicId>(topic), BindPattern(id, subscription, static_cast<TopicId>(topic)));
+            subscription.topics.push_back(static_cast<TopicId>(topic));
+        }
+    }
+    matchedTopics.store(topicCount);
+}
+
+void EventService::AttachSubscriber(SubscriberTable& table, TopicId topic, Subscriber subscriber) {
+    subscriber.stats = std::make_shared<HandlerStats>();
+    if (table.topics.size() <= topic) {
+        table.topics.resize(topic + 1);
+    }
+
+    auto& current = table.topics[topic];
+    auto list = current ? std::make_shared<std::vector<Subscriber>>(*current)
+                        : std::make_shared<std::vector<Subscriber>>();
+    list->push_back(std::move(subscriber));
+    current = std::move(list);
+}
+
+EventService::Subscriber EventService::BindPattern(SubscriptionId id, const PatternSubscription& subscription, TopicId topic) {
+    if (subscription.mailbox) {
+        return {id, nullptr, subscription.mailbox, subscription.handler};
+    }
+    return {id, [callback = subscription.callback, topic](const EventPayload& payload) {
+        (*callback)(topic, payload);
+    }};
+}
+
+void EventService::Unsubscribe(SubscriptionId subscription) {
+    uint64_t version;
+    {
+        std::lock_guard<std::mutex> lock(subscriberMutex);
+        std::vector<TopicId> subscribedTopics;
+        auto it = subscriptionTopics.find(subscription);
+        if (it != subscriptionTopics.end()) {
+            subscribedTopics.push_back(it->second);
+            subscriptionTopics.erase(it);
+        } else {
+            auto pattern = patternSubscriptions.find(subscription);
+            if (pattern == patternSubscriptions.end()) {
+                return;
+            }
+            patterns.Remove(pattern->second.pattern, subscription);
+            subscribedTopics = std::move(pattern->second.topics);
+            patternSubscriptions.erase(pattern);
+        }
+
+        auto table = std::make_shared<SubscriberTable>(*std::atomic_load(&subscriberTable));
+        for (TopicId topic : subscribedTopics) {
+            auto list = std::make_shared<std::vector<Subscriber>>(*table->topics[topic]);
+            list->erase(std::remove_if(list->begin(), list->end(),
+                                       [subscription](const Subscriber& s) { return s.id == subscription; }),
+                        list->end());
+            table->topics[topic] = std::move(list);
+        }
+        PublishSubscribers(std::move(table));
+        version = subscriberVersion.load();
+    }
+
+    if (currentDispatcher != this) {
+        WaitForDispatchers(version);
+    }
+}
+
+void EventService::PublishSubscribers(std::shared_ptr<const SubscriberTable> table) {
+    std::atomic_store(&subscriberTable, std::move(table));
+    subscriberVersion.fetch_add(1);
+}
+
+void EventService::WaitForDispatchers(uint64_t version) {
+    // A dispatcher is past the old table once it is idle or has picked up this version
+    size_t workerCount = shardCount.load(std::memory_order_acquire);
+    for (size_t i = 0; i < workerCount; ++i) {
+        Shard& shard = *shards[i];
+        while (shard.dispatching.load() && shard.observedVersion.load() < version) {
+            std::this_thread::yield();
+        }
+    }
+
+    // Same for threads inside TriggerSync(), unless we are one of them
+    if (inlineDepth == 0) {
+        std::lock_guard<std::mutex> lock(inlineSyncMutex);
+        uint64_t epoch = inlineEpoch.fetch_add(1);
+        while (inlineActive[epoch & 1].load() != 0) {
+            std::this_thread::yield();
+        }
+    }
 }
 
 void EventService::Trigger(const std::string& eventName, const std::string& param) {
+    Trigger(RegisterTopic(eventName), param);
+}
+
+void EventService::Trigger(TopicId topic, const std::string& param) {
+    TriggerPayload(topic, EventPayload::FromString(param));
+}
+
+EventService::TimerId EventService::TriggerAfter(std::chrono::nanoseconds delay, TopicId topic, const std::string& param) {
+    return TriggerPayloadAt(TimerWheel::Clock::now() + delay, std::chrono::nanoseconds(0), topic, EventPayload::FromString(param));
+}
+
+EventService::TimerId EventService::TriggerAt(std::chrono::steady_clock::time_point time, TopicId topic, const std::string& param) {
+    return TriggerPayloadAt(time, std::chrono::nanoseconds(0), topic, EventPayload::FromString(param));
+}
+
+EventService::TimerId EventService::TriggerEvery(std::chrono::nanoseconds period, TopicId topic, const std::string& param) {
+    return TriggerPayloadAt(TimerWheel::Clock::now() + period, period, topic, EventPayload::FromString(param));
+}
+
+EventService::TimerId EventService::TriggerPayloadAt(std::chrono::steady_clock::time_point time, std::chrono::nanoseconds period, TopicId topic, EventPayload payload) {
+    TimerWheel::Timer timer;
+    timer.deadline = time;
+    timer.period = period;
+    timer.topic = topic;
+    timer.payload = std::move(payload);
+    return AddTimer(std::move(timer));
+}
+
+EventService::TimerId EventService::AddTimer(TimerWheel::Timer timer) {
+    TimerId id = 0;
     {
-        std::lock_guard<std::mutex> lock(eventMutex);
-        eventQueue.push({eventName, param});
+        std::lock_guard<std::mutex> lock(timerMutex);
+        if (timer.request == 0) {
+            id = nextTimerId++;
+            timer.id = id;
+        }
+        timers.Insert(std::move(timer));
+    }
+    timerCondition.notify_one();  // The new timer may be due before the one the thread waits for
+    return id;
+}
+
+bool EventService::CancelTimer(TimerId timer) {
+    std::lock_guard<std::mutex> lock(timerMutex);
+    return timers.Cancel(timer);
+}
+
+std::future<EventPayload> EventService::Request(TopicId topic, EventPayload payload, std::chrono::nanoseconds timeout) {
+    std::promise<EventPayload> promise;
+    std::future<EventPayload> response = promise.get_future();
+    uint64_t id = requests.Add(promise);
+    if (id == 0) {
+        promise.set_exception(RequestTable::Error(RequestStatus::Overloaded));
+        return response;
+    }
+    SendRequest(id, topic, std::move(payload), timeout);
+    return response;
+}
+
+void EventService::Request(TopicId topic, EventPayload payload, ResponseCallback callback, std::chrono::nanoseconds timeout) {
+    uint64_t id = requests.Add(callback);
+    if (id == 0) {
+        APX_LOG_WARNING(logger, logCategory) << "[EventService]::Request() Too many pending requests, rejected request to " << GetTopicName(topic) << std::endl;
+        if (callback) {
+            callback(RequestStatus::Overloaded, EventPayload());
+        }
+        return;
+    }
+    SendRequest(id, topic, std::move(payload), timeout);
+}
+
+void EventService::SendRequest(uint64_t id, TopicId topic, EventPayload payload, std::chrono::nanoseconds timeout) {
+    if (timeout.count() > 0) {
+        // Left in the wheel when answered in time, completing an answered request is a no-op
+        TimerWheel::Timer timer;
+        timer.deadline = TimerWheel::Clock::now() + timeout;
+        timer.topic = topic;
+        timer.request = id;
+        AddTimer(std::move(timer));
     }
-    eventCondition.notify_one();  // Wake up the worker thread
+    payload.SetRequestId(id);
+    TriggerPayload(topic, std::move(payload));
+}
+
+bool EventService::Respond(const EventPayload& request, EventPayload response) {
+    return requests.Complete(request.RequestId(), RequestStatus::Ok, response);
 }
 
-void EventService::Start() {
-    (*logger) << "[EventService]::Start() Starting..." << std::endl;
+void EventService::TimerLoop() {
+    std::vector<TimerWheel::Timer> expired;
+    std::unique_lock<std::mutex> lock(timerMutex);
+    while (timersRunning) {
+        auto wakeup = timers.NextWakeup();
+        if (wakeup == TimerWheel::Clock::time_point::max()) {
+            timerCondition.wait(lock);
+        } else {
+            timerCondition.wait_until(lock, wakeup);
+        }
+        if (!timersRunning) {
+            break;
+        }
+
+        auto now = TimerWheel::Clock::now();
+        timers.Advance(now, expired);
+        for (const auto& timer : expired) {
+            if (timer.period.count() > 0) {
+                // Next deadline from the previous one, not from now, so the period does not drift
+                TimerWheel::Timer next = timer;
+                next.deadline += timer.period;
+                if (next.deadline <= now) {
+                    next.deadline += timer.period * ((now - next.deadline) / timer.period + 1);  // Stalled, skip missed periods
+                }
+                timers.Insert(std::move(next));
+            }
+        }
+
+        // Trigger without the lock, subscribers may schedule or cancel timers
+        lock.unlock();
+        for (auto& timer : expired) {
+            if (timer.request != 0) {
+                if (requests.Complete(timer.request, RequestStatus::Timeout, EventPayload())) {
+                    APX_LOG_WARNING(logger, logCategory) << "[EventService]::TimerLoop() Request to " << GetTopicName(timer.topic) << " timed out." << std::endl;
+                }
+            } else {
+                TriggerPayload(timer.topic, std::move(timer.payload));
+            }
+        }
+        expired.clear();
+        lock.lock();
+    }
+}
+
+void EventService::Record(TopicId topic, const EventPayload& payload, bool sync) {
+    // Announce first, then look again: StopRecording() clears the pointer before waiting for writers
+    journalWriters.fetch_add(1);
+    if (EventJournal* current = journal.load()) {
+        uint16_t flags = sync ? EventJournal::kSyncEvent : 0;
+        if (currentDispatcher == this || inlineDepth > 0) {
+            flags |= EventJournal::kNestedEvent;  // Replay re-creates these by running the callbacks
+        }
+        current->Append(topic, topics.Get(topic).name, payload, flags);
+    }
+    journalWriters.fetch_sub(1);
+}
+
+bool EventService::StartRecording(const std::string& path, size_t capacity) {
+    std::lock_guard<std::mutex> lock(journalMutex);
+    StopRecordingLocked();
+
+    auto recording = std::make_unique<EventJournal>();
+    std::string errorMessage;
+    if (!recording->Open(path, capacity, errorMessage)) {
+        APX_LOG_ERROR(logger, logCategory) << "[EventService]::StartRecording() Failed: " << errorMessage << std::endl;
+        return false;
+    }
+    journalOwner = std::move(recording);
+    journal.store(journalOwner.get());
+    APX_LOG_INFO(logger, logCategory) << "[EventService]::StartRecording() Recording events to " << path << std::endl;
+    return true;
+}
+
+void EventService::StopRecording() {
+    std::lock_guard<std::mutex> lock(journalMutex);
+    StopRecordingLocked();
+}
+
+void EventService::StopRecordingLocked() {
+    if (!journalOwner) {
+        return;
+    }
+    journal.store(nullptr);
+    while (journalWriters.load() != 0) {
+        std::this_thread::yield();
+    }
+    journalOwner->Close();
+    APX_LOG_INFO(logger, logCategory) << "[EventService]::StopRecording() Recorded " << journalOwner->Recorded() << " events, dropped "
+              << journalOwner->Dropped() << ", skipped " << journalOwner->Skipped() << " typed payloads" << std::endl;
+    journalOwner.reset();
+}
+
+size_t EventService::Replay(const std::string& path, bool originalSpeed) {
+    EventJournalReader reader;
+    std::string errorMessage;
+    if (!reader.Open(path, errorMessage)) {
+        APX_LOG_ERROR(logger, logCategory) << "[EventService]::Replay() Failed: " << errorMessage << std::endl;
+        return 0;
+    }
+
+    APX_LOG_INFO(logger, logCategory) << "[EventService]::Replay() Replaying " << path << (originalSpeed ? " at original speed" : " as fast as possible") << std::endl;
+    std::unordered_map<const std::string*, TopicId> topicIds;  // Journal topic name -> our handle
+    auto start = std::chrono::steady_clock::now();
+    size_t replayed = 0;
+    EventJournalReader::Event event;
+    while (reader.Next(event)) {
+        if ((event.flags & EventJournal::kNestedEvent) || event.topicName->empty()) {
+            continue;  // Triggered by a callback, which triggers it again now
+        }
+        auto it = topicIds.find(event.topicName);
+        if (it == topicIds.end()) {
+            it = topicIds.emplace(event.topicName, RegisterTopic(*event.topicName)).first;
+        }
+        if (originalSpeed) {
+            std::this_thread::sleep_until(start + std::chrono::nanoseconds(event.time));
+        }
+        if (event.flags & EventJournal::kSyncEvent) {
+            TriggerSync(it->second, event.param);
+        } else {
+            Trigger(it->second, event.param);
+        }
+        ++replayed;
+    }
+    APX_LOG_INFO(logger, logCategory) << "[EventService]::Replay() Replayed " << replayed << " events" << std::endl;
+    return replayed;
+}
+
+bool EventService::SampleLatency() {
+    return ++publishedEvents % kLatencySampleInterval == 0;
+}
+
+void EventService::TriggerPayload(TopicId topic, EventPayload payload) {
+    TopicInfo& info = topics.Get(topic);
+    if (journal.load(std::memory_order_relaxed) != nullptr) {
+        Record(topic, payload, false);
+    }
+    Event event{topic, std::move(payload)};
+    if (SampleLatency()) {
+        event.enqueueTime = LatencyHistogram::Now();
+    }
+    if (info.activatorPending.load(std::memory_order_acquire) && Hold(topic, info, event)) {
+        return;
+    }
+    if (Admit(info, event)) {
+        Enqueue(event);
+    }
+}
+
+void EventService::TriggerSync(TopicId topic, const std::string& param) {
+    TriggerPayloadSync(topic, EventPayload::FromString(param));
+}
+
+void EventService::TriggerPayloadSync(TopicId topic, EventPayload payload) {
+    if (inlineDepth >= kMaxInlineDepth) {
+        TriggerPayload(topic, std::move(payload));  // Re-entrant publishing, stop recursing here
+        return;
+    }
+    if (journal.load(std::memory_order_relaxed) != nullptr) {
+        Record(topic, payload, true);
+    }
+
+    Event event{topic, std::move(payload)};
+    TopicInfo& info = topics.Get(topic);
+    if (info.activatorPending.load(std::memory_order_acquire) && Hold(topic, info, event)) {
+        return;  // Queued at done, to all subscribers then; nothing runs inline
+    }
+    bool sampled = SampleLatency();
+    if (!InvokeInline(event, sampled)) {
+        // No queued subscribers. A latest-value event still queued must not deliver an older payload after this one.
+        if (info.policy.load(std::memory_order_relaxed) == DeliveryPolicy::CoalesceLatest) {
+            std::lock_guard<std::mutex> lock(info.latestMutex);
+            if (info.latestQueued) {
+                info.latest = std::move(event.payload);
+                info.latestInlineDone = true;
+                info.coalesced.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        return;
+    }
+
+    if (sampled) {
+        event.enqueueTime = LatencyHistogram::Now();
+    }
+    event.flags = kInlineDone;
+    if (Admit(info, event)) {
+        Enqueue(event);
+    }
+}
+
+bool EventService::InvokeInline(const Event& event, bool timed) {
+    // Subscriber table cached per publishing thread, refreshed when the version changes
+    struct Snapshot {
+        uint64_t owner = 0;
+        uint64_t version = 0;
+        std::shared_ptr<const SubscriberTable> table;
+    };
+    static thread_local Snapshot snapshot;
+
+    // Announce ourselves before reading the table, see WaitForDispatchers()
+    auto& active = inlineActive[inlineEpoch.load() & 1];
+    active.fetch_add(1);
+    struct Leave {
+        std::atomic<int64_t>& active;
+        ~Leave() {
+            --inlineDepth;
+            active.fetch_sub(1);
+        }
+    } leave{active};
+    ++inlineDepth;
+
+    uint64_t version = subscriberVersion.load();
+    if (snapshot.owner != instanceId || snapshot.version != version || !snapshot.table) {
+        snapshot.table = std::atomic_load(&subscriberTable);
+        snapshot.owner = instanceId;
+        snapshot.version = version;
+    }
+
+    bool queued = false;
+    const auto& lists = snapshot.table->topics;
+    if (event.topic < lists.size() && lists[event.topic]) {
+        const TopicInfo& info = topics.Get(event.topic);
+        uint64_t start = timed ? LatencyHistogram::Now() : 0;
+        for (const auto& subscriber : *lists[event.topic]) {
+            if (!subscriber.inlineSafe) {
+                queued = true;
+                continue;
+            }
+            subscriber.callback(event.payload);
+            if (!timed) {
+                continue;
+            }
+
+            uint64_t end = LatencyHistogram::Now();
+            RecordHandler(info, subscriber, end - start);
+#ifndef NDEBUG
+            if (std::chrono::nanoseconds(end - start) > kInlineBudget) {
+                APX_LOG_WARNING(logger, logCategory) << "[EventService]::TriggerSync() Inline callback for " << info.name << " blocked for "
+                          << (end - start) / 1000 << " us" << std::endl;
+            }
+#endif
+            start = end;
+        }
+    }
+    return queued;
+}
+
+bool EventService::Admit(TopicInfo& info, Event& event) {
+    DeliveryPolicy policy = info.policy.load(std::memory_order_relaxed);
+    if (policy == DeliveryPolicy::CoalesceLatest) {
+        std::lock_guard<std::mutex> lock(info.latestMutex);
+        info.latest = std::move(event.payload);
+        info.latestInlineDone = (event.flags & kInlineDone) != 0;
+        if (info.latestQueued) {
+            info.coalesced.fetch_add(1, std::memory_order_relaxed);
+            return false;  // The queued event will pick up the new payload
+        }
+        info.latestQueued = true;
+        info.pending.fetch_add(1, std::memory_order_relaxed);
+        event.flags = kCountedEvent | kLatestEvent;
+        return true;
+    }
+
+    int64_t maxPending = static_cast<int64_t>(info.maxPending.load(std::memory_order_relaxed));
+    if (maxPending == 0) {
+        return true;
+    }
+
+    if (policy == DeliveryPolicy::DropOldest) {
+        // Replaces the oldest backlog entry when full, never waits; only the first one needs a token
+        std::lock_guard<std::mutex> lock(info.latestMutex);
+        size_t displaced = info.backlog.Push({std::move(event.payload), event.enqueueTime, (event.flags & kInlineDone) != 0},
+                                             static_cast<size_t>(maxPending));
+        info.pending.fetch_add(1 - static_cast<int64_t>(displaced), std::memory_order_relaxed);
+        info.dropped.fetch_add(displaced, std::memory_order_relaxed);
+        if (info.backlog.queued) {
+            return false;
+        }
+        info.backlog.queued = true;
+        event.flags = kBacklogEvent;
+        return true;
+    } else {
+        while (info.pending.fetch_add(1, std::memory_order_relaxed) >= maxPending) {
+            info.pending.fetch_sub(1, std::memory_order_relaxed);
+            if (policy == DeliveryPolicy::DropNewest || currentDispatcher == this) {
+                // Blocking a dispatcher could wait for itself, drop instead
+                info.dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            std::this_thread::yield();  // Topic is full, let the dispatcher catch up
+        }
+    }
+    event.flags |= kCountedEvent;
+    return true;
+}
+
+bool EventService::Enqueue(Event& event) {
+    TopicInfo& info = topics.Get(event.topic);
+    size_t priority = static_cast<size_t>(info.priority.load(std::memory_order_relaxed));
+    for (;;) {
+        Shard* shard;
+        bool pushed;
+        if (routed.load(std::memory_order_acquire)) {
+            shard = &ShardOf(event.topic);
+            pushed = shard->lanes[priority].TryPush(std::move(event));
+        } else {
+            // Before Start(), which waits for us once it changed shardCount; never held while waiting for room
+            routingPublishers.fetch_add(1);
+            shard = shards[event.topic % shardCount.load()].get();
+            pushed = shard->lanes[priority].TryPush(std::move(event));
+            routingPublishers.fetch_sub(1);
+        }
+        if (pushed) {
+            shard->eventParker.Unpark();  // Wake up the worker thread only if it is parked
+            return true;
+        }
+        if (currentDispatcher == this) {
+            // Waiting here would wait for ourselves
+            APX_LOG_WARNING(logger, logCategory) << "[EventService]::Trigger() Queue full inside a callback, dropping event: " << info.name << std::endl;
+            if (event.flags & kCountedEvent) {
+                info.pending.fetch_sub(1, std::memory_order_relaxed);
+            }
+            if (event.flags & kLatestEvent) {
+                std::lock_guard<std::mutex> lock(info.latestMutex);
+                info.latestQueued = false;
+            }
+            if (event.flags & kBacklogEvent) {
+                std::lock_guard<std::mutex> lock(info.latestMutex);
+                info.backlog.queued = false;  // The entries stay, the next event of the topic queues a token
+            }
+            info.dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        std::this_thread::yield();  // Ring is full, let the dispatcher catch up
+    }
+}
+
+bool EventService::Accept(Event& event) {
+    if (!(event.flags & (kCountedEvent | kLatestEvent | kBacklogEvent))) {
+        return true;
+    }
+
+    TopicInfo& info = topics.Get(event.topic);
+    if (event.flags & kBacklogEvent) {
+        std::lock_guard<std::mutex> lock(info.latestMutex);
+        TopicBacklog::Entry entry;
+        if (!info.backlog.Pop(entry)) {
+            info.backlog.queued = false;
+            return false;
+        }
+        info.pending.fetch_sub(1, std::memory_order_relaxed);
+        event.payload = std::move(entry.payload);
+        event.enqueueTime = entry.enqueueTime;
+        event.flags = entry.inlineDone ? (kBacklogEvent | kInlineDone) : kBacklogEvent;
+        if (info.backlog.size != 0) {
+            event.flags |= kMoreBacklog;  // The token stays claimed, RequeueBacklog() puts it back
+        } else {
+            info.backlog.queued = false;
+        }
+        return true;
+    }
+
+    info.pending.fetch_sub(1, std::memory_order_relaxed);
+    if (event.flags & kLatestEvent) {
+        // Inline subscribers only run again if a plain Trigger() replaced what the inline pass delivered
+        std::lock_guard<std::mutex> lock(info.latestMutex);
+        event.payload = std::move(info.latest);
+        info.latest = EventPayload();
+        info.latestQueued = false;
+        event.flags = info.latestInlineDone ? (event.flags | kInlineDone) : (event.flags & ~kInlineDone);
+    }
+    return true;
+}
+
+void EventService::RequeueBacklog(Shard& shard, TopicId topic) {
+    // Behind the events queued meanwhile, so one topic's backlog does not hold up its lane
+    TopicInfo& info = topics.Get(topic);
+    auto& lane = shard.lanes[static_cast<size_t>(info.priority.load(std::memory_order_relaxed))];
+    Event token;
+    token.topic = topic;
+    token.flags = kBacklogEvent;
+    while (!lane.TryPush(std::move(token))) {
+        // Lane full: waiting would wait for ourselves, dispatch the next entry right away instead
+        if (!Accept(token)) {
+            return;
+        }
+        Dispatch(shard, token);
+        if (!(token.flags & kMoreBacklog)) {
+            return;
+        }
+        token = Event();
+        token.topic = topic;
+        token.flags = kBacklogEvent;
+    }
+}
+
+void EventService::Start(size_t workerCount) {
+    APX_LOG_DEBUG(logger, logCategory) << "[EventService]::Start() Starting..." << std::endl;
+    if (workerCount == 0) {
+        workerCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    workerCount = std::min(workerCount, kMaxWorkers);
+
+    if (workerCount > 1) {
+        for (size_t i = 1; i < workerCount; ++i) {
+            shards[i].reset(new Shard());
+        }
+
+        // Publishers route by the new count from here on; wait for those that may still use the old one
+        shardCount.store(workerCount);
+        while (routingPublishers.load() != 0) {
+            std::this_thread::yield();
+        }
+
+        // Events buffered before now go ahead of everything published since, on the shard that owns
+        // their topic. Shard 0 keeps receiving its own topics meanwhile; those stay behind in the lane.
+        Event event;
+        for (size_t lane = 0; lane < kEventPriorityCount; ++lane) {
+            auto& buffered = shards[0]->lanes[lane];
+            for (size_t left = buffered.Size(); left != 0 && buffered.TryPop(event); --left) {
+                ShardOf(event.topic).inherited.push_back(std::move(event));
+            }
+        }
+    }
+    routed.store(true, std::memory_order_release);
+
     running = true;
-    eventThread = std::thread(&EventService::EventLoop, this);
-    (*logger) << "[EventService]::Start() Started." << std::endl;
+    for (size_t i = 0; i < workerCount; ++i) {
+        Shard& shard = *shards[i];
+        shard.eventThread = PolicyThread(PolicyThread::Named(eventPolicy, "apx-event", static_cast<int>(i)), [this, &shard] { EventLoop(shard); });
+        if (!shard.eventThread.PolicyError().empty()) {
+            APX_LOG_WARNING(logger, logCategory) << "[EventService]::Start() Event thread policy not fully applied: " << shard.eventThread.PolicyError() << std::endl;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(timerMutex);
+        timersRunning = true;
+    }
+    timerThread = PolicyThread(PolicyThread::Named(timerPolicy, "apx-timer"), [this] { TimerLoop(); });
+    if (!timerThread.PolicyError().empty()) {
+        APX_LOG_WARNING(logger, logCategory) << "[EventService]::Start() Timer thread policy not fully applied: " << timerThread.PolicyError() << std::endl;
+    }
+    APX_LOG_INFO(logger, logCategory) << "[EventService]::Start() Started with " << workerCount << " worker(s)." << std::endl;
 }
 
 void EventService::Stop() {
-    (*logger) << "[EventService]::Stop() Notifying all threads to stop..." << std::endl;
-    // Notify all threads to stop
+    APX_LOG_DEBUG(logger, logCategory) << "[EventService]::Stop() Notifying all threads to stop..." << std::endl;
     {
-        std::lock_guard<std::mutex> lock(eventMutex);
-        running = false;
+        std::lock_guard<std::mutex> lock(timerMutex);
+        timersRunning = false;
+    }
+    timerCondition.notify_one();
+    timerThread.Join();  // No timer fires into a stopped service
+    // Nothing times out from here on, release whoever is still waiting
+    requests.CompleteAll(RequestStatus::Cancelled);
+
+    // Notify all threads to stop
+    running = false;
+    size_t workerCount = shardCount.load(std::memory_order_acquire);
+    for (size_t i = 0; i < workerCount; ++i) {
+        shards[i]->eventParker.Unpark();  // Wake up the worker threads to allow them to exit
+    }
+
+    for (size_t i = 0; i < workerCount; ++i) {
+        PolicyThread& eventThread = shards[i]->eventThread;
+        APX_LOG_DEBUG(logger, logCategory) << "[EventService]::Stop() Checking if event thread " << i << " should join:" << eventThread.Joinable() << std::endl;
+        if (eventThread.Joinable()) {
+            APX_LOG_DEBUG(logger, logCategory) << "[EventService]::Stop() Joining event thread " << i << "..." << std::endl;
+            eventThread.Join();
+            APX_LOG_DEBUG(logger, logCategory) << "[EventService]::Stop() Event thread " << i << " joined." << std::endl;
+        }
     }
-    eventCondition.notify_all();  // Wake up the worker thread to allow it to exit
+    APX_LOG_INFO(logger, logCategory) << "[EventService]::Stop() Stopped." << std::endl;
+}
 
-    (*logger) << "[EventService]::Stop() Checking if event thread should join:" << eventThread.joinable() << std::endl;
-    if (eventThread.joinable()) {
-        (*logger) << "[EventService]::Stop() Joining event thread..." << std::endl;
-        eventThread.join();
-        (*logger) << "[EventService]::Stop() Event thread joined." << std::endl;
+bool EventService::Empty(const Shard& shard) const {
+    if (!shard.inherited.empty()) {
+        return false;
+    }
+    for (const auto& lane : shard.lanes) {
+        if (!lane.Empty()) {
+            return false;
+        }
     }
-    (*logger) << "[EventService]::Stop() Stopped." << std::endl;
+    return true;
 }
 
-void EventService::EventLoop() {
-    while (running) {
-        std::unique_lock<std::mutex> lock(eventMutex);
-        eventCondition.wait(lock, [this] { return !running || !eventQueue.empty(); });
+bool EventService::Pop(Shard& shard, Event& event) {
+    constexpr size_t control = static_cast<size_t>(EventPriority::Control);
+    constexpr size_t normal = static_cast<size_t>(EventPriority::Normal);
+    constexpr size_t bulk = static_cast<size_t>(EventPriority::Bulk);
 
-        if (!running && eventQueue.empty()) {
-            break;
+    if (!shard.inherited.empty()) {
+        event = std::move(shard.inherited.front());
+        shard.inherited.pop_front();
+        return true;
+    }
+
+    // Control is strict priority, normal and bulk are weighted so bulk cannot starve
+    size_t order[kEventPriorityCount] = {control, normal, bulk};
+    if (shard.normalStreak >= kNormalLaneWeight) {
+        order[1] = bulk;
+        order[2] = normal;
+    }
+
+    for (size_t lane : order) {
+        size_t depth = shard.lanes[lane].Size();
+        if (shard.lanes[lane].TryPop(event)) {
+            if (depth > shard.maxDepth[lane].load(std::memory_order_relaxed)) {
+                shard.maxDepth[lane].store(depth, std::memory_order_relaxed);
+            }
+            if (lane == normal) {
+                ++shard.normalStreak;
+            } else if (lane == bulk) {
+                shard.normalStreak = 0;
+            }
+            return true;
+        }
+    }
+    shard.normalStreak = 0;
+    return false;
+}
+
+void EventService::Dispatch(Shard& shard, const Event& event) {
+    uint64_t version = subscriberVersion.load();
+    if (version != shard.snapshotVersion || !shard.snapshot) {
+        shard.snapshot = std::atomic_load(&subscriberTable);
+        shard.snapshotVersion = version;
+    }
+    shard.observedVersion.store(version, std::memory_order_release);
+
+    const auto& lists = shard.snapshot->topics;
+    if (event.topic >= lists.size() || !lists[event.topic]) {
+        return;
+    }
+
+    // Only sampled events carry an enqueue time, the others are dispatched without touching the clock
+    const TopicInfo* info = nullptr;
+    uint64_t start = 0;
+    if (event.enqueueTime != 0) {
+        info = &topics.Get(event.topic);
+        start = LatencyHistogram::Now();
+        info->latency->queueWait.Record(start - std::min(start, event.enqueueTime));
+    }
+
+    bool inlineDone = (event.flags & kInlineDone) != 0;
+    for (const auto& subscriber : *lists[event.topic]) {
+        if (inlineDone && subscriber.inlineSafe) {
+            continue;
+        }
+        if (subscriber.mailbox) {
+            TopicInfo& topic = topics.Get(event.topic);
+            switch (subscriber.mailbox->Deliver(event.topic, subscriber.handler, event.payload, topic.policy.load(std::memory_order_relaxed))) {
+            case MailboxDelivery::Dropped:
+                topic.dropped.fetch_add(1, std::memory_order_relaxed);
+                break;
+            case MailboxDelivery::Coalesced:
+                topic.coalesced.fetch_add(1, std::memory_order_relaxed);
+                break;
+            case MailboxDelivery::Queued:
+                break;
+            }
+        } else {
+            subscriber.callback(event.payload);
         }
 
-        // Process events
-        while (!eventQueue.empty()) {
-            auto event = eventQueue.front();
-            eventQueue.pop();
+        if (info) {
+            uint64_t end = LatencyHistogram::Now();
+            RecordHandler(*info, subscriber, end - start);
+            start = end;
+        }
+    }
+}
 
-            lock.unlock(); 
-            if (subscribers.find(event.first) != subscribers.end()) {
-                for (const auto& callback : subscribers[event.first]) {
-                    callback(event.second);
+void EventService::RecordHandler(const TopicInfo& info, const Subscriber& subscriber, uint64_t elapsed) {
+    info.latency->handler.Record(elapsed);
+
+    HandlerStats& stats = *subscriber.stats;
+    stats.calls.fetch_add(1, std::memory_order_relaxed);
+    stats.totalTime.fetch_add(elapsed, std::memory_order_relaxed);
+    uint64_t maxTime = stats.maxTime.load(std::memory_order_relaxed);
+    while (elapsed > maxTime && !stats.maxTime.compare_exchange_weak(maxTime, elapsed, std::memory_order_relaxed)) {
+    }
+
+    if (elapsed > slowHandlerThreshold.load(std::memory_order_relaxed)) {
+        uint64_t slowCalls = stats.slowCalls.fetch_add(1, std::memory_order_relaxed) + 1;
+        if ((slowCalls & (slowCalls - 1)) == 0) {
+            // Powers of two only, a handler that is always slow must not flood the log
+            APX_LOG_WARNING(logger, logCategory) << "[EventService]::Dispatch() Slow handler, subscription " << subscriber.id << " on " << info.name
+                      << " took " << elapsed / 1000 << " us (" << slowCalls << " slow calls)" << std::endl;
+        }
+    }
+}
+
+void EventService::EventLoop(Shard& shard) {
+    currentDispatcher = this;
+    Event event;
+    while (true) {
+        shard.eventParker.Park([this, &shard] { return !running || !Empty(shard); });
+
+        // Process events; the version check in Dispatch() must not be reordered before this store
+        shard.dispatching.store(true);
+        while (Pop(shard, event)) {
+            if (Accept(event)) {
+                Dispatch(shard, event);
+                if (event.flags & kMoreBacklog) {
+                    RequeueBacklog(shard, event.topic);
                 }
             }
-            lock.lock();
+            event.payload = EventPayload();  // Drop our reference, subscribers may still hold theirs
+        }
+        shard.dispatching.store(false);
+
+        if (!running) {
+            break;
         }
     }
 
-    (*logger) << "[EventService]::EventLoop() Exiting..." << std::endl;
+    APX_LOG_DEBUG(logger, logCategory) << "[EventService]::EventLoop() Exiting..." << std::endl;
 }
@@ -3,37 +3,278 @@
 
 #include "interfaces/IEventService.h"
 #include "interfaces/ILoggerService.h"
+#include "interfaces/IConfigService.h"
+#include "TopicRegistry.h"
+#include "TopicTrie.h"
+#include "EventJournal.h"
+#include "TimerWheel.h"
+#include "RequestTable.h"
+#include <condition_variable>
+#include "concurrency/MpscQueue.h"
+#include "concurrency/Parker.h"
+#include "concurrency/PolicyThread.h"
 #include <unordered_map>
 #include <vector>
+#include <deque>
 #include <functional>
 #include <mutex>
 #include <thread>
-#include <queue>
-#include <condition_variable>
 #include <atomic>
+#include <chrono>
 #include <fruit/fruit.h>
 
 class EventService : public IEventService {
 public:
-    INJECT(EventService(ILoggerService* logger));
+    INJECT(EventService(ILoggerService* logger, IConfigService* config));
+    explicit EventService(ILoggerService* logger, const ThreadPolicy& eventPolicy = ThreadPolicy(),
+                          const ThreadPolicy& timerPolicy = ThreadPolicy());
+
+    TopicId RegisterTopic(const std::string& eventName) override;
+    const std::string& GetTopicName(TopicId topic) const override;
+    void SetTopicPriority(TopicId topic, EventPriority priority) override;
+    EventLaneStats GetLaneStats(EventPriority priority) const override;
+    void SetTopicPolicy(TopicId topic, DeliveryPolicy policy, size_t maxPending = 0) override;
+    void SetTopicActivator(TopicId topic, Activator activator) override;
+    EventTopicStats GetTopicStats(TopicId topic) const override;
+    EventTopicLatency GetTopicLatency(TopicId topic) const override;
+    std::vector<EventHandlerStats> GetHandlerStats(TopicId topic) const override;
+    void SetSlowHandlerThreshold(std::chrono::nanoseconds threshold) override;
 
-    void Subscribe(const std::string& event, EventCallback callback) override;
-    void Unsubscribe(const std::string& event, EventCallback callback) override;
+    // Keep the typed template overloads visible next to the overrides
+    using IEventService::Subscribe;
+    using IEventService::Trigger;
+
+    SubscriptionId Subscribe(const std::string& event, EventCallback callback) override;
+    SubscriptionId Subscribe(TopicId topic, EventCallback callback) override;
+    SubscriptionId SubscribePayload(TopicId topic, PayloadCallback callback) override;
+    SubscriptionId SubscribeInline(TopicId topic, EventCallback callback) override;
+    SubscriptionId SubscribePayloadInline(TopicId topic, PayloadCallback callback) override;
+    SubscriptionId Subscribe(TopicId topic, IEventMailbox* mailbox, const PayloadCallback* handler) override;
+    SubscriptionId SubscribePattern(const std::string& pattern, PatternCallback callback) override;
+    SubscriptionId SubscribePattern(const std::string& pattern, IEventMailbox* mailbox, const PayloadCallback* handler) override;
+    void Unsubscribe(SubscriptionId subscription) override;
     void Trigger(const std::string& event, const std::string& param = "") override;
-    void Start() override;
+    void Trigger(TopicId topic, const std::string& param = "") override;
+    void TriggerPayload(TopicId topic, EventPayload payload) override;
+    void TriggerSync(TopicId topic, const std::string& param = "") override;
+    void TriggerPayloadSync(TopicId topic, EventPayload payload) override;
+    TimerId TriggerAfter(std::chrono::nanoseconds delay, TopicId topic, const std::string& param = "") override;
+    TimerId TriggerAt(std::chrono::steady_clock::time_point time, TopicId topic, const std::string& param = "") override;
+    TimerId TriggerEvery(std::chrono::nanoseconds period, TopicId topic, const std::string& param = "") override;
+    TimerId TriggerPayloadAt(std::chrono::steady_clock::time_point time, std::chrono::nanoseconds period, TopicId topic, EventPayload payload) override;
+    bool CancelTimer(TimerId timer) override;
+    std::future<EventPayload> Request(TopicId topic, EventPayload payload, std::chrono::nanoseconds timeout = std::chrono::seconds(1)) override;
+    void Request(TopicId topic, EventPayload payload, ResponseCallback callback, std::chrono::nanoseconds timeout = std::chrono::seconds(1)) override;
+    bool Respond(const EventPayload& request, EventPayload response) override;
+    bool StartRecording(const std::string& path, size_t capacity = EventJournal::kDefaultCapacity) override;
+    void StopRecording() override;
+    size_t Replay(const std::string& path, bool originalSpeed = true) override;
+    void Start(size_t workerCount = 1) override;
     void Stop() override;
 
+    // Slots in each worker's ingress ring per lane; Trigger() yields while the ring is full
+    static constexpr size_t kControlQueueCapacity = 1024;
+    static constexpr size_t kQueueCapacity = 8192;
+    static constexpr size_t kMaxWorkers = 64;
+
+    // Normal events dispatched in a row before a waiting bulk event gets its turn
+    static constexpr int kNormalLaneWeight = 8;
+
+    // Nesting depth of TriggerSync() inside inline callbacks before falling back to queueing
+    static constexpr int kMaxInlineDepth = 4;
+
+    // Debug builds log inline callbacks running longer than this
+    static constexpr std::chrono::microseconds kInlineBudget{200};
+
+    // One in this many events published by a thread is timed for the latency statistics; debug
+    // builds time all of them so every slow handler is reported
+#ifdef NDEBUG
+    static constexpr uint32_t kLatencySampleInterval = 8;
+#else
+    static constexpr uint32_t kLatencySampleInterval = 1;
+#endif
+
+    // Default of SetSlowHandlerThreshold()
+    static constexpr std::chrono::nanoseconds kSlowHandlerThreshold = std::chrono::milliseconds(1);
+
 private:
+    struct Event {
+        TopicId topic = 0;
+        EventPayload payload;
+        uint8_t flags = 0;
+        uint64_t enqueueTime = 0;  // LatencyHistogram::Now() when triggered, 0 if not sampled
+    };
+
+    // Event::flags
+    static constexpr uint8_t kCountedEvent = 1;  // Counted in TopicInfo::pending
+    static constexpr uint8_t kLatestEvent = 2;   // Payload is in TopicInfo::latest
+    static constexpr uint8_t kInlineDone = 4;    // Inline subscribers already ran in TriggerSync()
+    static constexpr uint8_t kBacklogEvent = 8;  // Token for TopicInfo::backlog, the payload is taken from there
+    static constexpr uint8_t kMoreBacklog = 16;  // Set by Accept(): the backlog has more entries, see RequeueBacklog()
+
     ILoggerService* logger;
+    LogCategory* logCategory;
+
+    TopicRegistry topics;
+
+    struct HandlerStats {
+        std::atomic<uint64_t> calls{0};
+        std::atomic<uint64_t> slowCalls{0};
+        std::atomic<uint64_t> totalTime{0};
+        std::atomic<uint64_t> maxTime{0};
+    };
+
+    struct Subscriber {
+        SubscriptionId id;
+        PayloadCallback callback;
+
+        // Set for mailbox subscriptions, callback is empty then
+        IEventMailbox* mailbox = nullptr;
+        const PayloadCallback* handler = nullptr;
+
+        // May run on the publishing thread, see SubscribeInline()
+        bool inlineSafe = false;
+
+        // Shared by all table snapshots, so the counters survive copy-on-write
+        std::shared_ptr<HandlerStats> stats{};
+    };
+
+    // Immutable once published; writers copy, modify and swap it in (RCU-style). Lists are shared
+    // between snapshots, so a copy only clones the outer vector and the one list being changed.
+    struct SubscriberTable {
+        std::vector<std::shared_ptr<const std::vector<Subscriber>>> topics;  // Indexed by TopicId
+    };
+
+    // Only accessed through std::atomic_load/std::atomic_store
+    std::shared_ptr<const SubscriberTable> subscriberTable;
+    std::atomic<uint64_t> subscriberVersion{0};
+
+    // Threads running inline callbacks, counted per epoch parity. Unsubscribe() flips the epoch and
+    // waits for the old parity to drain, so no inline caller still uses the previous table.
+    std::atomic<uint64_t> inlineEpoch{0};
+    std::atomic<int64_t> inlineActive[2] = {};
+    std::mutex inlineSyncMutex;
+
+    // Distinguishes instances in the per-thread snapshot cache of TriggerSync()
+    const uint64_t instanceId;
+
+    std::atomic<uint64_t> slowHandlerThreshold{static_cast<uint64_t>(kSlowHandlerThreshold.count())};
+
+    // Serializes writers, never taken by dispatch
+    std::mutex subscriberMutex;
+    std::unordered_map<SubscriptionId, TopicId> subscriptionTopics;
+    SubscriptionId nextSubscriptionId = 1;
+
+    // Wildcard subscriptions are expanded into ordinary per-topic subscribers (sharing the token)
+    // when either side is registered, so dispatch never looks at patterns
+    struct PatternSubscription {
+        std::string pattern;
+        std::shared_ptr<const PatternCallback> callback;
+        IEventMailbox* mailbox = nullptr;
+        const PayloadCallback* handler = nullptr;
+        std::vector<TopicId> topics;  // Topics it was expanded into
+    };
+    TopicTrie patterns;
+    std::unordered_map<SubscriptionId, PatternSubscription> patternSubscriptions;
+    std::atomic<size_t> matchedTopics{0};  // Topics below this have been matched against all patterns
+
+    // One ingress ring per lane and one dispatcher thread per worker, a topic always maps to the
+    // same shard and lane
+    struct Shard {
+        MpscQueue<Event> lanes[kEventPriorityCount] = {
+            MpscQueue<Event>(kControlQueueCapacity),
+            MpscQueue<Event>(kQueueCapacity),
+            MpscQueue<Event>(kQueueCapacity)};
+        std::atomic<size_t> maxDepth[kEventPriorityCount] = {};
+        int normalStreak = 0;
+
+        // Buffered in shard 0 before Start(), dispatched ahead of the lanes; filled by Start(), then dispatcher only
+        std::deque<Event> inherited;
+
+        Parker eventParker;
+        PolicyThread eventThread;
+
+        // Dispatcher-local copy of the subscriber table, refreshed when subscriberVersion changes
+        std::shared_ptr<const SubscriberTable> snapshot;
+        uint64_t snapshotVersion = 0;
+
+        // Read by Unsubscribe() to find out when the old table is no longer in use
+        std::atomic<bool> dispatching{false};
+        std::atomic<uint64_t> observedVersion{0};
+    };
+
+    // Set while recording; publishers announce themselves in journalWriters before using it, so
+    // StopRecording() can wait for them before closing the file
+    std::atomic<EventJournal*> journal{nullptr};
+    std::atomic<int> journalWriters{0};
+    std::mutex journalMutex;
+    std::unique_ptr<EventJournal> journalOwner;
+
+    // Applied to the dispatcher threads and the timer thread when Start() creates them
+    const ThreadPolicy eventPolicy;
+    const ThreadPolicy timerPolicy;
+
+    // Delayed and periodic events, fired by timerThread
+    TimerWheel timers;
+    TimerId nextTimerId = 1;
+    std::mutex timerMutex;
+    std::condition_variable timerCondition;
+    PolicyThread timerThread;
+    bool timersRunning = false;
+
+    // Requests waiting for Respond(), timed out by the timer thread
+    RequestTable requests;
+
+    // Pending SetTopicActivator() callbacks; TopicInfo::activatorPending keeps Trigger() from looking
+    struct TopicActivator {
+        Activator activate;
+        std::mutex mutex;  // Orders the held events before those published after done
+        bool started = false;
+        bool releasing = false;  // Queueing the held events, new ones still line up behind them
+        bool done = false;
+        std::vector<Event> held;  // Published while the activation runs
+    };
+    std::mutex activatorMutex;
+    std::unordered_map<TopicId, std::shared_ptr<TopicActivator>> activators;
+
+    std::unique_ptr<std::unique_ptr<Shard>[]> shards;
+    std::atomic<size_t> shardCount{1};
+    std::atomic<bool> running{false};
+
+    // Until Start() has fixed shardCount, publishers announce themselves while they route an event,
+    // so Start() can wait for those still using the old count before it moves shard 0's events
+    std::atomic<bool> routed{false};
+    std::atomic<int> routingPublishers{0};
 
-    std::unordered_map<std::string, std::vector<EventCallback>> subscribers;
-    std::queue<std::pair<std::string, std::string>> eventQueue;
-    std::mutex eventMutex;
-    std::condition_variable eventCondition;
-    std::thread eventThread;
-    std::atomic<bool> running;
+    Shard& ShardOf(TopicId topic) {
+        return *shards[topic % shardCount.load(std::memory_order_acquire)];
+    }
 
-    void EventLoop();
+    SubscriptionId AddSubscriber(TopicId topic, Subscriber subscriber);
+    SubscriptionId AddPattern(const std::string& pattern, PatternSubscription subscription);
+    void MatchPatterns(std::shared_ptr<SubscriberTable>& table);
+    static void AttachSubscriber(SubscriberTable& table, TopicId topic, Subscriber subscriber);
+    static Subscriber BindPattern(SubscriptionId id, const PatternSubscription& subscription, TopicId topic);
+    void PublishSubscribers(std::shared_ptr<const SubscriberTable> table);
+    void WaitForDispatchers(uint64_t version);
+    bool Enqueue(Event& event);
+    bool Admit(TopicInfo& info, Event& event);
+    bool Hold(TopicId topic, TopicInfo& info, Event& event);  // True if the event waits for an activation
+    void Release(TopicActivator& activator, bool done);
+    bool Accept(Event& event);
+    void RequeueBacklog(Shard& shard, TopicId topic);  // Dispatcher only, after an event with kMoreBacklog
+    bool Empty(const Shard& shard) const;
+    bool Pop(Shard& shard, Event& event);
+    void Dispatch(Shard& shard, const Event& event);
+    bool InvokeInline(const Event& event, bool timed);
+    void Record(TopicId topic, const EventPayload& payload, bool sync);
+    void StopRecordingLocked();
+    static bool SampleLatency();
+    void RecordHandler(const TopicInfo& info, const Subscriber& subscriber, uint64_t elapsed);
+    void EventLoop(Shard& shard);
+    TimerId AddTimer(TimerWheel::Timer timer);
+    void SendRequest(uint64_t id, TopicId topic, EventPayload payload, std::chrono::nanoseconds timeout);
+    void TimerLoop();
 };
 
 #endif // EVENTSERVICE_H
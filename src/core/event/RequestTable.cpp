@@ -0,0 +1,124 @@
+#include "RequestTable.h"
+#include <utility>
+
+namespace {
+constexpr uint64_t kIndexMask = 0xffffffffu;
+
+const char* StatusMessage(RequestStatus status) {
+    switch (status) {
+        case RequestStatus::Ok:
+            return "request answered";
+        case RequestStatus::Timeout:
+            return "request timed out";
+        case RequestStatus::Overloaded:
+            return "too many pending requests";
+        case RequestStatus::Cancelled:
+            return "event service stopped";
+    }
+    return "request failed";
+}
+}
+
+RequestTable::RequestTable(size_t capacity)
+    : slots(new Slot[capacity]), capacity(capacity) {
+    for (size_t i = 0; i < capacity; ++i) {
+        slots[i].nextFree.store(i + 1 < capacity ? static_cast<uint32_t>(i + 2) : 0, std::memory_order_relaxed);
+    }
+    freeHead.store(capacity != 0 ? 1 : 0);
+}
+
+uint64_t RequestTable::Add(ResponseCallback& callback) {
+    Slot* slot = Acquire();
+    if (slot == nullptr) {
+        return 0;
+    }
+    slot->callback = std::move(callback);
+    return Publish(*slot);
+}
+
+uint64_t RequestTable::Add(std::promise<EventPayload>& promise) {
+    Slot* slot = Acquire();
+    if (slot == nullptr) {
+        return 0;
+    }
+    slot->promise.emplace(std::move(promise));
+    return Publish(*slot);
+}
+
+RequestTable::Slot* RequestTable::Acquire() {
+    uint64_t head = freeHead.load(std::memory_order_acquire);
+    for (;;) {
+        uint32_t index = static_cast<uint32_t>(head & kIndexMask);
+        if (index == 0) {
+            return nullptr;
+        }
+        uint64_t next = ((head >> 32) + 1) << 32 | slots[index - 1].nextFree.load(std::memory_order_relaxed);
+        if (freeHead.compare_exchange_weak(head, next, std::memory_order_acquire, std::memory_order_acquire)) {
+            return &slots[index - 1];
+        }
+    }
+}
+
+uint64_t RequestTable::Publish(Slot& slot) {
+    if (++slot.generation == 0) {
+        slot.generation = 1;  // Keep ids non-zero
+    }
+    uint64_t id = uint64_t(slot.generation) << 32 | static_cast<uint64_t>(&slot - slots.get());
+    pending.fetch_add(1, std::memory_order_relaxed);
+    slot.id.store(id, std::memory_order_release);  // The continuation is in place
+    return id;
+}
+
+void RequestTable::Release(uint32_t index) {
+    uint64_t head = freeHead.load(std::memory_order_relaxed);
+    for (;;) {
+        slots[index].nextFree.store(static_cast<uint32_t>(head & kIndexMask), std::memory_order_relaxed);
+        uint64_t next = ((head >> 32) + 1) << 32 | (index + 1);
+        if (freeHead.compare_exchange_weak(head, next, std::memory_order_release, std::memory_order_relaxed)) {
+            return;
+        }
+    }
+}
+
+bool RequestTable::Complete(uint64_t id, RequestStatus status, const EventPayload& response) {
+    uint64_t index = id & kIndexMask;
+    if (id == 0 || index >= capacity) {
+        return false;
+    }
+    Slot& slot = slots[index];
+    uint64_t expected = id;
+    if (!slot.id.compare_exchange_strong(expected, 0, std::memory_order_acq_rel)) {
+        return false;  // Already answered, timed out, or the slot was reused
+    }
+
+    // Take the continuation out and free the slot before running it, it may issue a new request
+    ResponseCallback callback = std::move(slot.callback);
+    slot.callback = nullptr;
+    std::optional<std::promise<EventPayload>> promise = std::move(slot.promise);
+    slot.promise.reset();
+    pending.fetch_sub(1, std::memory_order_relaxed);
+    Release(static_cast<uint32_t>(index));
+
+    if (promise) {
+        if (status == RequestStatus::Ok) {
+            promise->set_value(response);
+        } else {
+            promise->set_exception(Error(status));
+        }
+    } else if (callback) {
+        callback(status, status == RequestStatus::Ok ? response : EventPayload());
+    }
+    return true;
+}
+
+std::exception_ptr RequestTable::Error(RequestStatus status) {
+    return std::make_exception_ptr(RequestError(status, StatusMessage(status)));
+}
+
+void RequestTable::CompleteAll(RequestStatus status) {
+    for (size_t i = 0; i < capacity; ++i) {
+        if (uint64_t id = slots[i].id.load(std::memory_order_acquire)) {
+            Complete(id, status, EventPayload());
+        }
+    }
+}
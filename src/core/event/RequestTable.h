@@ -0,0 +1,82 @@
+#ifndef REQUESTTABLE_H
+#define REQUESTTABLE_H
+
+#include "interfaces/IEventService.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <optional>
+
+/**
+ * @class RequestTable
+ * @brief Fixed-size table of pending requests, see IEventService::Request().
+ * @details Slots are allocated once and handed out from a lock-free free list. A correlation id is
+ * the slot index in the low 32 bits and a per-slot generation in the high 32 bits, so a late or
+ * duplicate response to a recycled slot is recognized and ignored. Completing a request is a single
+ * compare-and-swap on the slot's id: the first of response, timeout and shutdown wins.
+ */
+class RequestTable {
+public:
+    using ResponseCallback = IEventService::ResponseCallback;
+
+    static constexpr size_t kDefaultCapacity = 4096;
+
+    explicit RequestTable(size_t capacity = kDefaultCapacity);
+
+    RequestTable(const RequestTable&) = delete;
+    RequestTable& operator=(const RequestTable&) = delete;
+
+    /**
+     * @brief Reserves a slot completed through the callback.
+     * @return The correlation id, 0 if the table is full; the callback is left untouched then.
+     */
+    uint64_t Add(ResponseCallback& callback);
+
+    /**
+     * @brief Reserves a slot completed through the promise.
+     * @return The correlation id, 0 if the table is full; the promise is left untouched then.
+     */
+    uint64_t Add(std::promise<EventPayload>& promise);
+
+    /**
+     * @brief Completes a request and frees its slot; thread-safe.
+     * @return false if the request is unknown or was already completed.
+     */
+    bool Complete(uint64_t id, RequestStatus status, const EventPayload& response);
+
+    /**
+     * @brief Completes every pending request with the given status.
+     */
+    void CompleteAll(RequestStatus status);
+
+    /**
+     * @brief The RequestError a future fails with.
+     */
+    static std::exception_ptr Error(RequestStatus status);
+
+    size_t Pending() const { return pending.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> id{0};  // Correlation id while pending, 0 while free
+        uint32_t generation = 0;
+        std::atomic<uint32_t> nextFree{0};  // Free list link, index + 1
+        ResponseCallback callback;
+        std::optional<std::promise<EventPayload>> promise;
+    };
+
+    Slot* Acquire();
+    uint64_t Publish(Slot& slot);
+    void Release(uint32_t index);
+
+    std::unique_ptr<Slot[]> slots;
+    size_t capacity;
+
+    // Top of the free list: ABA tag in the high 32 bits, index + 1 in the low ones (0 when empty)
+    std::atomic<uint64_t> freeHead{0};
+    std::atomic<size_t> pending{0};
+};
+
+#endif // REQUESTTABLE_H
@@ -0,0 +1,138 @@
+#include "TimerWheel.h"
+#include <algorithm>
+
+TimerWheel::TimerWheel(Clock::time_point start)
+    : start(start) {}
+
+uint64_t TimerWheel::TickOf(Clock::time_point time) const {
+    return time <= start ? 0 : static_cast<uint64_t>((time - start) / kTick);
+}
+
+void TimerWheel::Insert(Timer timer) {
+    if (count == 0) {
+        // Nothing to fire in between, skip the idle ticks instead of walking them in Advance()
+        currentTick = std::max(currentTick, TickOf(Clock::now()));
+    }
+    ++count;
+    File(std::move(timer));
+}
+
+void TimerWheel::File(Timer timer) {
+    uint64_t deadline = std::max(TickOf(timer.deadline), currentTick);
+    uint64_t delta = deadline - currentTick;
+
+    size_t level = 0;
+    while (level + 1 < kLevels && delta >= (uint64_t(1) << (kSlotBits * (level + 1)))) {
+        ++level;
+    }
+    if (delta >= (uint64_t(1) << (kSlotBits * kLevels))) {
+        deadline = currentTick + (uint64_t(1) << (kSlotBits * kLevels)) - 1;  // Beyond reach, re-filed later
+    }
+    size_t slot = (deadline >> (kSlotBits * level)) & (kSlots - 1);
+
+    if (timer.request == 0) {
+        locations[timer.id] = {static_cast<uint8_t>(level), static_cast<uint8_t>(slot)};
+    }
+    wheels[level][slot].push_back(std::move(timer));
+    occupied[level] |= uint64_t(1) << slot;
+}
+
+bool TimerWheel::Cancel(TimerId id) {
+    auto it = locations.find(id);
+    if (it == locations.end()) {
+        return false;
+    }
+    Slot& timers = wheels[it->second.level][it->second.slot];
+    auto timer = std::find_if(timers.begin(), timers.end(), [id](const Timer& t) { return t.id == id; });
+    if (timer != timers.end()) {
+        *timer = std::move(timers.back());
+        timers.pop_back();
+    }
+    if (timers.empty()) {
+        occupied[it->second.level] &= ~(uint64_t(1) << it->second.slot);
+    }
+    locations.erase(it);
+    --count;
+    return true;
+}
+
+void TimerWheel::Advance(Clock::time_point now, std::vector<Timer>& expired) {
+    size_t first = expired.size();
+    uint64_t target = TickOf(now);
+    while (currentTick < target) {
+        if (count == 0) {
+            currentTick = target;
+            break;
+        }
+        Expire(currentTick & (kSlots - 1), now, expired);
+        ++currentTick;
+
+        // A lower wheel completed a turn: move the next slot of the wheel above down, top first
+        for (size_t level = kLevels - 1; level > 0; --level) {
+            if ((currentTick & ((uint64_t(1) << (kSlotBits * level)) - 1)) == 0) {
+                Cascade(level, (currentTick >> (kSlotBits * level)) & (kSlots - 1));
+            }
+        }
+    }
+    Expire(currentTick & (kSlots - 1), now, expired);
+
+    std::stable_sort(expired.begin() + first, expired.end(),
+                     [](const Timer& a, const Timer& b) { return a.deadline < b.deadline; });
+}
+
+void TimerWheel::Cascade(size_t level, size_t slot) {
+    Slot timers;
+    timers.swap(wheels[level][slot]);
+    occupied[level] &= ~(uint64_t(1) << slot);
+    for (auto& timer : timers) {
+        File(std::move(timer));
+    }
+}
+
+void TimerWheel::Expire(size_t slot, Clock::time_point now, std::vector<Timer>& expired) {
+    if (!(occupied[0] & (uint64_t(1) << slot))) {
+        return;
+    }
+    Slot& timers = wheels[0][slot];
+    for (size_t i = 0; i < timers.size();) {
+        if (timers[i].deadline <= now) {
+            if (timers[i].request == 0) {
+                locations.erase(timers[i].id);
+            }
+            --count;
+            expired.push_back(std::move(timers[i]));
+            timers[i] = std::move(timers.back());
+            timers.pop_back();
+        } else {
+            ++i;  // Later within the current tick
+        }
+    }
+    if (timers.empty()) {
+        occupied[0] &= ~(uint64_t(1) << slot);
+    }
+}
+
+TimerWheel::Clock::time_point TimerWheel::NextWakeup() const {
+    Clock::time_point wakeup = Clock::time_point::max();
+
+    // First non-empty slot of the lowest wheel, counting from the current tick; all its timers
+    // share one tick, wake up for the earliest of them
+    if (occupied[0] != 0) {
+        size_t base = currentTick & (kSlots - 1);
+        uint64_t rotated = base == 0 ? occupied[0] : (occupied[0] >> base) | (occupied[0] << (kSlots - base));
+        size_t slot = (base + static_cast<size_t>(__builtin_ctzll(rotated))) & (kSlots - 1);
+        for (const auto& timer : wheels[0][slot]) {
+            wakeup = std::min(wakeup, timer.deadline);
+        }
+    }
+
+    // Higher wheels only need attention when the lowest one completes a turn
+    for (size_t level = 1; level < kLevels; ++level) {
+        if (occupied[level] != 0) {
+            uint64_t turn = ((currentTick >> kSlotBits) + 1) << kSlotBits;
+            wakeup = std::min(wakeup, start + kTick * static_cast<Clock::rep>(turn));
+            break;
+        }
+    }
+    return wakeup;
+}
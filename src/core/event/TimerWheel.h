@@ -0,0 +1,82 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include "interfaces/IEventService.h"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class TimerWheel
+ * @brief Hierarchical timing wheel of scheduled events.
+ * @details kLevels wheels of kSlots slots each; a slot of level L spans kSlots^L ticks. Timers are
+ * filed by deadline, and timers of a higher level move down one level whenever the wheel below
+ * completes a turn, so Insert(), Cancel() and firing are O(1) regardless of the number of timers.
+ * Deadlines keep their full clock precision; the tick only decides which slot a timer lives in.
+ * Deadlines beyond the reach of the top level are parked in its farthest slot and re-filed when
+ * it comes around. Not thread-safe; the owner serializes access.
+ */
+class TimerWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+    using TimerId = IEventService::TimerId;
+
+    static constexpr Clock::duration kTick = std::chrono::milliseconds(1);
+    static constexpr unsigned kSlotBits = 6;
+    static constexpr size_t kSlots = size_t(1) << kSlotBits;
+    static constexpr size_t kLevels = 4;
+
+    struct Timer {
+        TimerId id = 0;
+        Clock::time_point deadline;
+        Clock::duration period{0};  // Zero for one-shot timers
+        IEventService::TopicId topic = 0;
+        EventPayload payload;
+        uint64_t request = 0;  // Request to time out instead of an event to trigger; cannot be cancelled
+    };
+
+    explicit TimerWheel(Clock::time_point start);
+
+    void Insert(Timer timer);
+
+    /**
+     * @return false if no pending timer has this id.
+     */
+    bool Cancel(TimerId id);
+
+    /**
+     * @brief Moves every timer with deadline <= now into expired, in deadline order per slot.
+     */
+    void Advance(Clock::time_point now, std::vector<Timer>& expired);
+
+    /**
+     * @brief When Advance() has something to do next; Clock::time_point::max() if there are no timers.
+     */
+    Clock::time_point NextWakeup() const;
+
+    size_t Size() const { return count; }
+
+private:
+    struct Location {
+        uint8_t level;
+        uint8_t slot;
+    };
+
+    using Slot = std::vector<Timer>;
+
+    uint64_t TickOf(Clock::time_point time) const;
+    void File(Timer timer);
+    void Cascade(size_t level, size_t slot);
+    void Expire(size_t slot, Clock::time_point now, std::vector<Timer>& expired);
+
+    Clock::time_point start;
+    uint64_t currentTick = 0;
+    std::array<std::array<Slot, kSlots>, kLevels> wheels;
+    std::array<uint64_t, kLevels> occupied = {};  // Bit per non-empty slot
+    std::unordered_map<TimerId, Location> locations;  // Cancellable timers only
+    size_t count = 0;
+};
+
+#endif // TIMERWHEEL_H
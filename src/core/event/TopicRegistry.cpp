@@ -0,0 +1,56 @@
+#include "TopicRegistry.h"
+#include <mutex>
+#include <stdexcept>
+
+TopicRegistry::TopicRegistry() {
+    for (auto& chunk : chunks) {
+        chunk.store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+TopicRegistry::~TopicRegistry() {
+    for (auto& chunk : chunks) {
+        delete[] chunk.load(std::memory_order_relaxed);
+    }
+}
+
+TopicRegistry::TopicId TopicRegistry::Register(const std::string& eventName) {
+    TopicId topic;
+    if (Find(eventName, topic)) {
+        return topic;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    auto it = ids.find(eventName);
+    if (it != ids.end()) {
+        return it->second;
+    }
+
+    size_t index = count.load(std::memory_order_relaxed);
+    if (index >= kMaxTopics) {
+        throw std::length_error("TopicRegistry: too many topics, cannot register " + eventName);
+    }
+
+    auto& chunk = chunks[index / kChunkSize];
+    if (chunk.load(std::memory_order_relaxed) == nullptr) {
+        chunk.store(new TopicInfo[kChunkSize], std::memory_order_release);
+    }
+    TopicInfo& info = Get(static_cast<TopicId>(index));
+    info.name = eventName;
+    info.latency = std::make_unique<TopicLatency>();
+
+    topic = static_cast<TopicId>(index);
+    ids.emplace(eventName, topic);
+    count.store(index + 1, std::memory_order_release);
+    return topic;
+}
+
+bool TopicRegistry::Find(const std::string& eventName, TopicId& topic) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto it = ids.find(eventName);
+    if (it == ids.end()) {
+        return false;
+    }
+    topic = it->second;
+    return true;
+}
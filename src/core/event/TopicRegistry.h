@@ -0,0 +1,153 @@
+#ifndef TOPICREGISTRY_H
+#define TOPICREGISTRY_H
+
+#include "interfaces/IEventService.h"
+#include "metrics/LatencyHistogram.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Latency histograms of a topic, see IEventService::GetTopicLatency().
+ */
+struct TopicLatency {
+    LatencyHistogram queueWait;
+    LatencyHistogram handler;
+};
+
+/**
+ * @brief DropOldest events of a topic waiting for dispatch, the newest maxPending of them.
+ * @details They stay out of the shared lane; one token there dispatches them in order, so a burst
+ * on the topic replaces its own oldest entries instead of filling the lane. Guarded by
+ * TopicInfo::latestMutex.
+ */
+struct TopicBacklog {
+    struct Entry {
+        EventPayload payload;
+        uint64_t enqueueTime = 0;
+        bool inlineDone = false;  // From TriggerSync(), its inline subscribers saw it
+    };
+
+    std::vector<Entry> ring;  // Sized to maxPending
+    size_t head = 0;          // Oldest entry
+    size_t size = 0;
+    bool queued = false;      // A token in the lane will dispatch the entries
+
+    // Adds the newest entry; returns how many of the oldest it displaced
+    size_t Push(Entry entry, size_t capacity) {
+        size_t displaced = 0;
+        if (ring.size() != capacity) {
+            // maxPending changed, keep the newest entries in order
+            std::vector<Entry> resized(capacity);
+            size_t kept = std::min(size, capacity);
+            displaced = size - kept;
+            for (size_t i = 0; i < kept; ++i) {
+                resized[i] = std::move(ring[(head + displaced + i) % ring.size()]);
+            }
+            ring.swap(resized);
+            head = 0;
+            size = kept;
+        }
+        if (size == capacity) {
+            ring[head] = std::move(entry);  // Replaces the oldest, which makes the next one the oldest
+            head = (head + 1) % capacity;
+            return displaced + 1;
+        }
+        ring[(head + size) % capacity] = std::move(entry);
+        ++size;
+        return displaced;
+    }
+
+    bool Pop(Entry& entry) {
+        if (size == 0) {
+            return false;
+        }
+        entry = std::move(ring[head]);
+        ring[head] = Entry();
+        head = (head + 1) % ring.size();
+        --size;
+        return true;
+    }
+};
+
+/**
+ * @brief Per-topic data, addressed by TopicId.
+ */
+struct TopicInfo {
+    std::string name;
+    std::atomic<EventPriority> priority{EventPriority::Normal};
+
+    // Delivery policy, see IEventService::SetTopicPolicy()
+    std::atomic<DeliveryPolicy> policy{DeliveryPolicy::Block};
+    std::atomic<size_t> maxPending{0};
+    std::atomic<int64_t> pending{0};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> coalesced{0};
+
+    // CoalesceLatest: newest payload, and whether an event is queued to pick it up. DropOldest: the backlog.
+    std::mutex latestMutex;
+    EventPayload latest;
+    bool latestQueued = false;
+    bool latestInlineDone = false;  // latest came from TriggerSync(), its inline subscribers saw it
+    TopicBacklog backlog;
+
+    // Set while an activator waits for the first event, see IEventService::SetTopicActivator()
+    std::atomic<bool> activatorPending{false};
+
+    // Allocated on registration only, the histograms are too large to preallocate per chunk
+    std::unique_ptr<TopicLatency> latency;
+};
+
+/**
+ * @class TopicRegistry
+ * @brief Interns event names into dense TopicId handles.
+ * @details Names are only hashed on registration and on lookup by name. TopicInfo entries live in
+ * fixed-size chunks that are never moved, so Get() is a lock-free array access that is safe to call
+ * while other threads register new topics.
+ */
+class TopicRegistry {
+public:
+    using TopicId = IEventService::TopicId;
+
+    static constexpr size_t kChunkSize = 256;
+    static constexpr size_t kMaxChunks = 256;
+    static constexpr size_t kMaxTopics = kChunkSize * kMaxChunks;
+
+    TopicRegistry();
+    ~TopicRegistry();
+
+    /**
+     * @brief Returns the handle of eventName, registering it if needed.
+     * @throws std::length_error if more than kMaxTopics topics are registered.
+     */
+    TopicId Register(const std::string& eventName);
+
+    /**
+     * @brief Looks up an already registered name without registering it.
+     * @return false if the name is unknown.
+     */
+    bool Find(const std::string& eventName, TopicId& topic) const;
+
+    /**
+     * @brief Number of registered topics; every id below this is valid.
+     */
+    size_t Size() const { return count.load(std::memory_order_acquire); }
+
+    TopicInfo& Get(TopicId topic) const {
+        return chunks[topic / kChunkSize].load(std::memory_order_acquire)[topic % kChunkSize];
+    }
+
+private:
+    mutable std::shared_mutex mutex;
+    std::unordered_map<std::string, TopicId> ids;
+    std::array<std::atomic<TopicInfo*>, kMaxChunks> chunks;
+    std::atomic<size_t> count{0};
+};
+
+#endif // TOPICREGISTRY_H
@@ -0,0 +1,104 @@
+#include "TopicTrie.h"
+#include <algorithm>
+#include <stdexcept>
+
+std::vector<std::string> TopicTrie::Split(const std::string& name) {
+    std::vector<std::string> levels;
+    size_t start = 0;
+    for (;;) {
+        size_t end = name.find('/', start);
+        if (end == std::string::npos) {
+            levels.push_back(name.substr(start));
+            return levels;
+        }
+        levels.push_back(name.substr(start, end - start));
+        start = end + 1;
+    }
+}
+
+bool TopicTrie::IsPattern(const std::string& name) {
+    for (const auto& level : Split(name)) {
+        if (level == "*" || level == "#") {
+            return true;
+        }
+    }
+    return false;
+}
+
+void TopicTrie::Validate(const std::string& pattern) {
+    auto levels = Split(pattern);
+    for (size_t i = 0; i < levels.size(); ++i) {
+        const std::string& level = levels[i];
+        if (level != "*" && level != "#" && level.find_first_of("*#") != std::string::npos) {
+            throw std::invalid_argument("TopicTrie: wildcards must span a whole level in " + pattern);
+        }
+        if (level == "#" && i + 1 != levels.size()) {
+            throw std::invalid_argument("TopicTrie: # must be the last level in " + pattern);
+        }
+    }
+}
+
+bool TopicTrie::Matches(const std::string& pattern, const std::string& name) {
+    auto patternLevels = Split(pattern);
+    auto levels = Split(name);
+    for (size_t i = 0; i < patternLevels.size(); ++i) {
+        if (patternLevels[i] == "#") {
+            return true;
+        }
+        if (i >= levels.size() || (patternLevels[i] != "*" && patternLevels[i] != levels[i])) {
+            return false;
+        }
+    }
+    return patternLevels.size() == levels.size();
+}
+
+void TopicTrie::Insert(const std::string& pattern, PatternId id) {
+    Node* node = &root;
+    for (const auto& level : Split(pattern)) {
+        auto& child = node->children[level];
+        if (!child) {
+            child = std::make_unique<Node>();
+        }
+        node = child.get();
+    }
+    node->ids.push_back(id);
+}
+
+void TopicTrie::Remove(const std::string& pattern, PatternId id) {
+    // Empty nodes are kept; the set of distinct patterns is small and mostly static
+    Node* node = &root;
+    for (const auto& level : Split(pattern)) {
+        auto it = node->children.find(level);
+        if (it == node->children.end()) {
+            return;
+        }
+        node = it->second.get();
+    }
+    node->ids.erase(std::remove(node->ids.begin(), node->ids.end(), id), node->ids.end());
+}
+
+void TopicTrie::Match(const std::string& name, std::vector<PatternId>& matches) const {
+    Match(root, Split(name), 0, matches);
+}
+
+void TopicTrie::Match(const Node& node, const std::vector<std::string>& levels, size_t level, std::vector<PatternId>& matches) {
+    // "#" also matches the parent level itself, e.g. "playback/#" matches "playback"
+    auto rest = node.children.find("#");
+    if (rest != node.children.end()) {
+        matches.insert(matches.end(), rest->second->ids.begin(), rest->second->ids.end());
+    }
+
+    if (level == levels.size()) {
+        matches.insert(matches.end(), node.ids.begin(), node.ids.end());
+        return;
+    }
+
+    auto exact = node.children.find(levels[level]);
+    if (exact != node.children.end()) {
+        Match(*exact->second, levels, level + 1, matches);
+    }
+    auto any = node.children.find("*");
+    if (any != node.children.end() && levels[level] != "*") {
+        Match(*any->second, levels, level + 1, matches);
+    }
+}
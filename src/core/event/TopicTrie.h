@@ -0,0 +1,57 @@
+#ifndef TOPICTRIE_H
+#define TOPICTRIE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class TopicTrie
+ * @brief Wildcard topic patterns, stored as a trie of '/'-separated levels.
+ * @details "*" matches exactly one level, "#" matches the remaining levels (zero or more). Matching
+ * a topic name walks at most one exact, one "*" and one "#" branch per level, so its cost depends on
+ * the depth of the name and not on the number of patterns. Not thread-safe; the owner serializes access.
+ */
+class TopicTrie {
+public:
+    using PatternId = std::uint64_t;
+
+    /**
+     * @brief True if the name contains a wildcard level.
+     */
+    static bool IsPattern(const std::string& name);
+
+    /**
+     * @brief Checks the pattern syntax.
+     * @throws std::invalid_argument if "#" is not the last level or a level mixes wildcards and text.
+     */
+    static void Validate(const std::string& pattern);
+
+    /**
+     * @brief True if the topic name matches the pattern.
+     */
+    static bool Matches(const std::string& pattern, const std::string& name);
+
+    void Insert(const std::string& pattern, PatternId id);
+    void Remove(const std::string& pattern, PatternId id);
+
+    /**
+     * @brief Appends the ids of all patterns matching the topic name to matches.
+     */
+    void Match(const std::string& name, std::vector<PatternId>& matches) const;
+
+private:
+    struct Node {
+        std::unordered_map<std::string, std::unique_ptr<Node>> children;  // Includes "*" and "#"
+        std::vector<PatternId> ids;  // Patterns ending at this node
+    };
+
+    static std::vector<std::string> Split(const std::string& name);
+    static void Match(const Node& node, const std::vector<std::string>& levels, size_t level, std::vector<PatternId>& matches);
+
+    Node root;
+};
+
+#endif // TOPICTRIE_H
@@ -0,0 +1,251 @@
+#include "ExecutorService.h"
+#include <algorithm>
+
+namespace {
+struct CurrentWorker {
+    uint64_t owner = 0;  // instanceId of the executor, 0 on other threads
+    size_t index = 0;
+};
+
+// Set on worker threads so Submit() can use the worker's own deque
+thread_local CurrentWorker currentWorker;
+
+std::atomic<uint64_t> nextInstanceId{1};
+}
+
+ExecutorService::ExecutorService(ILoggerService* logger, IConfigService* config)
+    : ExecutorService(logger, static_cast<size_t>(std::max<int64_t>(0, config->GetInt("executor.workers", 0))),
+                      config->GetThreadPolicy("executor"), config->GetThreadPolicy("long_running")) {}
+
+ExecutorService::ExecutorService(ILoggerService* logger, size_t workerCount, const ThreadPolicy& workerPolicy,
+                                 const ThreadPolicy& longRunningPolicy)
+    : logger(logger),
+      logCategory(&logger->Category("ExecutorService")),
+      instanceId(nextInstanceId.fetch_add(1)),
+      longRunningPolicy(longRunningPolicy) {
+    if (workerCount == 0) {
+        workerCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < workerCount; ++i) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+    // Start only once every deque exists, workers steal from each other right away
+    std::string policyError;
+    for (size_t i = 0; i < workerCount; ++i) {
+        workers[i]->thread = PolicyThread(PolicyThread::Named(workerPolicy, "apx-worker", static_cast<int>(i)), [this, i] { WorkerLoop(i); });
+        if (policyError.empty()) {
+            policyError = workers[i]->thread.PolicyError();  // The same for every worker, report it once
+        }
+    }
+    if (!policyError.empty()) {
+        APX_LOG_WARNING(logger, logCategory) << "[ExecutorService] Worker thread policy not fully applied: " << policyError << std::endl;
+    }
+    APX_LOG_INFO(logger, logCategory) << "[ExecutorService] Started " << workerCount << " workers." << std::endl;
+}
+
+ExecutorService::~ExecutorService() {
+    Stop();
+}
+
+void ExecutorService::Submit(Task task) {
+    Task* node = new Task(std::move(task));
+    if (currentWorker.owner != instanceId || !workers[currentWorker.index]->tasks.Push(node)) {
+        std::unique_lock<std::mutex> lock(injectedMutex);
+        if (stopped) {
+            lock.unlock();
+            Execute(node);
+            return;
+        }
+        injected.push_back(node);
+        injectedCount.fetch_add(1);
+    }
+
+    // Pairs with the fence in WorkerLoop(): either the worker sees the task or we see it sleeping
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping.load() > 0) {
+        WakeWorker();
+    }
+}
+
+void ExecutorService::SubmitLongRunning(Task task) {
+    SubmitLongRunning(std::move(task), longRunningPolicy);
+}
+
+void ExecutorService::SubmitLongRunning(Task task, const ThreadPolicy& policy) {
+    std::lock_guard<std::mutex> lock(longRunningMutex);
+    ReapLongRunning();
+    longRunning.fetch_add(1);
+    auto finished = std::make_unique<std::atomic<bool>>(false);
+    std::atomic<bool>* done = finished.get();  // Outlives the thread, the entry is only removed once it is set
+    PolicyThread thread(PolicyThread::Named(policy, "apx-long"), [this, done, task = std::move(task)] {
+        try {
+            task();
+        } catch (const std::exception& e) {
+            APX_LOG_ERROR(logger, logCategory) << "[ExecutorService] Long-running task failed: " << e.what() << std::endl;
+        } catch (...) {
+            APX_LOG_ERROR(logger, logCategory) << "[ExecutorService] Long-running task encountered an unknown error!" << std::endl;
+        }
+        longRunning.fetch_sub(1);
+        done->store(true, std::memory_order_release);
+    });
+    if (!thread.PolicyError().empty()) {
+        APX_LOG_WARNING(logger, logCategory) << "[ExecutorService] Long-running thread policy not fully applied: "
+                                             << thread.PolicyError() << std::endl;
+    }
+    longRunningThreads.push_back({std::move(finished), std::move(thread)});
+}
+
+void ExecutorService::ReapLongRunning() {
+    // Their bodies have returned, joining only waits for the thread to exit
+    longRunningThreads.erase(std::remove_if(longRunningThreads.begin(), longRunningThreads.end(), [](LongRunningThread& entry) {
+        if (!entry.finished->load(std::memory_order_acquire)) {
+            return false;
+        }
+        entry.thread.Join();
+        return true;
+    }), longRunningThreads.end());
+}
+
+size_t ExecutorService::WorkerCount() const {
+    return workers.size();
+}
+
+ExecutorStats ExecutorService::GetStats() const {
+    ExecutorStats stats;
+    stats.workers = workers.size();
+    stats.longRunning = longRunning.load(std::memory_order_relaxed);
+    stats.executed = executed.load(std::memory_order_relaxed);
+    stats.stolen = stolen.load(std::memory_order_relaxed);
+    stats.queued = injectedCount.load(std::memory_order_relaxed);
+    for (const auto& worker : workers) {
+        stats.queued += worker->tasks.Size();
+    }
+    return stats;
+}
+
+void ExecutorService::Stop() {
+    if (!stopping.exchange(true)) {
+        APX_LOG_DEBUG(logger, logCategory) << "[ExecutorService] Stopping workers..." << std::endl;
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+        }
+        sleepCondition.notify_all();
+        for (auto& worker : workers) {
+            worker->thread.Join();
+        }
+
+        // Workers leave with their own deques empty; run what was injected after they looked
+        std::deque<Task*> remaining;
+        {
+            std::lock_guard<std::mutex> lock(injectedMutex);
+            stopped = true;
+            remaining.swap(injected);
+            injectedCount.store(0);
+        }
+        for (Task* task : remaining) {
+            Execute(task);
+        }
+    }
+
+    std::vector<LongRunningThread> threads;
+    {
+        std::lock_guard<std::mutex> lock(longRunningMutex);
+        threads.swap(longRunningThreads);
+    }
+    for (auto& entry : threads) {
+        entry.thread.Join();
+    }
+}
+
+void ExecutorService::WorkerLoop(size_t index) {
+    currentWorker.owner = instanceId;
+    currentWorker.index = index;
+
+    for (;;) {
+        if (Task* task = FindTask(index)) {
+            Execute(task);
+            continue;
+        }
+        if (stopping.load()) {
+            break;
+        }
+
+        // Work tends to come in bursts, look again a few times before going to sleep
+        bool found = false;
+        for (int spin = 0; spin < kSpinCount && !found; ++spin) {
+            std::this_thread::yield();
+            found = HasWork();
+        }
+        if (found) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleeping.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        while (!stopping.load() && !HasWork()) {
+            sleepCondition.wait(lock);
+        }
+        sleeping.fetch_sub(1);
+    }
+
+    currentWorker.owner = 0;
+}
+
+ExecutorService::Task* ExecutorService::FindTask(size_t index) {
+    if (Task* task = workers[index]->tasks.Pop()) {
+        return task;
+    }
+    if (Task* task = TakeInjected()) {
+        return task;
+    }
+    // Start with the next worker, so thieves do not all line up behind the first one
+    size_t count = workers.size();
+    for (size_t i = 1; i < count; ++i) {
+        if (Task* task = workers[(index + i) % count]->tasks.Steal()) {
+            stolen.fetch_add(1, std::memory_order_relaxed);
+            return task;
+        }
+    }
+    return nullptr;
+}
+
+ExecutorService::Task* ExecutorService::TakeInjected() {
+    if (injectedCount.load(std::memory_order_relaxed) == 0) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(injectedMutex);
+    if (injected.empty()) {
+        return nullptr;
+    }
+    Task* task = injected.front();
+    injected.pop_front();
+    injectedCount.fetch_sub(1);
+    return task;
+}
+
+bool ExecutorService::HasWork() const {
+    if (injectedCount.load() != 0) {
+        return true;
+    }
+    return std::any_of(workers.begin(), workers.end(), [](const auto& worker) { return worker->tasks.Size() != 0; });
+}
+
+void ExecutorService::Execute(Task* task) {
+    std::unique_ptr<Task> owned(task);
+    try {
+        (*owned)();
+    } catch (const std::exception& e) {
+        APX_LOG_ERROR(logger, logCategory) << "[ExecutorService] Task failed: " << e.what() << std::endl;
+    } catch (...) {
+        APX_LOG_ERROR(logger, logCategory) << "[ExecutorService] Task encountered an unknown error!" << std::endl;
+    }
+    executed.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ExecutorService::WakeWorker() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    sleepCondition.notify_one();
+}
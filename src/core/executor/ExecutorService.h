@@ -0,0 +1,101 @@
+#ifndef EXECUTORSERVICE_H
+#define EXECUTORSERVICE_H
+
+#include "interfaces/IExecutorService.h"
+#include "interfaces/ILoggerService.h"
+#include "interfaces/IConfigService.h"
+#include "concurrency/PolicyThread.h"
+#include "concurrency/WorkStealingDeque.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <fruit/fruit.h>
+
+/**
+ * @class ExecutorService
+ * @brief Work-stealing thread pool with one worker per hardware thread.
+ * @details Every worker owns a WorkStealingDeque. Tasks submitted by a worker go to its own deque
+ * and are popped newest first; tasks from other threads go to a shared injection queue. A worker
+ * that runs out of work takes from the injection queue, then steals the oldest task of another
+ * worker, and only sleeps when all of them are empty. Long-running tasks get a thread each, so
+ * they never hold a worker.
+ */
+class ExecutorService : public IExecutorService {
+public:
+    /**
+     * @details Reads executor.workers and the executor and long_running thread policies.
+     */
+    INJECT(ExecutorService(ILoggerService* logger, IConfigService* config));
+
+    /**
+     * @param workerCount Number of workers; 0 for one per hardware thread.
+     */
+    ExecutorService(ILoggerService* logger, size_t workerCount, const ThreadPolicy& workerPolicy = ThreadPolicy(),
+                    const ThreadPolicy& longRunningPolicy = ThreadPolicy());
+    ~ExecutorService() override;
+
+    void Submit(Task task) override;
+    void SubmitLongRunning(Task task, const ThreadPolicy& policy) override;
+    void SubmitLongRunning(Task task) override;
+    size_t WorkerCount() const override;
+    ExecutorStats GetStats() const override;
+    void Stop() override;
+
+    // Tasks a worker's own deque holds before further submissions go to the injection queue
+    static constexpr size_t kDequeCapacity = 4096;
+
+    // Rounds of looking for work to steal before a worker goes to sleep
+    static constexpr int kSpinCount = 64;
+
+private:
+    struct Worker {
+        WorkStealingDeque<Task> tasks{kDequeCapacity};
+        PolicyThread thread;
+    };
+
+    void WorkerLoop(size_t index);
+    Task* FindTask(size_t index);
+    Task* TakeInjected();
+    bool HasWork() const;
+    void Execute(Task* task);
+    void WakeWorker();
+
+    ILoggerService* logger;
+    LogCategory* logCategory;
+    const uint64_t instanceId;
+
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    // Tasks from threads that are not workers of this executor
+    mutable std::mutex injectedMutex;
+    std::deque<Task*> injected;
+    std::atomic<size_t> injectedCount{0};
+    bool stopped = false;  // Guarded by injectedMutex; Submit() runs tasks inline from then on
+
+    // Idle workers sleep here
+    std::mutex sleepMutex;
+    std::condition_variable sleepCondition;
+    std::atomic<int> sleeping{0};
+    std::atomic<bool> stopping{false};
+
+    // Finished threads are joined and removed by the next SubmitLongRunning(), the rest by Stop()
+    struct LongRunningThread {
+        std::unique_ptr<std::atomic<bool>> finished;  // Set by the thread as its last action
+        PolicyThread thread;
+    };
+    void ReapLongRunning();
+
+    const ThreadPolicy longRunningPolicy;
+    std::mutex longRunningMutex;
+    std::vector<LongRunningThread> longRunningThreads;
+    std::atomic<size_t> longRunning{0};
+
+    std::atomic<uint64_t> executed{0};
+    std::atomic<uint64_t> stolen{0};
+};
+
+#endif // EXECUTORSERVICE_H
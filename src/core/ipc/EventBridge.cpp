@@ -0,0 +1,235 @@
+#include "EventBridge.h"
+#include "event/TopicTrie.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace {
+enum PayloadKind : uint16_t {
+    EmptyPayload = 0,
+    StringPayload,
+    Int64Payload,
+    DoublePayload
+};
+
+enum TopicState : uint8_t {
+    Unknown = 0,
+    Local,   // Declared to the other side, sent from here
+    Remote   // Declared by the other side, never sent back
+};
+}
+
+size_t EventBridge::RegionSize() {
+    return 2 * SharedRing::RegionSize(kRingCapacity);
+}
+
+SharedRing EventBridge::ToChild(void* region, bool initialize) {
+    return SharedRing(region, kRingCapacity, initialize, Heartbeat);
+}
+
+SharedRing EventBridge::ToParent(void* region, bool initialize) {
+    return SharedRing(static_cast<char*>(region) + SharedRing::RegionSize(kRingCapacity), kRingCapacity, initialize, Heartbeat);
+}
+
+EventBridge::EventBridge(IEventService* eventService, ILoggerService* logger, LogCategory* logCategory, SharedRing out, bool parent,
+                         std::vector<std::string> accepted)
+    : eventService(eventService), logger(logger), logCategory(logCategory), parent(parent), accepted(std::move(accepted)), out(out) {}
+
+bool EventBridge::Publish(IEventService::TopicId topic, const EventPayload& payload) {
+    std::unique_lock<std::mutex> lock(writeMutex);
+    if (closed) {
+        return false;
+    }
+    if (declared.size() <= topic) {
+        declared.resize(topic + 1, Unknown);
+    }
+    if (declared[topic] == Remote) {
+        return false;
+    }
+    SharedRing::Message message;
+    if (!Encode(topic, payload, message)) {
+        lock.unlock();
+        CountDrop(eventService->GetTopicName(topic), "payload type cannot cross processes");
+        return false;
+    }
+    if (declared[topic] == Unknown) {
+        const std::string& name = eventService->GetTopicName(topic);
+        SharedRing::Message declaration;
+        declaration.type = Topic;
+        declaration.topic = topic;
+        declaration.data = name.data();
+        declaration.size = name.size();
+        if (!WriteLocked(declaration, std::chrono::milliseconds(0))) {
+            lock.unlock();
+            CountDrop(eventService->GetTopicName(topic), "ring full");
+            return false;
+        }
+        declared[topic] = Local;
+    }
+    if (!WriteLocked(message, std::chrono::milliseconds(0))) {
+        lock.unlock();
+        CountDrop(eventService->GetTopicName(topic), "ring full");
+        return false;
+    }
+    if (message.type == Request) {
+        sentRequests[static_cast<uint32_t>(message.value)] = message.value;
+    }
+    return true;
+}
+
+bool EventBridge::Send(const SharedRing::Message& message, std::chrono::milliseconds timeout) {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    return !closed && WriteLocked(message, timeout);
+}
+
+bool EventBridge::WriteLocked(const SharedRing::Message& message, std::chrono::milliseconds timeout) {
+    return out.Write(message, timeout);
+}
+
+bool EventBridge::Handle(const SharedRing::Message& message) {
+    switch (message.type) {
+        case Topic: {
+            std::string name(message.data, message.size);
+            bool allowed = std::any_of(accepted.begin(), accepted.end(), [&name](const std::string& pattern) {
+                return TopicTrie::Matches(pattern, name);
+            });
+            if (!allowed) {
+                remoteTopics.erase(message.topic);  // Its events are dropped as undeclared
+                CountDrop(name, "topic not among the accepted patterns");
+                return true;
+            }
+            if (remoteTopics.size() >= kMaxRemoteTopics && remoteTopics.count(message.topic) == 0) {
+                violation = "declared more than " + std::to_string(kMaxRemoteTopics) + " topics";
+                return true;
+            }
+            IEventService::TopicId local;
+            try {
+                local = eventService->RegisterTopic(name);
+            } catch (const std::exception& e) {
+                violation = "declared topic " + name + " that could not be registered: " + e.what();
+                return true;
+            }
+            remoteTopics[message.topic] = local;
+            std::lock_guard<std::mutex> lock(writeMutex);
+            if (declared.size() <= local) {
+                declared.resize(local + 1, Unknown);
+            }
+            if (declared[local] == Unknown || !parent) {
+                declared[local] = Remote;
+            }
+            return true;
+        }
+        case Event:
+        case Request:
+        case Response:
+            break;
+        default:
+            return false;
+    }
+
+    if (message.type == Response) {
+        {
+            // Only an answer to what this bridge asked; never another request of this process
+            std::lock_guard<std::mutex> lock(writeMutex);
+            auto sent = sentRequests.find(static_cast<uint32_t>(message.value));
+            if (sent == sentRequests.end() || sent->second != message.value) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+            sentRequests.erase(sent);
+        }
+        EventPayload request;
+        request.SetRequestId(message.value);
+        eventService->Respond(request, Decode(message));
+        return true;
+    }
+
+    auto it = remoteTopics.find(message.topic);
+    if (it == remoteTopics.end()) {
+        CountDrop("undeclared topic " + std::to_string(message.topic), "not declared, or not accepted");
+        return true;
+    }
+    if (message.type == Event) {
+        eventService->TriggerPayload(it->second, Decode(message));
+        return true;
+    }
+
+    // Ask the local responders; the answer goes back under the other side's request id
+    uint64_t requestId = message.value;
+    std::weak_ptr<EventBridge> bridge = shared_from_this();
+    IEventService::TopicId topic = it->second;
+    eventService->Request(topic, Decode(message), [bridge, requestId, topic](RequestStatus status, const EventPayload& response) {
+        auto self = bridge.lock();
+        if (!self || status != RequestStatus::Ok) {
+            return;  // The requester times out on its side
+        }
+        SharedRing::Message answer;
+        if (!self->Encode(0, response, answer)) {
+            self->CountDrop(self->eventService->GetTopicName(topic), "response type cannot cross processes");
+            return;
+        }
+        answer.type = Response;
+        answer.value = requestId;
+        self->Send(answer, std::chrono::milliseconds(0));
+    }, kRequestTimeout);
+    return true;
+}
+
+void EventBridge::Close() {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    closed = true;
+}
+
+bool EventBridge::Encode(IEventService::TopicId topic, const EventPayload& payload, SharedRing::Message& message) {
+    // Copied straight from the payload into the ring, nothing is serialized in between
+    message.type = payload.RequestId() != 0 ? Request : Event;
+    message.topic = topic;
+    message.value = payload.RequestId();
+    if (payload.Empty()) {
+        message.flags = EmptyPayload;
+    } else if (const std::string* text = payload.Get<std::string>()) {
+        message.flags = StringPayload;
+        message.data = text->data();
+        message.size = text->size();
+    } else if (const int64_t* number = payload.Get<int64_t>()) {
+        message.flags = Int64Payload;
+        message.data = reinterpret_cast<const char*>(number);
+        message.size = sizeof(int64_t);
+    } else if (const double* number = payload.Get<double>()) {
+        message.flags = DoublePayload;
+        message.data = reinterpret_cast<const char*>(number);
+        message.size = sizeof(double);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+EventPayload EventBridge::Decode(const SharedRing::Message& message) {
+    switch (message.flags) {
+        case StringPayload:
+            return EventPayload::FromString(std::string(message.data, message.size));
+        case Int64Payload: {
+            int64_t value = 0;
+            std::memcpy(&value, message.data, std::min(message.size, sizeof(value)));
+            return EventPayload(std::make_shared<const int64_t>(value));
+        }
+        case DoublePayload: {
+            double value = 0;
+            std::memcpy(&value, message.data, std::min(message.size, sizeof(value)));
+            return EventPayload(std::make_shared<const double>(value));
+        }
+        default:
+            return EventPayload();
+    }
+}
+
+void EventBridge::CountDrop(const std::string& topicName, const char* reason) {
+    uint64_t count = dropped.fetch_add(1, std::memory_order_relaxed) + 1;
+    if ((count & (count - 1)) == 0) {
+        // Powers of two only, a full ring must not flood the log
+        APX_LOG_WARNING(logger, logCategory) << "[EventBridge] Dropped an event on " << topicName << ": "
+                                             << reason << " (" << count << " dropped)" << std::endl;
+    }
+}
@@ -0,0 +1,119 @@
+#ifndef EVENTBRIDGE_H
+#define EVENTBRIDGE_H
+
+#include "SharedRing.h"
+#include "interfaces/IEventService.h"
+#include "interfaces/ILoggerService.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class EventBridge
+ * @brief Carries events, requests and responses between the IEventServices of two processes.
+ * @details Each process sends through one SharedRing and reads the other. Topic ids are local to a
+ * process, so a topic is declared by name before its first event. A topic flows one way only: the
+ * side that declares it first owns it, the other side never sends it back, which keeps forwarded
+ * events from echoing; if both declare it at once, the parent keeps it. Payloads that cross are empty, strings, int64_t and double; others are
+ * dropped and logged. Requests are answered through the bridge like local ones.
+ *
+ * Publish() may be called from any thread, Handle() only from the thread that reads the ring.
+ */
+class EventBridge : public std::enable_shared_from_this<EventBridge> {
+public:
+    enum MessageType : uint16_t {
+        Topic = 1,  // topic is the sender's id, data its name
+        Event,
+        Request,    // value is the sender's request id
+        Response,   // value is the receiver's request id
+        // Plugin hosting, see RemotePlugin and PluginHost
+        Hello,      // Child: the plugin is loaded, data describes it
+        Error,      // Child: the plugin could not be loaded, data is the reason
+        Init,       // Parent: run the call, answered by Done
+        Run,
+        Destroy,
+        Done,       // Child: data is the error of the call, empty if it succeeded
+        State,      // Parent: RestoreState(data), answered by Done; child: SerializeState() before Done of Destroy
+        Update,     // Parent: value is deltaTime in nanoseconds
+        Heartbeat   // Child: data is its PluginActivity
+    };
+
+    // Data bytes per direction; a message may take up to half of it
+    static constexpr size_t kRingCapacity = size_t(1) << 20;
+
+    // Shared memory for both directions
+    static size_t RegionSize();
+    static SharedRing ToChild(void* region, bool initialize);
+    static SharedRing ToParent(void* region, bool initialize);
+
+    // parent: the side that keeps a topic both sides declared at once. accepted: patterns of the
+    // topics the other side may declare; events, requests and declarations of others are dropped.
+    EventBridge(IEventService* eventService, ILoggerService* logger, LogCategory* logCategory, SharedRing out, bool parent,
+                std::vector<std::string> accepted = {"#"});
+
+    /**
+     * @brief Sends an event, or a request if the payload is one, without waiting for ring space.
+     * @return false if it was not sent: the topic belongs to the other side, the payload cannot
+     * cross, or the ring is full.
+     */
+    bool Publish(IEventService::TopicId topic, const EventPayload& payload);
+
+    /**
+     * @brief Sends a control message, waiting up to timeout for ring space.
+     */
+    bool Send(const SharedRing::Message& message, std::chrono::milliseconds timeout = std::chrono::seconds(1));
+
+    /**
+     * @brief Applies a Topic, Event, Request or Response message to the local IEventService.
+     * @details A Response only counts for a request sent through this bridge and still unanswered.
+     * @return false for other message types.
+     */
+    bool Handle(const SharedRing::Message& message);
+
+    // Stops sending, for good; safe while request callbacks are still pending
+    void Close();
+
+    uint64_t Dropped() const { return dropped.load(std::memory_order_relaxed); }
+
+    // Why the other side must not be read any further, empty while it behaves; reader thread only
+    const std::string& Violation() const { return violation; }
+
+    // Topics the other side may declare; one more is a violation, so it cannot exhaust the TopicRegistry
+    static constexpr size_t kMaxRemoteTopics = 1024;
+
+    // How long a forwarded request waits for its responder
+    static constexpr std::chrono::seconds kRequestTimeout{10};
+
+private:
+    bool Encode(IEventService::TopicId topic, const EventPayload& payload, SharedRing::Message& message);
+    static EventPayload Decode(const SharedRing::Message& message);
+    bool WriteLocked(const SharedRing::Message& message, std::chrono::milliseconds timeout);  // writeMutex held
+    void CountDrop(const std::string& topicName, const char* reason);
+
+    IEventService* eventService;
+    ILoggerService* logger;
+    LogCategory* logCategory;
+    const bool parent;
+    const std::vector<std::string> accepted;
+
+    std::mutex writeMutex;  // Guards out, closed and declared
+    SharedRing out;
+    bool closed = false;
+    std::vector<uint8_t> declared;  // By local topic: 1 sent to the other side, 2 received from it
+
+    // Requests sent and not answered yet, by slot (the low 32 bits of the id). A slot is only handed
+    // out again once its request completed, so a newer id replaces the older one and the map stays
+    // as small as the request table.
+    std::unordered_map<uint32_t, uint64_t> sentRequests;  // Guarded by writeMutex
+
+    std::unordered_map<uint32_t, IEventService::TopicId> remoteTopics;  // Reader thread only
+    std::string violation;  // Reader thread only
+    std::atomic<uint64_t> dropped{0};
+};
+
+#endif // EVENTBRIDGE_H
@@ -0,0 +1,87 @@
+#include "SharedMemory.h"
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+SharedMemory::~SharedMemory() {
+    Release();
+}
+
+SharedMemory::SharedMemory(SharedMemory&& other) noexcept : fd(other.fd), data(other.data), size(other.size) {
+    other.fd = -1;
+    other.data = nullptr;
+    other.size = 0;
+}
+
+SharedMemory& SharedMemory::operator=(SharedMemory&& other) noexcept {
+    if (this != &other) {
+        Release();
+        fd = other.fd;
+        data = other.data;
+        size = other.size;
+        other.fd = -1;
+        other.data = nullptr;
+        other.size = 0;
+    }
+    return *this;
+}
+
+bool SharedMemory::Create(size_t regionSize, std::string& errorMessage) {
+    Release();
+#if defined(__linux__)
+    int created = ::memfd_create("apertus-shm", MFD_CLOEXEC);
+#else
+    // No anonymous memory files here: create a named object and unlink it right away
+    static std::atomic<unsigned> counter{0};
+    std::string name = "/apertus-" + std::to_string(::getpid()) + "-" + std::to_string(counter.fetch_add(1));
+    int created = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (created >= 0) {
+        ::shm_unlink(name.c_str());
+        ::fcntl(created, F_SETFD, FD_CLOEXEC);
+    }
+#endif
+    if (created < 0) {
+        errorMessage = std::string("shared memory: ") + std::strerror(errno);
+        return false;
+    }
+    if (::ftruncate(created, static_cast<off_t>(regionSize)) != 0) {
+        errorMessage = std::string("shared memory size: ") + std::strerror(errno);
+        ::close(created);
+        return false;
+    }
+    return Attach(created, errorMessage);
+}
+
+bool SharedMemory::Attach(int regionFd, std::string& errorMessage) {
+    Release();
+    struct stat status{};
+    void* mapped = MAP_FAILED;
+    if (::fstat(regionFd, &status) == 0) {
+        mapped = ::mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, regionFd, 0);
+    }
+    if (mapped == MAP_FAILED) {
+        errorMessage = std::string("shared memory mapping: ") + std::strerror(errno);
+        ::close(regionFd);
+        return false;
+    }
+    fd = regionFd;
+    data = mapped;
+    size = static_cast<size_t>(status.st_size);
+    return true;
+}
+
+void SharedMemory::Release() {
+    if (data != nullptr) {
+        ::munmap(data, size);
+        data = nullptr;
+        size = 0;
+    }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
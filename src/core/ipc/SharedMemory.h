@@ -0,0 +1,46 @@
+#ifndef SHAREDMEMORY_H
+#define SHAREDMEMORY_H
+
+#include <cstddef>
+#include <string>
+
+/**
+ * @class SharedMemory
+ * @brief Anonymous shared memory region, handed to a child process as a file descriptor.
+ * @details The region has no name in the file system, so nothing is left behind when both sides
+ * exit. The descriptor is close-on-exec; the spawner duplicates it into the child explicitly.
+ */
+class SharedMemory {
+public:
+    SharedMemory() = default;
+    ~SharedMemory();
+
+    SharedMemory(SharedMemory&& other) noexcept;
+    SharedMemory& operator=(SharedMemory&& other) noexcept;
+    SharedMemory(const SharedMemory&) = delete;
+    SharedMemory& operator=(const SharedMemory&) = delete;
+
+    /**
+     * @brief Creates and maps a zero-filled region.
+     * @return false with errorMessage set on failure.
+     */
+    bool Create(size_t size, std::string& errorMessage);
+
+    /**
+     * @brief Maps a region created by another process; takes ownership of fd.
+     */
+    bool Attach(int fd, std::string& errorMessage);
+
+    void* Data() const { return data; }
+    size_t Size() const { return size; }
+    int Fd() const { return fd; }
+
+private:
+    void Release();
+
+    int fd = -1;
+    void* data = nullptr;
+    size_t size = 0;
+};
+
+#endif // SHAREDMEMORY_H
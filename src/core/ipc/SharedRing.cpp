@@ -0,0 +1,234 @@
+#include "SharedRing.h"
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <thread>
+#if defined(__linux__)
+#include <climits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Positions count bytes ever written or read; they never wrap in practice, only their offsets do
+struct SharedRing::Header {
+    alignas(64) std::atomic<uint64_t> head;  // Advanced by the producer
+    alignas(64) std::atomic<uint64_t> tail;  // Advanced by the consumer
+    alignas(64) std::atomic<uint32_t> dataSignal;   // Futex words, bumped to wake the other side
+    std::atomic<uint32_t> spaceSignal;
+    std::atomic<uint32_t> consumerWaiting;
+    std::atomic<uint32_t> producerWaiting;
+    std::atomic<uint32_t> closed;
+};
+
+struct SharedRing::Record {
+    uint32_t size;  // Data bytes
+    uint16_t type;  // 0 skips to the start of the ring
+    uint16_t flags;
+    uint32_t topic;
+    uint32_t padding;
+    uint64_t value;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+              "atomics in shared memory must not depend on a process-local lock");
+
+namespace {
+constexpr uint16_t kSkip = 0;
+constexpr int kSpinCount = 64;
+}
+
+size_t SharedRing::RegionSize(size_t capacity) {
+    return sizeof(Header) + capacity;
+}
+
+SharedRing::SharedRing(void* region, size_t capacity, bool initialize, uint16_t lastType)
+    : header(static_cast<Header*>(region)), data(static_cast<char*>(region) + sizeof(Header)), capacity(capacity), lastType(lastType) {
+    if (initialize) {
+        new (header) Header();
+    }
+}
+
+size_t SharedRing::RecordSize(size_t payload) {
+    return (sizeof(Record) + payload + 7) & ~size_t(7);
+}
+
+bool SharedRing::Write(const Message& message, std::chrono::milliseconds timeout) {
+    size_t needed = RecordSize(message.size);
+    if (needed > capacity / 2) {
+        return false;
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    uint64_t head = header->head.load(std::memory_order_relaxed);
+    size_t offset = head & (capacity - 1);
+    size_t skipped = capacity - offset < needed ? capacity - offset : 0;
+    for (int spin = 0;; ++spin) {
+        if (header->closed.load(std::memory_order_acquire) != 0) {
+            return false;
+        }
+        uint64_t tail = header->tail.load(std::memory_order_acquire);
+        if (capacity - (head - tail) >= skipped + needed) {
+            break;
+        }
+        if (spin < kSpinCount) {
+            std::this_thread::yield();
+            continue;
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) {
+            return false;
+        }
+        // Same handshake as WaitReadable(), with the roles swapped
+        uint32_t signal = header->spaceSignal.load(std::memory_order_seq_cst);
+        header->producerWaiting.store(1, std::memory_order_seq_cst);
+        if (capacity - (head - header->tail.load(std::memory_order_seq_cst)) < skipped + needed &&
+            header->closed.load(std::memory_order_seq_cst) == 0) {
+            WaitFor(header->spaceSignal, signal, std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now) + std::chrono::milliseconds(1));
+        }
+        header->producerWaiting.store(0, std::memory_order_relaxed);
+    }
+
+    if (skipped != 0) {
+        Record skip{};
+        skip.type = kSkip;
+        std::memcpy(data + offset, &skip, sizeof(uint64_t));  // Offsets are 8-byte aligned, the first 8 bytes always fit
+        head += skipped;
+        offset = 0;
+    }
+    Record record{};
+    record.size = static_cast<uint32_t>(message.size);
+    record.type = message.type;
+    record.flags = message.flags;
+    record.topic = message.topic;
+    record.value = message.value;
+    std::memcpy(data + offset, &record, sizeof(Record));
+    if (message.size != 0) {
+        std::memcpy(data + offset + sizeof(Record), message.data, message.size);
+    }
+    header->head.store(head + needed, std::memory_order_seq_cst);
+    if (header->consumerWaiting.load(std::memory_order_seq_cst) != 0) {
+        header->dataSignal.fetch_add(1, std::memory_order_seq_cst);
+        Wake(header->dataSignal);
+    }
+    return true;
+}
+
+bool SharedRing::TryRead(Message& message) {
+    if (corrupt) {
+        return false;
+    }
+    uint64_t tail = header->tail.load(std::memory_order_relaxed);
+    for (;;) {
+        uint64_t head = header->head.load(std::memory_order_acquire);
+        if (tail == head) {
+            return false;
+        }
+        // Everything below comes from the other process and is checked before it is used
+        if (head - tail > capacity || (tail & 7) != 0) {
+            return MarkCorrupt();
+        }
+        size_t offset = tail & (capacity - 1);
+        Record record;
+        std::memcpy(&record, data + offset, sizeof(uint64_t));
+        if (record.type == kSkip) {
+            if (head - tail < capacity - offset) {
+                return MarkCorrupt();
+            }
+            tail += capacity - offset;
+            header->tail.store(tail, std::memory_order_release);
+            continue;
+        }
+        if (offset + sizeof(Record) > capacity) {
+            return MarkCorrupt();
+        }
+        std::memcpy(&record, data + offset, sizeof(Record));
+        if (offset + sizeof(Record) + record.size > capacity || RecordSize(record.size) > head - tail || record.type > lastType) {
+            return MarkCorrupt();
+        }
+        message.type = record.type;
+        message.flags = record.flags;
+        message.topic = record.topic;
+        message.value = record.value;
+        message.data = data + offset + sizeof(Record);
+        message.size = record.size;
+        pendingRelease = RecordSize(record.size);
+        return true;
+    }
+}
+
+bool SharedRing::MarkCorrupt() {
+    corrupt = true;
+    Close();
+    return false;
+}
+
+void SharedRing::Release() {
+    header->tail.fetch_add(pendingRelease, std::memory_order_seq_cst);
+    pendingRelease = 0;
+    if (header->producerWaiting.load(std::memory_order_seq_cst) != 0) {
+        header->spaceSignal.fetch_add(1, std::memory_order_seq_cst);
+        Wake(header->spaceSignal);
+    }
+}
+
+bool SharedRing::WaitReadable(std::chrono::milliseconds timeout) {
+    auto readable = [this] {
+        return header->head.load(std::memory_order_seq_cst) != header->tail.load(std::memory_order_relaxed) ||
+               header->closed.load(std::memory_order_seq_cst) != 0;
+    };
+    for (int spin = 0; spin < kSpinCount; ++spin) {
+        if (readable()) {
+            return true;
+        }
+        std::this_thread::yield();
+    }
+
+    // The signal is read before announcing the wait: a producer that bumps it after this point
+    // makes the futex wait return at once, one that bumped it before has published its message
+    uint32_t signal = header->dataSignal.load(std::memory_order_seq_cst);
+    header->consumerWaiting.store(1, std::memory_order_seq_cst);
+    if (!readable()) {
+        WaitFor(header->dataSignal, signal, timeout);
+    }
+    header->consumerWaiting.store(0, std::memory_order_relaxed);
+    return readable();
+}
+
+void SharedRing::Close() {
+    header->closed.store(1, std::memory_order_seq_cst);
+    header->dataSignal.fetch_add(1, std::memory_order_seq_cst);
+    header->spaceSignal.fetch_add(1, std::memory_order_seq_cst);
+    Wake(header->dataSignal);
+    Wake(header->spaceSignal);
+}
+
+bool SharedRing::Closed() const {
+    return header->closed.load(std::memory_order_acquire) != 0;
+}
+
+size_t SharedRing::Used() const {
+    return static_cast<size_t>(header->head.load(std::memory_order_relaxed) - header->tail.load(std::memory_order_relaxed));
+}
+
+void SharedRing::Wake(std::atomic<uint32_t>& word) {
+#if defined(__linux__)
+    // Not FUTEX_PRIVATE_FLAG: the waiter is in another process
+    ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#else
+    (void)word;
+#endif
+}
+
+void SharedRing::WaitFor(std::atomic<uint32_t>& word, uint32_t value, std::chrono::milliseconds timeout) {
+#if defined(__linux__)
+    timespec relative{};
+    relative.tv_sec = static_cast<time_t>(timeout.count() / 1000);
+    relative.tv_nsec = static_cast<long>(timeout.count() % 1000) * 1000000;
+    ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, value, &relative, nullptr, 0);
+#else
+    if (word.load() == value) {
+        std::this_thread::sleep_for(std::min(timeout, std::chrono::milliseconds(1)));
+    }
+#endif
+}
@@ -0,0 +1,93 @@
+#ifndef SHAREDRING_H
+#define SHAREDRING_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @class SharedRing
+ * @brief Single-producer/single-consumer message ring placed in memory shared between processes.
+ * @details Messages are written once, straight into the ring, and read in place: TryRead() hands
+ * out a view of the message that stays valid until Release(). A message never wraps; if it does
+ * not fit before the end of the ring, the rest is skipped. Wakeups go through futexes on words in
+ * the ring itself, and only when the other side is actually waiting, so a busy ring costs no
+ * system calls at all. Elsewhere than on Linux, waiting falls back to short sleeps.
+ *
+ * Both processes construct a SharedRing on the same memory; the creator passes initialize = true.
+ * One thread at a time may write and one may read; callers serialize writers themselves.
+ */
+class SharedRing {
+public:
+    struct Message {
+        uint16_t type = 0;   // Never 0, that is reserved for the ring itself
+        uint16_t flags = 0;
+        uint32_t topic = 0;
+        uint64_t value = 0;  // A word that travels in the record header, no data bytes needed
+        const char* data = nullptr;
+        size_t size = 0;
+    };
+
+    /**
+     * @brief Bytes of shared memory a ring of the given capacity needs.
+     * @param capacity Data bytes, a power of two.
+     */
+    static size_t RegionSize(size_t capacity);
+
+    // lastType: the highest message type the reader knows, a record above it is corrupt
+    SharedRing(void* region, size_t capacity, bool initialize, uint16_t lastType = UINT16_MAX);
+
+    /**
+     * @brief Copies a message into the ring, waiting while the ring is full.
+     * @param timeout Longest wait for space; the message is dropped after it.
+     * @return false if the message was dropped: no space in time, the ring is closed, or the message
+     * is larger than half the ring.
+     */
+    bool Write(const Message& message, std::chrono::milliseconds timeout);
+
+    /**
+     * @brief Takes the oldest message without waiting; its data stays valid until Release().
+     * @details The other process may write anything into the ring. A record that does not fit in
+     * the ring or in what was written, or has an unknown type, makes the ring corrupt: it is closed
+     * and nothing is read from it anymore.
+     */
+    bool TryRead(Message& message);
+
+    // Set by TryRead(), in this process only; the writer must be assumed to be broken
+    bool Corrupt() const { return corrupt; }
+
+    // Frees the message of the last successful TryRead()
+    void Release();
+
+    /**
+     * @brief Waits until a message can be read or the ring is closed.
+     * @return false on timeout.
+     */
+    bool WaitReadable(std::chrono::milliseconds timeout);
+
+    // Both sides stop waiting; Write() fails from then on
+    void Close();
+    bool Closed() const;
+
+    // Bytes written and not read yet
+    size_t Used() const;
+
+private:
+    struct Header;
+    struct Record;
+
+    static size_t RecordSize(size_t payload);
+    bool MarkCorrupt();  // Closes the ring, returns false for TryRead()
+    static void Wake(std::atomic<uint32_t>& word);
+    static void WaitFor(std::atomic<uint32_t>& word, uint32_t value, std::chrono::milliseconds timeout);
+
+    Header* header;
+    char* data;
+    size_t capacity;
+    uint16_t lastType;
+    uint64_t pendingRelease = 0;  // Size of the record handed out by TryRead()
+    bool corrupt = false;
+};
+
+#endif // SHAREDRING_H
@@ -0,0 +1,22 @@
+#include "ConsoleSink.h"
+#include <iostream>
+#include <unistd.h>
+
+void ConsoleSink::Write(const LogMessage* messages, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        buffer.append(messages[i].text.data(), messages[i].text.size());
+        buffer.push_back('\n');
+    }
+}
+
+void ConsoleSink::Flush() {
+    if (!buffer.empty()) {
+        std::cout.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        buffer.clear();
+    }
+    std::cout.flush();
+}
+
+int ConsoleSink::CrashFd() const {
+    return STDOUT_FILENO;
+}
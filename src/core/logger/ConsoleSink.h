@@ -0,0 +1,21 @@
+#ifndef CONSOLESINK_H
+#define CONSOLESINK_H
+
+#include "interfaces/ILogSink.h"
+#include <string>
+
+/**
+ * @class ConsoleSink
+ * @brief Writes messages to std::cout, one write and one flush per batch.
+ */
+class ConsoleSink : public ILogSink {
+public:
+    void Write(const LogMessage* messages, size_t count) override;
+    void Flush() override;
+    int CrashFd() const override;
+
+private:
+    std::string buffer;
+};
+
+#endif // CONSOLESINK_H
@@ -0,0 +1,180 @@
+#include "FileSink.h"
+#include "interfaces/ILoggerService.h"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace {
+const char* LevelName(LogLevel level) {
+    switch (level) {
+        case LogLevel::Trace:
+            return "TRACE";
+        case LogLevel::Debug:
+            return "DEBUG";
+        case LogLevel::Info:
+            return "INFO ";
+        case LogLevel::Warning:
+            return "WARN ";
+        case LogLevel::Error:
+            return "ERROR";
+        default:
+            return "     ";
+    }
+}
+
+#ifdef IOV_MAX
+constexpr size_t kMaxIovecs = IOV_MAX;
+#else
+constexpr size_t kMaxIovecs = 1024;
+#endif
+}
+
+FileSink::FileSink(std::string path)
+    : FileSink(std::move(path), Options()) {}
+
+FileSink::FileSink(std::string path, Options options)
+    : path(std::move(path)), options(options) {}
+
+FileSink::~FileSink() {
+    Flush();
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+bool FileSink::Open(std::string& errorMessage) {
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        errorMessage = "cannot open " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    struct stat status;
+    fileSize = ::fstat(fd, &status) == 0 ? static_cast<size_t>(status.st_size) : 0;
+    openedAt = std::chrono::steady_clock::now();
+    return true;
+}
+
+void FileSink::Write(const LogMessage* messages, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        Append(messages[i]);
+    }
+}
+
+void FileSink::Append(const LogMessage& message) {
+    int64_t second = static_cast<int64_t>(message.time / 1000000000);
+    if (second != lastSecond) {
+        time_t seconds = static_cast<time_t>(second);
+        struct tm local;
+        localtime_r(&seconds, &local);
+        std::strftime(secondPrefix, sizeof(secondPrefix), "%Y-%m-%d %H:%M:%S", &local);
+        lastSecond = second;
+    }
+    char prefix[64];
+    int prefixSize = std::snprintf(prefix, sizeof(prefix), "%s.%06u %s ", secondPrefix,
+                                   static_cast<unsigned>(message.time / 1000 % 1000000), LevelName(message.level));
+    size_t lineSize = static_cast<size_t>(prefixSize) + message.text.size() + 1;
+
+    if (usedBlocks == 0 || (blocks[usedBlocks - 1].size() + lineSize > kBlockSize && !blocks[usedBlocks - 1].empty())) {
+        if (usedBlocks == blocks.size()) {
+            blocks.emplace_back();
+            blocks.back().reserve(kBlockSize);
+        }
+        blocks[usedBlocks++].clear();
+    }
+    std::string& block = blocks[usedBlocks - 1];
+    block.append(prefix, static_cast<size_t>(prefixSize));
+    block.append(message.text.data(), message.text.size());
+    block.push_back('\n');
+    pendingBytes += lineSize;
+}
+
+void FileSink::Flush() {
+    if (pendingBytes == 0) {
+        return;
+    }
+    if (fd >= 0 && fileSize > 0 && options.rotateInterval.count() > 0 &&
+        std::chrono::steady_clock::now() - openedAt >= options.rotateInterval) {
+        Rotate();
+    }
+
+    // Write as many blocks as fit the size limit at once, rotate in between
+    size_t first = 0;
+    while (fd >= 0 && first < usedBlocks) {
+        size_t last = first;
+        size_t bytes = 0;
+        while (last < usedBlocks && (options.maxFileSize == 0 || fileSize + bytes == 0 ||
+                                     fileSize + bytes + blocks[last].size() <= options.maxFileSize)) {
+            bytes += blocks[last++].size();
+        }
+        if (last == first) {
+            Rotate();
+            continue;
+        }
+        if (!WriteBlocks(first, last)) {
+            std::cerr << "[FileSink] Cannot write " << path << ": " << std::strerror(errno) << std::endl;
+            break;
+        }
+        first = last;
+    }
+    usedBlocks = 0;
+    pendingBytes = 0;
+}
+
+bool FileSink::WriteBlocks(size_t firstBlock, size_t lastBlock) {
+    iovecs.clear();
+    for (size_t i = firstBlock; i < lastBlock; ++i) {
+        if (!blocks[i].empty()) {
+            iovecs.push_back({const_cast<char*>(blocks[i].data()), blocks[i].size()});
+        }
+    }
+
+    size_t first = 0;
+    while (first < iovecs.size()) {
+        int count = static_cast<int>(std::min(iovecs.size() - first, kMaxIovecs));
+        ssize_t written = ::writev(fd, &iovecs[first], count);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        fileSize += static_cast<size_t>(written);
+
+        // Skip what went out, a short write leaves part of one block
+        size_t remaining = static_cast<size_t>(written);
+        while (first < iovecs.size() && remaining >= iovecs[first].iov_len) {
+            remaining -= iovecs[first++].iov_len;
+        }
+        if (first < iovecs.size()) {
+            iovecs[first].iov_base = static_cast<char*>(iovecs[first].iov_base) + remaining;
+            iovecs[first].iov_len -= remaining;
+        }
+    }
+    return true;
+}
+
+void FileSink::Rotate() {
+    ::close(fd);
+    fd = -1;
+    if (options.maxFiles == 0) {
+        ::unlink(path.c_str());
+    } else {
+        for (size_t i = options.maxFiles; i > 1; --i) {
+            ::rename((path + "." + std::to_string(i - 1)).c_str(), (path + "." + std::to_string(i)).c_str());
+        }
+        ::rename(path.c_str(), (path + ".1").c_str());
+    }
+
+    std::string errorMessage;
+    if (!Open(errorMessage)) {
+        std::cerr << "[FileSink] Rotation failed, " << errorMessage << std::endl;
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef FILESINK_H
+#define FILESINK_H
+
+#include "interfaces/ILogSink.h"
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <sys/uio.h>
+
+/**
+ * @class FileSink
+ * @brief Appends messages to a file, batched into large blocks written with one writev() per flush.
+ * @details Each line is prefixed with the local time and the level. The file is rotated when it would
+ * grow beyond maxFileSize or is older than rotateInterval: "app.log" becomes "app.log.1", "app.log.1"
+ * becomes "app.log.2" and so on, keeping at most maxFiles old files.
+ */
+class FileSink : public ILogSink {
+public:
+    struct Options {
+        size_t maxFileSize = size_t(64) << 20;      // 0 for no size limit
+        size_t maxFiles = 5;                        // Rotated files kept besides the current one
+        std::chrono::seconds rotateInterval{0};     // 0 for no time-based rotation
+    };
+
+    // Lines are collected in blocks of this size before writing
+    static constexpr size_t kBlockSize = size_t(64) << 10;
+
+    explicit FileSink(std::string path);
+    FileSink(std::string path, Options options);
+    ~FileSink() override;
+
+    FileSink(const FileSink&) = delete;
+    FileSink& operator=(const FileSink&) = delete;
+
+    /**
+     * @brief Opens the file for appending.
+     * @return false if it cannot be opened; errorMessage tells why.
+     */
+    bool Open(std::string& errorMessage);
+
+    void Write(const LogMessage* messages, size_t count) override;
+    void Flush() override;
+    int CrashFd() const override { return fd; }
+
+private:
+    void Append(const LogMessage& message);
+    void Rotate();
+    bool WriteBlocks(size_t firstBlock, size_t lastBlock);
+
+    std::string path;
+    Options options;
+    int fd = -1;
+    size_t fileSize = 0;
+    std::chrono::steady_clock::time_point openedAt;
+
+    std::vector<std::string> blocks;  // Filled up to usedBlocks, kept allocated between batches
+    size_t usedBlocks = 0;
+    size_t pendingBytes = 0;
+    std::vector<iovec> iovecs;
+
+    // Formatted "YYYY-MM-DD HH:MM:SS" of lastSecond, most messages share it with their predecessor
+    int64_t lastSecond = -1;
+    char secondPrefix[32] = {};
+};
+
+#endif // FILESINK_H
@@ -1,13 +1,400 @@
 #include "LoggerService.h"
+#include "ConsoleSink.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <ctime>
 #include <iostream>
+#include <unistd.h>
 
-// void LoggerService::Log(const std::string& message) {
-//     std::lock_guard<std::mutex> guard(logMutex);
-//     std::cout << "[Logger] " << message << std::endl;
-// }
+namespace {
+// Buffers this thread logs into, one per logger instance; retired when the thread exits
+struct ThreadBuffers {
+    std::vector<std::pair<uint64_t, std::shared_ptr<LogBuffer>>> entries;
+
+    // Alternate stack of the fatal signal handler, so it still runs after a stack overflow
+    std::unique_ptr<char[]> signalStack;
+
+    void InstallSignalStack() {
+        stack_t current;
+        if (signalStack || (::sigaltstack(nullptr, &current) == 0 && (current.ss_flags & SS_DISABLE) == 0)) {
+            return;  // Installed before, by us or someone else
+        }
+        size_t size = std::max<size_t>(SIGSTKSZ, size_t(64) << 10);
+        signalStack.reset(new char[size]);
+        stack_t stack = {};
+        stack.ss_sp = signalStack.get();
+        stack.ss_size = size;
+        if (::sigaltstack(&stack, nullptr) != 0) {
+            signalStack.reset();
+        }
+    }
+
+    ~ThreadBuffers() {
+        for (auto& entry : entries) {
+            entry.second->Retire();
+        }
+        if (signalStack) {
+            stack_t disable = {};
+            disable.ss_flags = SS_DISABLE;
+            ::sigaltstack(&disable, nullptr);
+        }
+    }
+};
+
+thread_local ThreadBuffers threadBuffers;
+
+// Last buffer used by this thread, so the common case is two thread-local reads
+thread_local uint64_t cachedLogger = 0;
+thread_local LogBuffer* cachedBuffer = nullptr;
+
+std::atomic<uint64_t> nextInstanceId{1};
+
+// Logger flushed by the fatal signal handler, the most recently constructed one
+std::atomic<LoggerService*> crashLogger{nullptr};
+std::once_flag crashHandlerInstalled;
+
+constexpr int kFatalSignals[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+constexpr size_t kFatalSignalCount = sizeof(kFatalSignals) / sizeof(kFatalSignals[0]);
+struct sigaction previousActions[kFatalSignalCount];
+
+// Holds LoggerService::draining for a scope; only a crashing thread competes, and it gives up in time
+class DrainingScope {
+public:
+    explicit DrainingScope(std::atomic<bool>& draining) : draining(draining) {
+        while (draining.exchange(true, std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+    }
+    ~DrainingScope() { draining.store(false, std::memory_order_release); }
+
+private:
+    std::atomic<bool>& draining;
+};
+
+// Async-signal-safe clock for the crash path
+uint64_t MonotonicNanoseconds() {
+    timespec now;
+    ::clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000 + static_cast<uint64_t>(now.tv_nsec);
+}
+
+void WriteAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+}
+
+int64_t ClockOffset() {
+    auto system = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch());
+    auto steady = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch());
+    return static_cast<int64_t>((system - steady).count());
+}
+}
+
+LoggerService::LoggerService(IConfigService* config)
+    : LoggerService(config->GetThreadPolicy("logger")) {}
+
+LoggerService::LoggerService(const ThreadPolicy& threadPolicy)
+    : instanceId(nextInstanceId.fetch_add(1)),
+      sinks{std::make_shared<ConsoleSink>()},
+      crashBuffer(new char[kCrashBufferSize]),
+      clockOffset(ClockOffset()),
+      logThread(PolicyThread::Named(threadPolicy, "apx-logger"), [this] { ProcessLogs(); }) {
+    crashLogger.store(this);
+    threadBuffers.InstallSignalStack();
+    std::call_once(crashHandlerInstalled, [] {
+        struct sigaction action = {};
+        action.sa_handler = &LoggerService::OnFatalSignal;
+        action.sa_flags = SA_RESETHAND | SA_ONSTACK;
+        sigemptyset(&action.sa_mask);
+        for (size_t i = 0; i < kFatalSignalCount; ++i) {
+            ::sigaction(kFatalSignals[i], &action, &previousActions[i]);
+        }
+    });
+    std::cout << "[Logger] Log thread started!" << std::endl;
+    if (!logThread.PolicyError().empty()) {
+        std::cerr << "[Logger] Log thread policy not fully applied: " << logThread.PolicyError() << std::endl;
+    }
+}
+
+LoggerService::~LoggerService() {
+    LoggerService* self = this;
+    crashLogger.compare_exchange_strong(self, nullptr);
+
+    running = false;
+    logParker.Unpark();
+    logThread.Join();
+
+    // Nobody drains the buffers anymore, late messages are dropped instead of blocking their thread
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    for (auto& buffer : buffers) {
+        buffer->Close();
+    }
+}
 
 void LoggerService::Log(const std::string& message) {
-    std::lock_guard<std::mutex> guard(queueMutex);
-    logQueue.push(message);
-    logCondition.notify_one();
+    LogBuffer& buffer = Buffer();
+    buffer.Append(message);
+    Commit(buffer);
+}
+
+LogCategory& LoggerService::Category(const std::string& name) {
+    std::lock_guard<std::mutex> lock(categoryMutex);
+    CategoryEntry& entry = categories[name];
+    if (!entry.category) {
+        entry.category = std::make_unique<LogCategory>(name, defaultLevel);
+    }
+    return *entry.category;
+}
+
+void LoggerService::SetLevel(LogLevel level) {
+    std::lock_guard<std::mutex> lock(categoryMutex);
+    defaultLevel = level;
+    for (auto& entry : categories) {
+        if (!entry.second.explicitLevel) {
+            entry.second.category->SetLevel(level);
+        }
+    }
+}
+
+void LoggerService::SetLevel(const std::string& category, LogLevel level) {
+    std::lock_guard<std::mutex> lock(categoryMutex);
+    CategoryEntry& entry = categories[category];
+    if (!entry.category) {
+        entry.category = std::make_unique<LogCategory>(category, level);
+    }
+    entry.category->SetLevel(level);
+    entry.explicitLevel = true;
+}
+
+LogBuffer& LoggerService::Buffer() {
+    if (cachedLogger == instanceId) {
+        return *cachedBuffer;
+    }
+    for (auto& entry : threadBuffers.entries) {
+        if (entry.first == instanceId) {
+            cachedLogger = instanceId;
+            cachedBuffer = entry.second.get();
+            return *cachedBuffer;
+        }
+    }
+    return RegisterBuffer();
+}
+
+LogBuffer& LoggerService::RegisterBuffer() {
+    auto buffer = std::make_shared<LogBuffer>();
+    {
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        buffers.push_back(buffer);
+        for (auto& slot : crashBuffers) {
+            if (slot.load(std::memory_order_relaxed) == nullptr) {
+                slot.store(buffer.get(), std::memory_order_release);
+                break;
+            }
+        }
+    }
+    buffersChanged.store(true, std::memory_order_release);
+    threadBuffers.entries.emplace_back(instanceId, buffer);
+    threadBuffers.InstallSignalStack();
+    cachedLogger = instanceId;
+    cachedBuffer = buffer.get();
+    return *buffer;
+}
+
+void LoggerService::Commit(LogBuffer& buffer) {
+    buffer.Commit();
+    logParker.Unpark();
+}
+
+bool LoggerService::Pending() {
+    if (!running.load(std::memory_order_relaxed) || buffersChanged.load(std::memory_order_acquire)) {
+        return true;
+    }
+    for (const auto& buffer : activeBuffers) {
+        if (!buffer->Empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void LoggerService::ProcessLogs() {
+    threadBuffers.InstallSignalStack();  // A sink may crash on this thread too
+    for (;;) {
+        logParker.Park([this] { return Pending(); });
+        bool stopping = !running.load();
+        {
+            std::lock_guard<std::mutex> lock(drainMutex);
+            WriteOut();
+        }
+        if (stopping) {
+            break;  // Everything committed before the stop request has been written
+        }
+    }
+}
+
+void LoggerService::WriteOut() {
+    DrainingScope scope(draining);
+    if (buffersChanged.exchange(false, std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        // Forget buffers of exited threads once everything they logged is out
+        buffers.erase(std::remove_if(buffers.begin(), buffers.end(), [this](const std::shared_ptr<LogBuffer>& buffer) {
+            if (!buffer->Retired() || !buffer->Empty()) {
+                return false;
+            }
+            for (auto& slot : crashBuffers) {
+                LogBuffer* expected = buffer.get();
+                if (slot.compare_exchange_strong(expected, nullptr, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            return true;
+        }), buffers.end());
+        activeBuffers = buffers;
+    }
+
+    size_t written;
+    bool wrote = false;
+    do {
+        written = Drain();
+        if (written == 0) {
+            break;
+        }
+        wrote = true;
+        std::string text = batch.str();
+        batchMessages.clear();
+        for (const auto& entry : batchEntries) {
+            batchMessages.push_back({static_cast<uint64_t>(static_cast<int64_t>(entry.time) + clockOffset),
+                                     static_cast<LogLevel>(entry.level),
+                                     std::string_view(text).substr(entry.begin, entry.end - entry.begin)});
+        }
+        for (auto& sink : sinks) {
+            sink->Write(batchMessages.data(), batchMessages.size());
+        }
+        batch.str(std::string());
+        batchEntries.clear();
+    } while (written == kMaxBatch);
+
+    if (wrote) {
+        for (auto& sink : sinks) {
+            sink->Flush();
+        }
+    }
+}
+
+size_t LoggerService::Drain() {
+    // Merge the per-thread buffers by commit time, so the output follows the order of events
+    LogBuffer::MessageHeader header;
+    while (batchEntries.size() < kMaxBatch) {
+        LogBuffer* oldest = nullptr;
+        LogBuffer::MessageHeader oldestHeader{};
+        for (const auto& buffer : activeBuffers) {
+            if (buffer->Front(header) && (oldest == nullptr || header.time < oldestHeader.time)) {
+                oldest = buffer.get();
+                oldestHeader = header;
+            }
+        }
+        if (oldest == nullptr) {
+            break;
+        }
+        size_t begin = static_cast<size_t>(batch.tellp());
+        oldest->Format(batch);
+        batchEntries.push_back({oldestHeader.time, oldestHeader.level, begin, static_cast<size_t>(batch.tellp())});
+    }
+    return batchEntries.size();
+}
+
+void LoggerService::AddSink(std::shared_ptr<ILogSink> sink) {
+    std::lock_guard<std::mutex> lock(drainMutex);
+    DrainingScope scope(draining);
+    sinks.push_back(std::move(sink));
+}
+
+void LoggerService::RemoveSink(const std::shared_ptr<ILogSink>& sink) {
+    std::lock_guard<std::mutex> lock(drainMutex);
+    WriteOut();  // The sink gets everything logged while it was installed
+    DrainingScope scope(draining);
+    sinks.erase(std::remove(sinks.begin(), sinks.end(), sink), sinks.end());
+}
+
+void LoggerService::Flush() {
+    std::lock_guard<std::mutex> lock(drainMutex);
+    WriteOut();
+}
+
+void LoggerService::FlushOnCrash() {
+    // Signal handler: atomics, memcpy and system calls only. The log thread may be in the middle of a
+    // batch; give it a moment, but never hang a dying process on a batch the crashed thread was writing
+    uint64_t deadline = MonotonicNanoseconds() + static_cast<uint64_t>(std::chrono::nanoseconds(kCrashFlushTimeout).count());
+    while (draining.exchange(true, std::memory_order_acquire)) {
+        if (MonotonicNanoseconds() >= deadline) {
+            return;
+        }
+        timespec pause = {0, 1000000};
+        ::nanosleep(&pause, nullptr);
+    }
+
+    int fds[kMaxCrashFds];
+    size_t fdCount = 0;
+    for (const auto& sink : sinks) {
+        int fd = sink->CrashFd();
+        if (fd >= 0 && fdCount < kMaxCrashFds && std::find(fds, fds + fdCount, fd) == fds + fdCount) {
+            fds[fdCount++] = fd;
+        }
+    }
+
+    // Same merge as Drain(), over crashBuffers: activeBuffers lacks the threads that started logging
+    // since the last batch, quite likely the crashing one
+    char* text = crashBuffer.get();
+    size_t used = 0;
+    LogBuffer::MessageHeader header;
+    for (;;) {
+        LogBuffer* oldest = nullptr;
+        uint64_t oldestTime = 0;
+        for (const auto& slot : crashBuffers) {
+            LogBuffer* buffer = slot.load(std::memory_order_acquire);
+            if (buffer != nullptr && buffer->Front(header) && (oldest == nullptr || header.time < oldestTime)) {
+                oldest = buffer;
+                oldestTime = header.time;
+            }
+        }
+        if (oldest == nullptr) {
+            break;
+        }
+        if (kCrashBufferSize - used < kCrashLineSize) {
+            for (size_t i = 0; i < fdCount; ++i) {
+                WriteAll(fds[i], text, used);
+            }
+            used = 0;
+        }
+        used += oldest->FormatRaw(text + used, kCrashLineSize - 1);
+        text[used++] = '\n';
+    }
+    for (size_t i = 0; i < fdCount; ++i) {
+        WriteAll(fds[i], text, used);
+    }
+    draining.store(false, std::memory_order_release);
+}
+
+void LoggerService::OnFatalSignal(int signal) {
+    if (LoggerService* logger = crashLogger.exchange(nullptr)) {  // Once, even if flushing faults again
+        logger->FlushOnCrash();
+    }
+    // Die the way we would have without the handler
+    for (size_t i = 0; i < kFatalSignalCount; ++i) {
+        if (kFatalSignals[i] == signal) {
+            ::sigaction(signal, &previousActions[i], nullptr);
+        }
+    }
+    ::raise(signal);
 }
@@ -2,13 +2,115 @@
 #define LOGGERSERVICE_H
 
 #include "interfaces/ILoggerService.h"
+#include "interfaces/IConfigService.h"
+#include "concurrency/Parker.h"
+#include "concurrency/PolicyThread.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 #include <fruit/fruit.h>
 
+/**
+ * @class LoggerService
+ * @brief Asynchronous logger with one lock-free LogBuffer per logging thread.
+ * @details Logging threads never take a lock or format anything: they append raw arguments to their
+ * own buffer and commit it. The log thread merges the buffers by commit time, formats the messages
+ * and hands each batch to every sink, then flushes them; a ConsoleSink is installed by default.
+ * Fatal signals (SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT) write out what was committed before the
+ * process dies, straight to the sinks' crash descriptors: the handler runs on an alternate stack and
+ * takes no lock, allocates nothing and does not touch iostreams, so a crash inside malloc or a stream
+ * cannot deadlock it.
+ */
 class LoggerService : public ILoggerService {
 public:
-    INJECT(LoggerService()) = default;
+    INJECT(LoggerService(IConfigService* config));
+    explicit LoggerService(const ThreadPolicy& threadPolicy = ThreadPolicy());
+    ~LoggerService() override;
+
     void Log(const std::string& message) override;
+    LogCategory& Category(const std::string& name) override;
+    void SetLevel(LogLevel level) override;
+    void SetLevel(const std::string& category, LogLevel level) override;
+    void AddSink(std::shared_ptr<ILogSink> sink) override;
+    void RemoveSink(const std::shared_ptr<ILogSink>& sink) override;
+    void Flush() override;
+
+    // Messages formatted before the batch is written out
+    static constexpr size_t kMaxBatch = 1024;
+
+    // How long a crashing thread waits for the log thread to finish its batch
+    static constexpr std::chrono::milliseconds kCrashFlushTimeout{200};
+
+    // Preallocated for formatting in the signal handler; messages are cut at kCrashLineSize
+    static constexpr size_t kCrashBufferSize = size_t(64) << 10;
+    static constexpr size_t kCrashLineSize = size_t(4) << 10;
+    static constexpr size_t kMaxCrashFds = 8;
+    static constexpr size_t kMaxCrashBuffers = 1024;  // Logging threads a crash picks up
+
+protected:
+    LogBuffer& Buffer() override;
+    void Commit(LogBuffer& buffer) override;
+
+private:
+    LogBuffer& RegisterBuffer();
+    void ProcessLogs();
+    bool Pending();
+    void WriteOut();
+    size_t Drain();
+    void FlushOnCrash();
+    static void OnFatalSignal(int signal);
+
+    // Distinguishes instances in the per-thread buffer cache
+    const uint64_t instanceId;
+
+    struct CategoryEntry {
+        std::unique_ptr<LogCategory> category;
+        bool explicitLevel = false;  // Set with SetLevel(category, level), ignores the default level
+    };
+
+    std::mutex categoryMutex;
+    std::unordered_map<std::string, CategoryEntry> categories;
+    LogLevel defaultLevel = LogLevel::Info;
+
+    // Buffers of all threads that logged so far; the list is only changed under buffersMutex, the
+    // log thread works on its own copy
+    std::mutex buffersMutex;
+    std::vector<std::shared_ptr<LogBuffer>> buffers;
+    std::atomic<bool> buffersChanged{false};
+    // The same buffers for the fatal signal handler, which cannot take buffersMutex. Filled under it;
+    // cleared under it and draining, before the buffer can be freed.
+    std::atomic<LogBuffer*> crashBuffers[kMaxCrashBuffers] = {};
+    // Everything below is owned by whoever holds drainMutex (the log thread or Flush()) and draining.
+    // A crash cannot take the mutex, it only waits for draining, which holders set while they use it.
+    std::mutex drainMutex;
+    std::atomic<bool> draining{false};
+    std::vector<std::shared_ptr<LogBuffer>> activeBuffers;
+    std::vector<std::shared_ptr<ILogSink>> sinks;
+
+    struct BatchEntry {
+        uint64_t time;  // Steady clock
+        uint8_t level;
+        size_t begin;   // Text range in batch
+        size_t end;
+    };
+    std::ostringstream batch;
+    std::vector<BatchEntry> batchEntries;
+    std::vector<LogMessage> batchMessages;
+    std::unique_ptr<char[]> crashBuffer;
+
+    // System clock minus steady clock, for the wall time of messages
+    const int64_t clockOffset;
+
+    Parker logParker;
+    std::atomic<bool> running{true};
+    PolicyThread logThread;
 };
 
 #endif // LOGGERSERVICE_H
@@ -0,0 +1,102 @@
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include "interfaces/IEventService.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @class LatencyHistogram
+ * @brief Lock-free log-linear histogram of durations in nanoseconds (HDR histogram style).
+ * @details Every power of two is split into kSubBuckets linear buckets, so any value from 1 ns to
+ * hundreds of years is recorded with a relative error of at most 1/kSubBuckets, in fixed memory.
+ * Record() is a few relaxed atomic adds and may be called from any number of threads; Snapshot()
+ * may run concurrently and sees a slightly torn but consistent-enough view.
+ */
+class LatencyHistogram {
+public:
+    static constexpr unsigned kSubBucketBits = 3;
+    static constexpr uint64_t kSubBuckets = uint64_t(1) << kSubBucketBits;
+    static constexpr size_t kBucketCount = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+    /**
+     * @brief Monotonic timestamp in nanoseconds, for computing the durations to record.
+     */
+    static uint64_t Now() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    void Record(uint64_t value) {
+        buckets[BucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+        sum.fetch_add(value, std::memory_order_relaxed);
+        uint64_t current = max.load(std::memory_order_relaxed);
+        while (value > current && !max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    EventLatencyStats Snapshot() const {
+        EventLatencyStats stats;
+        for (const auto& bucket : buckets) {
+            stats.count += bucket.load(std::memory_order_relaxed);
+        }
+        stats.max = max.load(std::memory_order_relaxed);
+        if (stats.count == 0) {
+            return stats;
+        }
+        stats.mean = sum.load(std::memory_order_relaxed) / stats.count;
+
+        // Percentile targets, rounded up so p99 of 10 values is the 10th
+        const uint64_t p50 = (stats.count * 50 + 99) / 100;
+        const uint64_t p90 = (stats.count * 90 + 99) / 100;
+        const uint64_t p99 = (stats.count * 99 + 99) / 100;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBucketCount && stats.p99 == 0; ++i) {
+            uint64_t inBucket = buckets[i].load(std::memory_order_relaxed);
+            if (inBucket == 0) {
+                continue;
+            }
+            seen += inBucket;
+            uint64_t upper = std::min(UpperBound(i), stats.max);
+            if (stats.p50 == 0 && seen >= p50) {
+                stats.p50 = upper;
+            }
+            if (stats.p90 == 0 && seen >= p90) {
+                stats.p90 = upper;
+            }
+            if (seen >= p99) {
+                stats.p99 = upper;
+            }
+        }
+        return stats;
+    }
+
+private:
+    static size_t BucketOf(uint64_t value) {
+        if (value < kSubBuckets) {
+            return static_cast<size_t>(value);  // Exact below kSubBuckets
+        }
+        unsigned exponent = 63 - static_cast<unsigned>(__builtin_clzll(value));
+        uint64_t sub = (value >> (exponent - kSubBucketBits)) & (kSubBuckets - 1);
+        return static_cast<size_t>((exponent - kSubBucketBits + 1) * kSubBuckets + sub);
+    }
+
+    static uint64_t UpperBound(size_t bucket) {
+        if (bucket < kSubBuckets) {
+            return bucket;
+        }
+        unsigned exponent = static_cast<unsigned>(bucket / kSubBuckets) + kSubBucketBits - 1;
+        uint64_t sub = bucket % kSubBuckets;
+        uint64_t width = uint64_t(1) << (exponent - kSubBucketBits);
+        return ((kSubBuckets + sub) << (exponent - kSubBucketBits)) + (width - 1);
+    }
+
+    std::atomic<uint64_t> buckets[kBucketCount] = {};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> max{0};
+};
+
+#endif // LATENCYHISTOGRAM_H
@@ -1,76 +1,344 @@
 #include "Plugin.h"
+#include <algorithm>
 #include <iostream>
 
-Plugin::Plugin(IEventService* eventService, ILoggerService* logger)
-    : eventService(eventService), logger(logger), running(false) {}
+namespace {
+thread_local const IPlugin* currentPlugin = nullptr;  // See Plugin::Current()
+}
+
+Plugin::Plugin(IEventService* eventService, ILoggerService* logger, IExecutorService* executor)
+    : eventService(eventService), logger(logger), executor(executor), logCategory(&logger->Category("Plugin")), running(false),
+      postTopic(eventService->RegisterTopic("plugin/post")),
+      postHandler([](const EventPayload& payload) {
+          if (auto task = payload.As<IExecutorService::Task>()) {
+              (*task)();
+          }
+      }) {}
 
 Plugin::~Plugin() {
-    (*logger) << "[Plugin] Destructor called." << std::endl;
+    APX_LOG_DEBUG(logger, logCategory) << "[Plugin] Destructor called." << std::endl;
     Destroy();
+
+    // Long-running tasks end when they see running go false; their accounting still touches this
+    while (longRunningTasks.load(std::memory_order_acquire) != 0) {
+        std::this_thread::yield();
+    }
 }
 
 void Plugin::Init() {
-    (*logger) << "[Plugin] Base Plugin initialized, starting event listener thread." << std::endl;
-
+    logCategory = &logger->Category(GetName());
     running = true;
-    eventListenerThread = std::thread(&Plugin::EventProcessingLoop, this);
+
+    if (!hasThreadPolicy) {
+        APX_LOG_DEBUG(logger, logCategory) << "[Plugin] Base Plugin initialized, events are handled on the executor." << std::endl;
+        return;
+    }
+    mailboxThreadRunning = true;
+    mailboxThread = PolicyThread(PolicyThread::Named(threadPolicy, GetName()), [this] { MailboxLoop(); });
+    dedicatedThread = true;
+    if (!mailboxThread.PolicyError().empty()) {
+        APX_LOG_WARNING(logger, logCategory) << "[Plugin] Thread policy not fully applied: " << mailboxThread.PolicyError() << std::endl;
+    }
+    APX_LOG_DEBUG(logger, logCategory) << "[Plugin] Base Plugin initialized, events are handled on a thread of its own." << std::endl;
+}
+
+void Plugin::SetThreadPolicy(const ThreadPolicy& policy) {
+    threadPolicy = policy;
+    hasThreadPolicy = true;
 }
 
 void Plugin::Run() {
-    (*logger) << "[Plugin] Running on thread ID: " << std::this_thread::get_id() << std::endl;
-    while (running) {
-        std::this_thread::sleep_for(std::chrono::seconds(1));  // Simulated work
-    }
+    // Nothing to do by default; periodic work is scheduled with IEventService::TriggerEvery()
+    APX_LOG_INFO(logger, logCategory) << "[Plugin] Running on thread ID: " << std::this_thread::get_id() << std::endl;
 }
 
 void Plugin::Destroy() {
+    // Detach from the EventService first, the callbacks capture this
+    std::vector<IEventService::SubscriptionId> tokens;
+    {
+        std::lock_guard<std::mutex> lock(eventMutex);
+        tokens.swap(subscriptions);
+    }
+    for (auto subscription : tokens) {
+        eventService->Unsubscribe(subscription);
+    }
+
+    if (currentPlugin == this) {
+        // Waiting for the mailbox or the tasks would wait for the caller; the destructor waits instead
+        APX_LOG_WARNING(logger, logCategory) << "[Plugin] Destroy() called from the plugin's own handler, dropping the queued events" << std::endl;
+        running = false;
+        return;
+    }
+
+    // Handle what was queued before, an unloaded or reloaded plugin must not lose commands
+    while (running && queued.load(std::memory_order_acquire) != 0) {
+        std::this_thread::yield();
+    }
+
     running = false;
-    eventCondition.notify_all();
 
-    if (eventListenerThread.joinable()) {
-        eventListenerThread.join();
+    // Only deliveries that were already in flight remain; wait for the tasks, they drop what is left
+    while (queued.load(std::memory_order_acquire) != 0 || activeTasks.load(std::memory_order_acquire) != 0) {
+        std::this_thread::yield();
+    }
+
+    if (mailboxThread.Joinable()) {
+        mailboxThreadRunning = false;
+        mailboxParker.Unpark();
+        mailboxThread.Join();
     }
 }
 
+void Plugin::submit(IExecutorService::Task task) {
+    activeTasks.fetch_add(1);
+    executor->Submit([this, task = std::move(task)] {
+        struct Done {
+            std::atomic<size_t>& activeTasks;
+            ~Done() { activeTasks.fetch_sub(1, std::memory_order_release); }
+        } done{activeTasks};
+        CallbackScope scope(this);
+        CpuScope cpu(*this);  // Ends before done
+        if (running) {
+            task();
+        }
+    });
+}
+
+void Plugin::submitLongRunning(IExecutorService::Task task) {
+    longRunningTasks.fetch_add(1);
+    auto accounted = [this, task = std::move(task)] {
+        struct Done {
+            std::atomic<size_t>& longRunningTasks;
+            ~Done() { longRunningTasks.fetch_sub(1, std::memory_order_release); }
+        } done{longRunningTasks};
+        CallbackScope scope(this);
+        CpuScope cpu(*this);
+        task();
+    };
+    if (hasThreadPolicy) {
+        executor->SubmitLongRunning(std::move(accounted), PolicyThread::Named(threadPolicy, GetName()));
+    } else {
+        executor->SubmitLongRunning(std::move(accounted));
+    }
+}
+
+void Plugin::post(IExecutorService::Task task) {
+    Deliver(postTopic, &postHandler, EventPayload(std::make_shared<const IExecutorService::Task>(std::move(task))), DeliveryPolicy::Block);
+}
+
+const IPlugin* Plugin::Current() {
+    return currentPlugin;
+}
+
+Plugin::CallbackScope::CallbackScope(const IPlugin* plugin) : previous(currentPlugin) {
+    currentPlugin = plugin;
+}
+
+Plugin::CallbackScope::~CallbackScope() {
+    currentPlugin = previous;
+}
+
+void Plugin::heartbeat() {
+    lastHeartbeat.store(LatencyHistogram::Now(), std::memory_order_relaxed);
+}
+
 void Plugin::subscribe(const std::string& eventName, std::function<void(const std::string&)> callback) {
-    std::lock_guard<std::mutex> lock(eventMutex);
-    eventCallbacks[eventName] = callback;  // 🔥 Eltároljuk a callback függvényt
+    subscribe(eventService->RegisterTopic(eventName), std::move(callback));
+}
 
-    eventService->Subscribe(eventName, [this, eventName](const std::string& param) {
-        std::lock_guard<std::mutex> lock(eventMutex);
-        eventQueue.push({eventName, param});
-        eventCondition.notify_one();
+void Plugin::subscribe(IEventService::TopicId topic, std::function<void(const std::string&)> callback) {
+    subscribePayload(topic, [callback = std::move(callback)](const EventPayload& payload) {
+        if (const std::string* param = payload.Get<std::string>()) {
+            callback(*param);
+        }
     });
+}
+
+void Plugin::subscribePayload(IEventService::TopicId topic, IEventService::PayloadCallback callback) {
+    std::lock_guard<std::mutex> lock(eventMutex);
+    eventCallbacks.push_back(std::make_unique<IEventService::PayloadCallback>(std::move(callback)));
+    subscriptions.push_back(eventService->Subscribe(topic, this, eventCallbacks.back().get()));
 
-    (*logger) << "[Plugin] Subscribed to event: " << eventName << std::endl;
+    APX_LOG_DEBUG(logger, logCategory) << "[Plugin] Subscribed to event: " << eventService->GetTopicName(topic) << std::endl;
 }
 
-void Plugin::EventProcessingLoop() {
-    (*logger) << "[Plugin] Event processing thread started." << std::endl;
+MailboxDelivery Plugin::Deliver(IEventService::TopicId topic, const IEventService::PayloadCallback* handler, const EventPayload& payload,
+                                DeliveryPolicy policy) {
+    MailboxEntry entry{topic, handler, payload, LatencyHistogram::Now()};  // Shares the payload, no copy
 
-    while (running) {
-        std::unique_lock<std::mutex> lock(eventMutex);
-        eventCondition.wait(lock, [this] { return !running || !eventQueue.empty(); });
+    if (policy == DeliveryPolicy::Block) {
+        while (!mailbox.TryPush(std::move(entry))) {
+            if (!running) {
+                return MailboxDelivery::Queued;  // Being destroyed, nobody will make room
+            }
+            std::this_thread::yield();  // Mailbox is full, wait for the drain task
+        }
+    } else if (parkedCount.load(std::memory_order_acquire) == 0 && mailbox.TryPush(std::move(entry))) {
+        // Common case. A topic is delivered by one dispatcher at a time and only Deliver() parks its
+        // events, so with nothing parked at all none of this subscription can be waiting either.
+    } else {
+        std::lock_guard<std::mutex> lock(parkedMutex);
+        auto it = std::find_if(parked.begin(), parked.end(), [&](const MailboxEntry& other) {
+            return other.topic == topic && other.handler == handler;
+        });
+        if (it != parked.end()) {
+            // Replaces the parked one, which was never counted as handled: queued stays as it is
+            *it = std::move(entry);
+            if (policy == DeliveryPolicy::CoalesceLatest) {
+                mailboxCoalesced.fetch_add(1, std::memory_order_relaxed);
+                return MailboxDelivery::Coalesced;
+            }
+            mailboxDropped.fetch_add(1, std::memory_order_relaxed);
+            return MailboxDelivery::Dropped;
+        }
+        if (!mailbox.TryPush(std::move(entry))) {
+            if (policy == DeliveryPolicy::DropNewest || !running) {
+                mailboxDropped.fetch_add(1, std::memory_order_relaxed);
+                return MailboxDelivery::Dropped;
+            }
+            parked.push_back(std::move(entry));
+            parkedCount.store(parked.size(), std::memory_order_release);
+        }
+    }
 
-        while (!eventQueue.empty()) {
-            auto event = eventQueue.front();
-            eventQueue.pop();
-            lock.unlock();
+    if (queued.fetch_add(1, std::memory_order_acq_rel) == 0) {
+        if (dedicatedThread.load(std::memory_order_relaxed)) {
+            mailboxParker.Unpark();
+        } else {
+            executor->Submit([this] { DrainMailbox(); });
+        }
+    }
+    return MailboxDelivery::Queued;
+}
+
+void Plugin::MoveParked() {
+    // Parked events are counted in queued already, moving them adds nothing
+    std::lock_guard<std::mutex> lock(parkedMutex);
+    auto it = parked.begin();
+    while (it != parked.end() && mailbox.TryPush(std::move(*it))) {
+        ++it;
+    }
+    parked.erase(parked.begin(), it);
+    parkedCount.store(parked.size(), std::memory_order_release);
+}
 
-            (*logger) << "[Plugin] Processing event: " << event.first << " with data: " << event.second << std::endl;
+Plugin::MailboxStats Plugin::GetMailboxStats() const {
+    MailboxStats stats;
+    stats.depth = mailbox.Size();
+    stats.maxDepth = mailboxMaxDepth.load(std::memory_order_relaxed);
+    stats.dropped = mailboxDropped.load(std::memory_order_relaxed);
+    stats.coalesced = mailboxCoalesced.load(std::memory_order_relaxed);
+    stats.wait = mailboxWait.Snapshot();
+    stats.handler = handlerTime.Snapshot();
+    return stats;
+}
+
+PluginActivity Plugin::GetActivity() const {
+    PluginActivity activity;
+    {
+        std::lock_guard<std::mutex> lock(cpuMutex);
+        activity.cpuTime = cpuTime;
+        for (const LiveClock& live : cpuClocks) {
+            uint64_t now = PolicyThread::CpuTime(live.clock);
+            activity.cpuTime += now - std::min(now, live.start);
+        }
+    }
+    activity.handled = handledEvents.load(std::memory_order_relaxed);
+    activity.backlog = queued.load(std::memory_order_relaxed);
+    activity.busySince = handlerStart.load(std::memory_order_relaxed);
+    activity.lastHeartbeat = lastHeartbeat.load(std::memory_order_relaxed);
+    activity.handlerTime = handlerTime.Snapshot();
+    return activity;
+}
 
-            // 🔥 Meg kell hívni az eseményhez tartozó callback függvényt
-            auto it = eventCallbacks.find(event.first);
-            if (it != eventCallbacks.end()) {
-                (*logger) << "[Plugin] Calling event callback for: " << event.first << std::endl;
-                it->second(event.second);  // Meghívjuk a callback függvényt
-            } else {
-                (*logger) << "[Plugin] No callback found for event: " << event.first << std::endl;
+void Plugin::DrainMailbox() {
+    // More events arrived, or a counted one is still being pushed: continue in a new task, so other
+    // plugins get the worker in between. Nothing may touch this after the last decrement.
+    if (HandleBatch()) {
+        executor->Submit([this] { DrainMailbox(); });
+    }
+}
+
+void Plugin::MailboxLoop() {
+    while (mailboxThreadRunning.load(std::memory_order_acquire)) {
+        mailboxParker.Park([this] {
+            return queued.load(std::memory_order_acquire) != 0 || !mailboxThreadRunning.load(std::memory_order_acquire);
+        });
+        while (queued.load(std::memory_order_acquire) != 0) {
+            HandleBatch();
+        }
+    }
+}
+
+Plugin::CpuScope::CpuScope(Plugin& plugin) : plugin(plugin), start(PolicyThread::CpuTime()) {
+    live = PolicyThread::CurrentCpuClock(clock);
+    if (live) {
+        std::lock_guard<std::mutex> lock(plugin.cpuMutex);
+        plugin.cpuClocks.push_back({clock, start});
+    }
+}
+
+Plugin::CpuScope::~CpuScope() {
+    uint64_t used = PolicyThread::CpuTime() - start;
+    std::lock_guard<std::mutex> lock(plugin.cpuMutex);
+    plugin.cpuTime += used;
+    if (live) {
+        auto& clocks = plugin.cpuClocks;
+        auto it = std::find_if(clocks.rbegin(), clocks.rend(), [this](const LiveClock& c) { return c.clock == clock && c.start == start; });
+        clocks.erase(std::next(it).base());
+    }
+}
+
+bool Plugin::HandleBatch() {
+    size_t depth = mailbox.Size();
+    if (depth > mailboxMaxDepth.load(std::memory_order_relaxed)) {
+        mailboxMaxDepth.store(depth, std::memory_order_relaxed);
+    }
+
+    // Only events already counted, those are guaranteed to be pushed
+    size_t limit = std::min(queued.load(std::memory_order_acquire), kDrainBatch);
+    size_t taken = 0;
+    // The CpuScope ends before queued drops: nothing may touch this after the last decrement
+    {
+        CallbackScope scope(this);
+        CpuScope cpu(*this);  // Per batch, reading the clock is a system call on some kernels
+        MailboxEntry event;
+        while (taken < limit && mailbox.TryPop(event)) {
+            ++taken;
+            if (!running) {
+                event.payload = EventPayload();  // Destroy() is waiting, drop the rest
+                continue;
             }
 
-            lock.lock();
+            uint64_t popped = LatencyHistogram::Now();
+            mailboxWait.Record(popped - std::min(popped, event.enqueueTime));
+
+            const std::string& eventName = eventService->GetTopicName(event.topic);
+            const std::string* param = event.payload.Get<std::string>();
+            APX_LOG_TRACE(logger, logCategory) << "[Plugin] Processing event: " << eventName << " with data: " << (param ? *param : "<typed payload>") << std::endl;
+
+            // The handler was resolved when subscribing, no lookup needed
+            APX_LOG_TRACE(logger, logCategory) << "[Plugin] Calling event callback for: " << eventName << std::endl;
+            uint64_t start = LatencyHistogram::Now();
+            handlerStart.store(start, std::memory_order_relaxed);
+            try {
+                (*event.handler)(event.payload);
+            } catch (const std::exception& e) {
+                APX_LOG_ERROR(logger, logCategory) << "[Plugin] Event callback for " << eventName << " failed: " << e.what() << std::endl;
+            } catch (...) {
+                APX_LOG_ERROR(logger, logCategory) << "[Plugin] Event callback for " << eventName << " encountered an unknown error!" << std::endl;
+            }
+            handlerStart.store(0, std::memory_order_relaxed);
+            handlerTime.Record(LatencyHistogram::Now() - start);
+            handledEvents.fetch_add(1, std::memory_order_relaxed);
+            event.payload = EventPayload();  // Release our reference before the next event
         }
     }
 
-    (*logger) << "[Plugin] Event processing thread exiting." << std::endl;
+    // The batch made room; parked events go in behind what is already queued
+    if (parkedCount.load(std::memory_order_acquire) != 0) {
+        MoveParked();
+    }
+
+    return queued.fetch_sub(taken, std::memory_order_acq_rel) != taken;
 }
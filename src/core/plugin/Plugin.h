@@ -4,38 +4,186 @@
 #include "interfaces/IPlugin.h"
 #include "interfaces/IEventService.h"
 #include "interfaces/ILoggerService.h"
-#include <queue>
+#include "interfaces/IExecutorService.h"
+#include "concurrency/MpscQueue.h"
+#include "concurrency/Parker.h"
+#include "concurrency/PolicyThread.h"
+#include "metrics/LatencyHistogram.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
 #include <mutex>
-#include <condition_variable>
 #include <thread>
 
-class Plugin : public IPlugin {
+class Plugin : public IPlugin, public IEventMailbox {
 public:
-    Plugin(IEventService* eventService, ILoggerService* logger);
+    Plugin(IEventService* eventService, ILoggerService* logger, IExecutorService* executor);
     virtual ~Plugin();
 
     void Init() override;
     void Run() override;
+
+    // Unsubscribes, handles the events already queued, then waits for the submit() tasks in flight.
+    // From the plugin's own handler or task it cannot wait for itself: the rest of the mailbox is
+    // dropped, and the destructor does the waiting.
     void Destroy() override;
 
     std::string GetName() const override = 0;
     std::thread::id GetThreadId() const override = 0;
 
+    // Without a policy, events are handled on the shared executor. With one, the plugin gets a
+    // dispatcher thread of its own with that policy, e.g. pinned to a CPU with real-time priority.
+    void SetThreadPolicy(const ThreadPolicy& policy) override;
+
+    // Called by the EventService, queues the event and schedules a drain of the mailbox. A full mailbox
+    // only makes the caller wait for DeliveryPolicy::Block. DropNewest discards the event; DropOldest
+    // and CoalesceLatest park it per subscription, replacing the one parked before, until there is room.
+    MailboxDelivery Deliver(IEventService::TopicId topic, const IEventService::PayloadCallback* handler, const EventPayload& payload,
+                            DeliveryPolicy policy) override;
+
+    static constexpr size_t kMailboxCapacity = 1024;
+
+    // Events handled by one executor task before it yields the worker to other plugins
+    static constexpr size_t kDrainBatch = 64;
+
+    struct MailboxStats {
+        size_t depth = 0;
+        size_t maxDepth = 0;
+        uint64_t dropped = 0;    // By a full mailbox, see Deliver()
+        uint64_t coalesced = 0;
+        EventLatencyStats wait;     // Deliver() until an executor task picks the event up
+        EventLatencyStats handler;  // Event callbacks run by the executor
+    };
+
+    MailboxStats GetMailboxStats() const;
+
+    PluginActivity GetActivity() const override;
+
+    // The plugin whose handler, task, Run() or Update() runs on this thread; nullptr outside of one
+    static const IPlugin* Current();
+
+    // Marks plugin code running on this thread for Current() while it lives
+    class CallbackScope {
+    public:
+        explicit CallbackScope(const IPlugin* plugin);
+        ~CallbackScope();
+        CallbackScope(const CallbackScope&) = delete;
+        CallbackScope& operator=(const CallbackScope&) = delete;
+
+    private:
+        const IPlugin* previous;
+    };
+
 protected:
     void subscribe(const std::string& eventName, std::function<void(const std::string&)> callback);
+    void subscribe(IEventService::TopicId topic, std::function<void(const std::string&)> callback);
+    void subscribePayload(IEventService::TopicId topic, IEventService::PayloadCallback callback);
+
+    // Runs task on the executor; Destroy() waits for it to finish
+    void submit(IExecutorService::Task task);
+
+    // Runs a blocking task on a thread of its own, with the plugin's thread policy if it has one
+    void submitLongRunning(IExecutorService::Task task);
+
+    // Runs task through the mailbox, after the events queued so far and never alongside a handler;
+    // e.g. to finish what a submit() task started. Waits while the mailbox is full, so not for handlers.
+    void post(IExecutorService::Task task);
+
+    // Long-running loops call this every round; once they have, the watchdog flags the plugin as
+    // stalled when the calls stop coming
+    void heartbeat();
+
+    // Typed payloads, see IEventService::Subscribe<T>()
+    template<typename T>
+    void subscribe(IEventService::TopicId topic, std::function<void(const std::shared_ptr<const T>&)> callback) {
+        subscribePayload(topic, [callback = std::move(callback)](const EventPayload& payload) {
+            if (auto value = payload.As<T>()) {
+                callback(value);
+            }
+        });
+    }
 
     IEventService* eventService;
     ILoggerService* logger;
+    IExecutorService* executor;
+    LogCategory* logCategory;  // "Plugin" until Init() switches to the plugin's own name
     std::atomic<bool> running;
     
 private:
-    void EventProcessingLoop();
-    
-    std::queue<std::pair<std::string, std::string>> eventQueue;
-    std::unordered_map<std::string, std::function<void(const std::string&)>> eventCallbacks;
+    void DrainMailbox();
+    bool HandleBatch();  // Returns whether more events are counted
+    void MailboxLoop();
+    void MoveParked();
+
+    struct MailboxEntry {
+        IEventService::TopicId topic = 0;
+        const IEventService::PayloadCallback* handler = nullptr;
+        EventPayload payload;
+        uint64_t enqueueTime = 0;
+    };
+
+    // Filled by the EventService dispatchers, drained by one executor task at a time. queued counts
+    // the events pushed or parked and not yet handled; whoever raises it from zero schedules the drain task.
+    MpscQueue<MailboxEntry> mailbox{kMailboxCapacity};
+    std::atomic<size_t> queued{0};
+    std::atomic<size_t> activeTasks{0};  // submit() tasks not finished yet
+    std::atomic<size_t> mailboxMaxDepth{0};
+    LatencyHistogram mailboxWait;
+    LatencyHistogram handlerTime;
+
+    // Events that found the mailbox full, at most one per topic and handler. Once one is parked, later
+    // events of its subscription replace it, so they never overtake it. The drain moves them in.
+    std::mutex parkedMutex;
+    std::vector<MailboxEntry> parked;    // Guarded by parkedMutex
+    std::atomic<size_t> parkedCount{0};  // parked.size(), read without the lock
+    std::atomic<uint64_t> mailboxDropped{0};
+    std::atomic<uint64_t> mailboxCoalesced{0};
+
+    // Charges the CPU time the calling thread uses while it exists to the plugin. GetActivity()
+    // reads the thread's clock meanwhile, so a long handler shows up before it returns.
+    class CpuScope {
+    public:
+        explicit CpuScope(Plugin& plugin);
+        ~CpuScope();
+
+    private:
+        Plugin& plugin;
+        clockid_t clock{};
+        uint64_t start;
+        bool live;
+    };
+
+    struct LiveClock {
+        clockid_t clock;
+        uint64_t start;
+    };
+
+    // Watchdog accounting, see GetActivity()
+    mutable std::mutex cpuMutex;
+    uint64_t cpuTime = 0;              // Of finished CpuScopes, guarded by cpuMutex
+    std::vector<LiveClock> cpuClocks;  // Of the running ones, guarded by cpuMutex
+    std::atomic<uint64_t> handledEvents{0};
+    std::atomic<uint64_t> handlerStart{0};   // 0 while no handler runs
+    std::atomic<uint64_t> lastHeartbeat{0};
+    std::atomic<size_t> longRunningTasks{0};  // The destructor waits for them, they account to this
+
+    // Dedicated dispatcher, only with a thread policy
+    ThreadPolicy threadPolicy;
+    bool hasThreadPolicy = false;
+    std::atomic<bool> dedicatedThread{false};
+    std::atomic<bool> mailboxThreadRunning{false};
+    Parker mailboxParker;
+    PolicyThread mailboxThread;
+
+    // post() delivers to itself under this topic
+    IEventService::TopicId postTopic;
+    IEventService::PayloadCallback postHandler;
+
+    // Handlers are heap allocated so the pointers handed to the EventService stay stable
+    std::vector<std::unique_ptr<IEventService::PayloadCallback>> eventCallbacks;
+    std::vector<IEventService::SubscriptionId> subscriptions;
     std::mutex eventMutex;
-    std::condition_variable eventCondition;
-    std::thread eventListenerThread;
 };
 
 #endif // PLUGIN_H
@@ -0,0 +1,259 @@
+#include "PluginHost.h"
+#include "PluginLoader.h"
+#include "ipc/SharedMemory.h"
+#include "interfaces/PluginApi.h"
+#include <cstdlib>
+#include <sstream>
+#include <type_traits>
+#include <unistd.h>
+
+static_assert(std::is_trivially_copyable<PluginActivity>::value, "PluginActivity is sent as raw bytes");
+
+namespace {
+std::string JoinWords(const std::vector<std::string>& words) {
+    std::string line;
+    for (const auto& word : words) {
+        line += (line.empty() ? "" : " ") + word;
+    }
+    return line;
+}
+
+std::vector<std::string> SplitWords(const std::string& line) {
+    std::vector<std::string> words;
+    std::istringstream stream(line);
+    std::string word;
+    while (stream >> word) {
+        words.push_back(word);
+    }
+    return words;
+}
+}
+
+PluginHost::PluginHost(IEventService* eventService, ILoggerService* logger, IExecutorService* executor)
+    : eventService(eventService), logger(logger), executor(executor), logCategory(&logger->Category("PluginHost")) {}
+
+PluginHost::~PluginHost() {
+    {
+        std::lock_guard<std::mutex> lock(controlMutex);
+        controlRunning = false;
+    }
+    controlCondition.notify_all();
+    controlThread.Join();
+    for (auto subscription : forwarders) {
+        eventService->Unsubscribe(subscription);
+    }
+    if (bridge) {
+        bridge->Close();
+    }
+}
+
+std::string PluginHost::Describe(const IPlugin& plugin) {
+    // One field per line; names never contain line breaks
+    return plugin.GetName() + "\n" + JoinWords(plugin.GetDependencies()) + "\n" + JoinWords(plugin.GetProvides()) + "\n" +
+           JoinWords(plugin.GetRequires()) + "\n" + (plugin.WantsUpdate() ? "1" : "0");
+}
+
+PluginHost::Description PluginHost::ParseDescription(const std::string& text) {
+    std::istringstream stream(text);
+    std::string line;
+    Description description;
+    std::getline(stream, description.name);
+    std::getline(stream, line);
+    description.dependencies = SplitWords(line);
+    std::getline(stream, line);
+    description.provides = SplitWords(line);
+    std::getline(stream, line);
+    description.required = SplitWords(line);
+    std::getline(stream, line);
+    description.wantsUpdate = line == "1";
+    return description;
+}
+
+int PluginHost::Run(const std::string& libraryPath, int fd) {
+    SharedMemory memory;
+    std::string error;
+    if (!memory.Attach(fd, error)) {
+        APX_LOG_ERROR(logger, logCategory) << "[PluginHost] Cannot map the parent's shared memory: " << error << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (memory.Size() < EventBridge::RegionSize()) {
+        APX_LOG_ERROR(logger, logCategory) << "[PluginHost] Shared memory of " << memory.Size() << " bytes is too small" << std::endl;
+        return EXIT_FAILURE;
+    }
+    SharedRing in = EventBridge::ToChild(memory.Data(), false);
+    SharedRing out = EventBridge::ToParent(memory.Data(), false);
+    bridge = std::make_shared<EventBridge>(eventService, logger, logCategory, out, false);
+
+    void* handle = nullptr;
+    ApertusPluginServices services{APERTUS_PLUGIN_API_VERSION, eventService, logger, executor};
+    plugin = PluginLoader::Load(libraryPath, services, error, handle);
+    if (!plugin) {
+        APX_LOG_ERROR(logger, logCategory) << "[PluginHost] Cannot load plugin " << libraryPath << ": " << error << std::endl;
+        Reply(EventBridge::Error, error);
+        out.Close();
+        return EXIT_FAILURE;
+    }
+    // The library stays mapped until the process exits, like in the parent
+
+    mailbox = dynamic_cast<IEventMailbox*>(plugin.get());
+    frameTopic = eventService->RegisterTopic("frame/update");
+    IPlugin* updated = plugin.get();
+    updateHandler = [updated](const EventPayload& payload) {
+        if (const auto* deltaTime = payload.Get<std::chrono::nanoseconds>()) {
+            updated->Update(*deltaTime);
+        }
+    };
+    logCategory = &logger->Category(plugin->GetName());
+
+    {
+        std::lock_guard<std::mutex> lock(controlMutex);
+        controlRunning = true;
+    }
+    controlThread = PolicyThread(PolicyThread::Named(ThreadPolicy(), "apx-host"), [this] { ControlLoop(); });
+    for (const auto& pattern : PluginLoader::ReadManifest(libraryPath).publishPatterns) {
+        auto forward = bridge;
+        forwarders.push_back(eventService->SubscribePattern(pattern, [forward](IEventService::TopicId topic, const EventPayload& payload) {
+            forward->Publish(topic, payload);
+        }));
+    }
+    Reply(EventBridge::Hello, Describe(*plugin));
+    APX_LOG_INFO(logger, logCategory) << "[PluginHost] Hosting plugin " << plugin->GetName() << " in process " << ::getpid() << std::endl;
+
+    pid_t parent = ::getppid();
+    auto nextHeartbeat = std::chrono::steady_clock::now();
+    for (;;) {
+        in.WaitReadable(kHeartbeatInterval);
+        SharedRing::Message message;
+        while (in.TryRead(message)) {
+            if (!bridge->Handle(message)) {
+                Dispatch(message);
+            }
+            in.Release();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(controlMutex);
+            if (destroyed) {
+                break;
+            }
+        }
+        if (in.Closed() || ::getppid() != parent) {
+            APX_LOG_WARNING(logger, logCategory) << "[PluginHost] Parent went away, stopping" << std::endl;
+            break;
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (now >= nextHeartbeat) {
+            SendHeartbeat();
+            nextHeartbeat = now + kHeartbeatInterval;
+        }
+    }
+
+    // Wakes the parent's reader at once instead of at its next poll
+    bridge->Close();
+    out.Close();
+    return EXIT_SUCCESS;
+}
+
+void PluginHost::Dispatch(const SharedRing::Message& message) {
+    if (message.type == EventBridge::Update && mailbox != nullptr) {
+        // Through the mailbox, so Update() never overlaps the plugin's handlers
+        std::chrono::nanoseconds deltaTime(static_cast<int64_t>(message.value));
+        mailbox->Deliver(frameTopic, &updateHandler, EventPayload(std::make_shared<const std::chrono::nanoseconds>(deltaTime)),
+                         DeliveryPolicy::Block);
+        return;
+    }
+    switch (message.type) {
+        case EventBridge::Init:
+        case EventBridge::Run:
+        case EventBridge::Destroy:
+        case EventBridge::State:
+        case EventBridge::Update: {
+            std::lock_guard<std::mutex> lock(controlMutex);
+            commands.push_back({message.type, message.value, std::string(message.data, message.size)});
+            break;
+        }
+        default:
+            APX_LOG_WARNING(logger, logCategory) << "[PluginHost] Unexpected message type " << message.type << std::endl;
+            return;
+    }
+    controlCondition.notify_one();
+}
+
+void PluginHost::ControlLoop() {
+    std::unique_lock<std::mutex> lock(controlMutex);
+    for (;;) {
+        controlCondition.wait(lock, [this] { return !controlRunning || !commands.empty(); });
+        if (commands.empty()) {
+            return;
+        }
+        Command command = std::move(commands.front());
+        commands.pop_front();
+        lock.unlock();
+        Execute(command);
+        lock.lock();
+    }
+}
+
+void PluginHost::Execute(const Command& command) {
+    // Same rules as in-process plugins: what a call throws is reported, never propagated
+    std::string error;
+    std::string state;
+    try {
+        switch (command.type) {
+            case EventBridge::Init:
+                plugin->Init();
+                break;
+            case EventBridge::Run:
+                plugin->Run();
+                break;
+            case EventBridge::Destroy:
+                plugin->Destroy();
+                state = plugin->SerializeState();
+                break;
+            case EventBridge::State:
+                plugin->RestoreState(command.data);
+                break;
+            case EventBridge::Update:
+                plugin->Update(std::chrono::nanoseconds(static_cast<int64_t>(command.value)));
+                return;
+        }
+    } catch (const std::exception& e) {
+        error = e.what();
+    } catch (...) {
+        error = "unknown error";
+    }
+    if (command.type == EventBridge::Update) {
+        if (!error.empty()) {
+            APX_LOG_ERROR(logger, logCategory) << "[PluginHost] Plugin call failed: " << error << std::endl;
+        }
+        return;
+    }
+    if (!state.empty()) {
+        Reply(EventBridge::State, state);
+    }
+    if (command.type == EventBridge::Destroy) {
+        // The parent closes the rings once it has the answer; that must not look like it went away
+        std::lock_guard<std::mutex> lock(controlMutex);
+        destroyed = true;
+    }
+    Reply(EventBridge::Done, error);
+}
+
+void PluginHost::SendHeartbeat() {
+    PluginActivity activity = plugin->GetActivity();
+    SharedRing::Message message;
+    message.type = EventBridge::Heartbeat;
+    message.data = reinterpret_cast<const char*>(&activity);
+    message.size = sizeof(activity);
+    bridge->Send(message, std::chrono::milliseconds(0));  // The next one follows soon if the ring is full
+}
+
+void PluginHost::Reply(uint16_t type, const std::string& data) {
+    SharedRing::Message message;
+    message.type = type;
+    message.data = data.data();
+    message.size = data.size();
+    if (!bridge->Send(message)) {
+        APX_LOG_ERROR(logger, logCategory) << "[PluginHost] Cannot answer the parent, message of " << data.size() << " bytes not sent" << std::endl;
+    }
+}
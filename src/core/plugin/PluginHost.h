@@ -0,0 +1,85 @@
+#ifndef PLUGINHOST_H
+#define PLUGINHOST_H
+
+#include "interfaces/IPlugin.h"
+#include "interfaces/IEventService.h"
+#include "interfaces/ILoggerService.h"
+#include "interfaces/IExecutorService.h"
+#include "concurrency/PolicyThread.h"
+#include "ipc/EventBridge.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @class PluginHost
+ * @brief Runs one isolated plugin in a process of its own, the child side of a RemotePlugin.
+ * @details The host loads the library with its own services, reports the plugin in a Hello
+ * message and then serves the parent: events go both ways through an EventBridge, Init(), Run(),
+ * RestoreState() and Destroy() run on a control thread and are answered with Done, and a Heartbeat with the
+ * plugin's activity goes out every kHeartbeatInterval. The host ends after Destroy(), or when the
+ * parent goes away.
+ */
+class PluginHost {
+public:
+    PluginHost(IEventService* eventService, ILoggerService* logger, IExecutorService* executor);
+    ~PluginHost();
+
+    /**
+     * @brief Serves the plugin of libraryPath over the shared memory behind fd until it is destroyed.
+     * @return Exit code for the process.
+     */
+    int Run(const std::string& libraryPath, int fd);
+
+    // What the Hello message carries
+    struct Description {
+        std::string name;
+        std::vector<std::string> dependencies;
+        std::vector<std::string> provides;
+        std::vector<std::string> required;
+        bool wantsUpdate = false;
+    };
+
+    static std::string Describe(const IPlugin& plugin);
+    static Description ParseDescription(const std::string& text);
+
+    static constexpr std::chrono::milliseconds kHeartbeatInterval{100};
+
+private:
+    struct Command {
+        uint16_t type = 0;
+        uint64_t value = 0;
+        std::string data;
+    };
+
+    void Dispatch(const SharedRing::Message& message);  // Control messages from the parent
+    void ControlLoop();
+    void Execute(const Command& command);
+    void SendHeartbeat();
+    void Reply(uint16_t type, const std::string& data);
+
+    IEventService* eventService;
+    ILoggerService* logger;
+    IExecutorService* executor;
+    LogCategory* logCategory;
+
+    std::shared_ptr<IPlugin> plugin;
+    IEventMailbox* mailbox = nullptr;  // The plugin, if it has one; Update() goes through it
+    IEventService::TopicId frameTopic = 0;
+    IEventService::PayloadCallback updateHandler;
+    std::shared_ptr<EventBridge> bridge;
+    std::vector<IEventService::SubscriptionId> forwarders;
+
+    std::mutex controlMutex;
+    std::condition_variable controlCondition;
+    std::deque<Command> commands;  // Guarded by controlMutex
+    bool controlRunning = false;   // Guarded by controlMutex
+    bool destroyed = false;        // Guarded by controlMutex, set once Destroy() is answered
+    PolicyThread controlThread;
+};
+
+#endif // PLUGINHOST_H
@@ -0,0 +1,143 @@
+#include "PluginLoader.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <dlfcn.h>
+#include <unistd.h>
+
+#if defined(__APPLE__)
+const std::string PluginLoader::kLibrarySuffix = ".dylib";
+#else
+const std::string PluginLoader::kLibrarySuffix = ".so";
+#endif
+const std::string PluginLoader::kManifestSuffix = ".plugin";
+
+PluginManifest PluginLoader::ReadManifest(const std::string& libraryPath) {
+    std::string path = libraryPath;
+    if (path.size() > kLibrarySuffix.size() && path.compare(path.size() - kLibrarySuffix.size(), kLibrarySuffix.size(), kLibrarySuffix) == 0) {
+        path.resize(path.size() - kLibrarySuffix.size());
+    }
+    path += kManifestSuffix;
+
+    PluginManifest manifest;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t separator = line.find('=');
+        if (separator == std::string::npos) {
+            continue;
+        }
+        std::string key = line.substr(0, separator);
+        std::istringstream list(line.substr(separator + 1));
+        std::vector<std::string>* values = nullptr;
+        if (key == "activate") {
+            values = &manifest.activationTopics;
+        } else if (key == "subscribe") {
+            values = &manifest.subscribeTopics;
+        } else if (key == "publish") {
+            values = &manifest.publishPatterns;
+        } else if (key == "process") {
+            std::string mode;
+            list >> mode;
+            manifest.isolated = mode == "isolated";
+            continue;
+        } else {
+            continue;
+        }
+        std::string value;
+        while (list >> value) {
+            values->push_back(value);
+        }
+    }
+    if (manifest.publishPatterns.empty()) {
+        manifest.publishPatterns.push_back("#");
+    }
+    return manifest;
+}
+
+std::shared_ptr<IPlugin> PluginLoader::Load(const std::string& path, const ApertusPluginServices& services,
+                                            std::string& errorMessage, void*& handle, bool privateCopy) {
+    handle = nullptr;
+    std::string loadPath = path;
+    if (privateCopy) {
+        // dlopen() hands out the mapping it already has for a path, even when the file was replaced;
+        // a copy under a new name is mapped anew. Unlinking it right away leaves nothing behind.
+        loadPath = CopyLibrary(path, errorMessage);
+        if (loadPath.empty()) {
+            return nullptr;
+        }
+    }
+    void* library = ::dlopen(loadPath.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (privateCopy) {
+        ::unlink(loadPath.c_str());
+    }
+    if (library == nullptr) {
+        const char* error = ::dlerror();
+        errorMessage = error != nullptr ? error : "dlopen() failed";
+        return nullptr;
+    }
+    auto entry = reinterpret_cast<ApertusPluginEntryFunction>(::dlsym(library, APERTUS_PLUGIN_ENTRY_NAME));
+    if (entry == nullptr) {
+        errorMessage = "no " APERTUS_PLUGIN_ENTRY_NAME " entry point";
+        ::dlclose(library);
+        return nullptr;
+    }
+    const ApertusPluginInfo* info = entry();
+    if (info == nullptr || info->apiVersion != APERTUS_PLUGIN_API_VERSION) {
+        errorMessage = "built for plugin API version " + std::to_string(info != nullptr ? info->apiVersion : 0) +
+                       ", expected " + std::to_string(APERTUS_PLUGIN_API_VERSION);
+        ::dlclose(library);
+        return nullptr;
+    }
+    handle = library;
+
+    IPlugin* plugin = nullptr;
+    try {
+        plugin = info->create(&services);
+    } catch (const std::exception& e) {
+        errorMessage = std::string("create() failed: ") + e.what();
+        return nullptr;
+    }
+    if (plugin == nullptr) {
+        errorMessage = "create() returned no plugin";
+        return nullptr;
+    }
+    return std::shared_ptr<IPlugin>(plugin, info->destroy);  // Freed by the module that allocated it
+}
+
+std::string PluginLoader::CopyLibrary(const std::string& path, std::string& errorMessage) {
+    const char* tmpDir = std::getenv("TMPDIR");
+    std::string pattern = std::string(tmpDir != nullptr && *tmpDir != '\0' ? tmpDir : "/tmp") + "/apertus-plugin-XXXXXX" + kLibrarySuffix;
+    std::vector<char> copyPath(pattern.begin(), pattern.end());
+    copyPath.push_back('\0');
+    int fd = ::mkstemps(copyPath.data(), static_cast<int>(kLibrarySuffix.size()));
+    if (fd < 0) {
+        errorMessage = std::string("cannot create a copy: ") + std::strerror(errno);
+        return std::string();
+    }
+
+    std::ifstream source(path, std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(source)), std::istreambuf_iterator<char>());
+    bool copied = source.good() || source.eof();
+    if (!copied) {
+        errorMessage = "cannot read " + path;
+    }
+    for (size_t written = 0; copied && written < data.size();) {
+        ssize_t result = ::write(fd, data.data() + written, data.size() - written);
+        if (result < 0 && errno != EINTR) {
+            errorMessage = std::string("cannot write a copy: ") + std::strerror(errno);
+            copied = false;
+        } else if (result > 0) {
+            written += static_cast<size_t>(result);
+        }
+    }
+    ::close(fd);
+    if (!copied) {
+        ::unlink(copyPath.data());
+        return std::string();
+    }
+    return copyPath.data();
+}
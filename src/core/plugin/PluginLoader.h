@@ -0,0 +1,49 @@
+#ifndef PLUGINLOADER_H
+#define PLUGINLOADER_H
+
+#include "interfaces/IPlugin.h"
+#include "interfaces/PluginApi.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @struct PluginManifest
+ * @brief The .plugin file next to a plugin library, see PluginApi.h.
+ */
+struct PluginManifest {
+    std::vector<std::string> activationTopics;  // activate=, empty to load right away
+    bool isolated = false;                      // process=isolated, hosted in a child process
+    std::vector<std::string> subscribeTopics;   // subscribe=, events sent into an isolated plugin
+    std::vector<std::string> publishPatterns;   // publish=, events an isolated plugin sends out; "#" if none
+};
+
+/**
+ * @class PluginLoader
+ * @brief Opens plugin libraries; shared by the PluginService and the process hosting isolated plugins.
+ */
+class PluginLoader {
+public:
+    static const std::string kLibrarySuffix;
+    static const std::string kManifestSuffix;
+
+    /**
+     * @brief Reads the manifest of the library at libraryPath; a missing file is an empty manifest.
+     */
+    static PluginManifest ReadManifest(const std::string& libraryPath);
+
+    /**
+     * @brief Opens a library, checks its API version and creates its plugin.
+     * @param handle Set once the library is mapped, also if create() fails afterwards: the library
+     * may have registered static state by then, the caller must keep it loaded.
+     * @param privateCopy Loads the file as it is on disk now, even if an older version is mapped already.
+     * @return nullptr with errorMessage set on failure.
+     */
+    static std::shared_ptr<IPlugin> Load(const std::string& path, const ApertusPluginServices& services,
+                                         std::string& errorMessage, void*& handle, bool privateCopy = false);
+
+private:
+    static std::string CopyLibrary(const std::string& path, std::string& errorMessage);
+};
+
+#endif // PLUGINLOADER_H
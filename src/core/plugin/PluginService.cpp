@@ -1,97 +1,1245 @@
 #include "PluginService.h"
+#include "Plugin.h"
+#include "PluginLoader.h"
+#include "RemotePlugin.h"
+#include "interfaces/PluginApi.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <future>
 #include <iostream>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+#include <dirent.h>
 
-PluginService::PluginService(IEventService* eventService, ILoggerService* logger)
-    : eventService(eventService), logger(logger) {}
+namespace {
+// Update() calls of one wave still running; the frame thread waits until it reaches zero
+struct FrameWave {
+    std::mutex mutex;
+    std::condition_variable done;
+    size_t remaining;
+
+    explicit FrameWave(size_t count) : remaining(count) {}
+
+    void Finish() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--remaining == 0) {
+            done.notify_one();
+        }
+    }
+
+    void Wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return remaining == 0; });
+    }
+};
+
+// Payload of a frame. Its plugin's part of the wave is done when the last reference goes, so a tick
+// dropped by a plugin being destroyed cannot stall the clock.
+struct FrameTick {
+    std::chrono::nanoseconds deltaTime;
+    std::shared_ptr<FrameWave> wave;
+
+    FrameTick(std::chrono::nanoseconds deltaTime, std::shared_ptr<FrameWave> wave) : deltaTime(deltaTime), wave(std::move(wave)) {}
+    ~FrameTick() { wave->Finish(); }
+};
+
+double ToMs(uint64_t nanoseconds) {
+    return nanoseconds / 1000 / 1000.0;
+}
+
+uint64_t Since(uint64_t now, uint64_t time) {
+    return time == 0 ? 0 : now - std::min(now, time);
+}
+
+const char* ToString(PluginHealthState state) {
+    switch (state) {
+        case PluginHealthState::Healthy: return "healthy";
+        case PluginHealthState::Overloaded: return "overloaded";
+        case PluginHealthState::Stalled: return "stalled";
+        case PluginHealthState::Abandoned: return "abandoned";
+    }
+    return "unknown";
+}
+}
+
+PluginService::PluginService(IEventService* eventService, ILoggerService* logger, IExecutorService* executor, IConfigService* config)
+    : eventService(eventService), logger(logger), executor(executor), config(config), logCategory(&logger->Category("PluginService")),
+      frameTopic(eventService->RegisterTopic("frame/update")),
+      framePolicy(config->GetThreadPolicy("frame")),
+      frameRate(static_cast<double>(config->GetInt("frame.rate", 60))),
+      healthTopic(eventService->RegisterTopic("plugin/health")),
+      watchdogPolicy(config->GetThreadPolicy("watchdog")),
+      watchdogInterval(std::max<int64_t>(0, config->GetInt("watchdog.interval_ms", 250))),
+      stopTimeout(std::max<int64_t>(0, config->GetInt("watchdog.stop_timeout_ms", 5000))) {}
 
 void PluginService::RegisterPlugin(std::shared_ptr<IPlugin> plugin) {
     std::lock_guard<std::mutex> lock(initMutex);
     plugins.push_back(plugin);
     totalPlugins++;
-    (*logger) << "[PluginService] Plugin registered: " << plugin->GetName() << std::endl;
+    APX_LOG_DEBUG(logger, logCategory) << "[PluginService] Plugin registered: " << plugin->GetName() << std::endl;
 }
 
-void PluginService::InitPlugins() {
-    (*logger) << "[PluginService] Initializing plugins..." << std::endl;
+size_t PluginService::LoadPlugins(const std::string& directory) {
+    DIR* dir = ::opendir(directory.c_str());
+    if (dir == nullptr) {
+        APX_LOG_WARNING(logger, logCategory) << "[PluginService] Cannot open plugin directory " << directory << ": " << std::strerror(errno) << std::endl;
+        return 0;
+    }
+    std::vector<std::string> paths;
+    while (dirent* entry = ::readdir(dir)) {
+        std::string name = entry->d_name;
+        const std::string& suffix = PluginLoader::kLibrarySuffix;
+        if (name.size() > suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0) {
+            paths.push_back(directory + "/" + name);
+        }
+    }
+    ::closedir(dir);
+    std::sort(paths.begin(), paths.end());
 
-    for (auto& plugin : plugins) {
-        pluginThreads.emplace_back([this, plugin] {
-            try {
-                (*logger) << "[PluginService] Initializing plugin: " << plugin->GetName() << std::endl;
-                plugin->Init();
+    size_t found = 0;
+    for (const auto& path : paths) {
+        auto library = std::make_unique<PluginLibrary>();
+        library->path = path;
+        library->manifest = PluginLoader::ReadManifest(path);
 
-                {
-                    std::lock_guard<std::mutex> lock(initMutex);
-                    initializedPlugins++;
-                }
-                initCondition.notify_one();
+        if (library->manifest.activationTopics.empty()) {
+            std::string error;
+            auto plugin = OpenLibrary(path, library->manifest, error);
+            if (!plugin) {
+                APX_LOG_ERROR(logger, logCategory) << "[PluginService] Cannot load plugin " << path << ": " << error << std::endl;
+                continue;
+            }
+            library->pluginName = plugin->GetName();
+            RegisterPlugin(plugin);
+        } else {
+            // Nothing is mapped until one of the topics fires
+            PluginLibrary* deferred = library.get();
+            for (const auto& topic : library->manifest.activationTopics) {
+                library->activators.push_back(eventService->RegisterTopic(topic));
+                eventService->SetTopicActivator(library->activators.back(), [this, deferred](std::function<void()> done) {
+                    // Loaded off the publishing thread; done queues the events held meanwhile, loaded or not
+                    executor->Submit([this, deferred, done] {
+                        try {
+                            ActivateLibrary(*deferred);
+                        } catch (...) {
+                            done();
+                            throw;
+                        }
+                        done();
+                    });
+                });
+            }
+            APX_LOG_INFO(logger, logCategory) << "[PluginService] Plugin " << path << " is loaded on first "
+                                              << library->manifest.activationTopics.front() << " event" << std::endl;
+        }
+        ++found;
+        std::lock_guard<std::mutex> lock(libraryMutex);
+        libraries.push_back(std::move(library));
+    }
+    return found;
+}
 
-                (*logger) << "[PluginService] Starting event listener for: " << plugin->GetName() << std::endl;
-                StartPluginEventListener(plugin);
+void PluginService::InitPlugins() {
+    APX_LOG_INFO(logger, logCategory) << "[PluginService] Initializing plugins..." << std::endl;
 
-            } catch (const std::exception& e) {
-                (*logger) << "[PluginService] Plugin Init() failed: " << e.what() << std::endl;
-            } catch (...) {
-                (*logger) << "[PluginService] Plugin Init() encountered an unknown error!" << std::endl;
+    size_t schedulable;
+    std::vector<size_t> roots;
+    {
+        std::lock_guard<std::mutex> lock(initMutex);
+        initStart = std::chrono::steady_clock::now();
+        schedulable = BuildGraph();
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            if (nodes[i].reachable && nodes[i].remaining == 0 && !nodes[i].activated) {
+                roots.push_back(i);
             }
-        });
+        }
+    }
+
+    // From here on a hanging Init() is noticed
+    StartWatchdog();
+
+    // Plugins without dependencies start right away and in parallel; FinishInit() starts the rest
+    for (size_t index : roots) {
+        executor->Submit([this, index] { StartInit(index); });
     }
 
     // Wait until all plugins are initialized
-    std::unique_lock<std::mutex> lock(initMutex);
-    initCondition.wait(lock, [this] { return initializedPlugins.load() == totalPlugins.load(); });
+    {
+        std::unique_lock<std::mutex> lock(initMutex);
+        initCondition.wait(lock, [this, schedulable] { return static_cast<size_t>(initializedPlugins.load()) == schedulable; });
+    }
+    LogStartupReport(std::chrono::steady_clock::now() - initStart);
 
-    (*logger) << "[PluginService] All plugins initialized, starting Run()..." << std::endl;
+    APX_LOG_INFO(logger, logCategory) << "[PluginService] All plugins initialized, starting Run()..." << std::endl;
 
-    // Start each plugin on a separate thread
-    for (auto& plugin : plugins) {
-        pluginThreads.emplace_back([plugin, this] {
-            try {
-                (*logger) << "[PluginService] Running plugin: " << plugin->GetName() << std::endl;
-                plugin->Run();
-            } catch (const std::exception& e) {
-                (*logger) << "[PluginService] Plugin Run() failed: " << e.what() << std::endl;
-            } catch (...) {
-                (*logger) << "[PluginService] Plugin Run() encountered an unknown error!" << std::endl;
+    // Run() is an ordinary task as well; plugins that need a loop of their own use SubmitLongRunning()
+    std::vector<size_t> initialized;
+    {
+        std::lock_guard<std::mutex> lock(initMutex);
+        for (size_t index : initOrder) {
+            if (!nodes[index].activated) {
+                initialized.push_back(index);  // Activated plugins run already
             }
-        });
+        }
+    }
+    for (size_t index : initialized) {
+        RunPlugin(index);
+    }
+    StartFrameClock();
+}
+
+size_t PluginService::BuildGraph() {
+    // Plugins activated before InitPlugins() keep their node and their place in initOrder, they are not initialized twice
+    std::vector<PluginNode> previous = std::move(nodes);
+    nodes.assign(plugins.size(), PluginNode());
+    for (size_t i = 0; i < previous.size() && i < nodes.size(); ++i) {
+        if (previous[i].activated) {
+            nodes[i] = std::move(previous[i]);
+        }
+    }
+    initOrder.erase(std::remove_if(initOrder.begin(), initOrder.end(), [this](size_t index) { return !nodes[index].activated; }),
+                    initOrder.end());
+    initializedPlugins = 0;
+
+    std::unordered_map<std::string, size_t> byName;
+    std::unordered_map<std::string, std::vector<size_t>> providers;
+    for (size_t i = 0; i < plugins.size(); ++i) {
+        if (!nodes[i].activated) {
+            nodes[i].timing.name = plugins[i]->GetName();
+        }
+        if (PluginLibrary* library = FindLibrary(nodes[i].timing.name)) {
+            nodes[i].timing.library = library->path;
+        }
+        if (!byName.emplace(nodes[i].timing.name, i).second) {
+            APX_LOG_WARNING(logger, logCategory) << "[PluginService] Duplicate plugin name: " << nodes[i].timing.name << std::endl;
+        }
+        for (const auto& capability : plugins[i]->GetProvides()) {
+            providers[capability].push_back(i);
+        }
+    }
+
+    // An activated plugin is no edge: its Init() is over, or never counts for the graph
+    auto depend = [this](PluginNode& node, size_t dependency) {
+        if (!nodes[dependency].activated) {
+            node.dependencies.push_back(dependency);
+        } else if (!nodes[dependency].timing.initialized) {
+            node.timing.error = "dependency " + nodes[dependency].timing.name + " not initialized";
+        }
+    };
+    for (size_t i = 0; i < plugins.size(); ++i) {
+        PluginNode& node = nodes[i];
+        if (node.activated) {
+            continue;
+        }
+        for (const auto& dependency : plugins[i]->GetDependencies()) {
+            auto it = byName.find(dependency);
+            if (it == byName.end()) {
+                node.timing.error = "missing dependency " + dependency;
+            } else if (it->second != i) {
+                depend(node, it->second);
+            }
+        }
+        for (const auto& capability : plugins[i]->GetRequires()) {
+            auto it = providers.find(capability);
+            if (it == providers.end()) {
+                node.timing.error = "no plugin provides " + capability;
+                continue;
+            }
+            for (size_t provider : it->second) {
+                if (provider != i) {
+                    depend(node, provider);
+                }
+            }
+        }
+        std::sort(node.dependencies.begin(), node.dependencies.end());
+        node.dependencies.erase(std::unique(node.dependencies.begin(), node.dependencies.end()), node.dependencies.end());
+        for (size_t dependency : node.dependencies) {
+            nodes[dependency].dependents.push_back(i);
+        }
     }
+
+    // Kahn's algorithm: assigns the waves and finds the plugins a cycle keeps from ever starting
+    std::vector<size_t> ready;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        nodes[i].remaining = nodes[i].dependencies.size();
+        if (nodes[i].remaining == 0 && !nodes[i].activated) {
+            ready.push_back(i);
+        }
+    }
+    size_t reachable = 0;
+    while (!ready.empty()) {
+        size_t index = ready.back();
+        ready.pop_back();
+        nodes[index].reachable = true;
+        ++reachable;
+        for (size_t dependent : nodes[index].dependents) {
+            nodes[dependent].timing.wave = std::max(nodes[dependent].timing.wave, nodes[index].timing.wave + 1);
+            if (--nodes[dependent].remaining == 0) {
+                ready.push_back(dependent);
+            }
+        }
+    }
+
+    for (auto& node : nodes) {
+        node.remaining = node.dependencies.size();
+        if (!node.reachable) {
+            node.timing.error = "dependency cycle";
+            APX_LOG_ERROR(logger, logCategory) << "[PluginService] Skipping plugin " << node.timing.name << ": " << node.timing.error << std::endl;
+        }
+    }
+    return reachable;
 }
 
-void PluginService::StartPluginEventListener(std::shared_ptr<IPlugin> plugin) {
-    eventThreads.emplace_back([plugin, this] {
-        while (!shutdownCalled) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(50)); // Polling for events
+void PluginService::StartInit(size_t index) {
+    std::shared_ptr<IPlugin> plugin;
+    std::string error;
+    {
+        std::lock_guard<std::mutex> lock(initMutex);
+        plugin = plugins[index];
+        error = nodes[index].timing.error;  // Final, every dependency has finished
+        nodes[index].busySince = LatencyHistogram::Now();
+        nodes[index].busyWith = "Init()";
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    bool attempted = error.empty();
+    bool initialized = attempted && InitPlugin(*plugin, error);
+    if (!attempted) {
+        APX_LOG_ERROR(logger, logCategory) << "[PluginService] Skipping plugin " << plugin->GetName() << ": " << error << std::endl;
+    }
+    // Skipped plugins keep a zero duration
+    FinishInit(index, initialized, error, started, attempted ? std::chrono::steady_clock::now() : started);
+}
+
+bool PluginService::InitPlugin(IPlugin& plugin, std::string& error) {
+    try {
+        APX_LOG_INFO(logger, logCategory) << "[PluginService] Initializing plugin: " << plugin.GetName() << std::endl;
+        // Only plugins configured for it get a thread of their own, thread.default is not enough
+        if (config->HasThreadPolicy(plugin.GetName())) {
+            plugin.SetThreadPolicy(config->GetThreadPolicy(plugin.GetName()));
+        }
+        plugin.Init();
+        return true;
+    } catch (const std::exception& e) {
+        error = e.what();
+        APX_LOG_ERROR(logger, logCategory) << "[PluginService] Plugin Init() failed: " << e.what() << std::endl;
+    } catch (...) {
+        error = "unknown error";
+        APX_LOG_ERROR(logger, logCategory) << "[PluginService] Plugin Init() encountered an unknown error!" << std::endl;
+    }
+    return false;
+}
+
+void PluginService::RunPlugin(size_t index) {
+    std::shared_ptr<IPlugin> plugin;
+    {
+        std::lock_guard<std::mutex> lock(initMutex);
+        plugin = plugins[index];
+        nodes[index].running = true;
+        runningPlugins++;
+    }
+    executor->Submit([plugin, index, this] {
+        {
+            std::lock_guard<std::mutex> lock(initMutex);
+            nodes[index].busySince = LatencyHistogram::Now();
+            nodes[index].busyWith = "Run()";
         }
+        Plugin::CallbackScope scope(plugin.get());
+        try {
+            APX_LOG_INFO(logger, logCategory) << "[PluginService] Running plugin: " << plugin->GetName() << std::endl;
+            plugin->Run();
+        } catch (const std::exception& e) {
+            APX_LOG_ERROR(logger, logCategory) << "[PluginService] Plugin Run() failed: " << e.what() << std::endl;
+        } catch (...) {
+            APX_LOG_ERROR(logger, logCategory) << "[PluginService] Plugin Run() encountered an unknown error!" << std::endl;
+        }
+
+        // Notify under the lock, StopPlugins() may destroy us as soon as it gets the lock
+        std::lock_guard<std::mutex> lock(initMutex);
+        nodes[index].running = false;
+        nodes[index].busySince = 0;
+        runningPlugins--;
+        initCondition.notify_all();
     });
 }
 
-void PluginService::StopPlugins() {
+void PluginService::FinishInit(size_t index, bool initialized, const std::string& error,
+                               std::chrono::steady_clock::time_point started, std::chrono::steady_clock::time_point finished) {
+    std::vector<size_t> next;
+    {
+        std::lock_guard<std::mutex> lock(initMutex);
+        PluginNode& node = nodes[index];
+        node.busySince = 0;
+        node.timing.start = SinceInitStart(started);
+        node.timing.duration = finished - started;
+        node.timing.initialized = initialized;
+        node.timing.error = error;
+
+        std::chrono::nanoseconds slowest{0};
+        for (size_t dependency : node.dependencies) {
+            slowest = std::max(slowest, nodes[dependency].timing.criticalPath);
+        }
+        node.timing.criticalPath = slowest + node.timing.duration;
+
+        if (initialized) {
+            initOrder.push_back(index);
+            ChangeUpdaters();
+        }
+        for (size_t dependent : node.dependents) {
+            if (!initialized && nodes[dependent].timing.error.empty()) {
+                nodes[dependent].timing.error = "dependency " + node.timing.name + " not initialized";
+            }
+            if (--nodes[dependent].remaining == 0) {
+                next.push_back(dependent);
+            }
+        }
+        initializedPlugins++;
+        initCondition.notify_all();
+    }
+
+    for (size_t dependent : next) {
+        executor->Submit([this, dependent] { StartInit(dependent); });
+    }
+}
+
+void PluginService::LogStartupReport(std::chrono::nanoseconds total) const {
+    auto toMs = [](std::chrono::nanoseconds duration) { return duration.count() / 1000 / 1000.0; };
+
+    std::vector<PluginStartupTiming> report = GetStartupReport();
+    std::sort(report.begin(), report.end(), [](const PluginStartupTiming& a, const PluginStartupTiming& b) {
+        return a.wave != b.wave ? a.wave < b.wave : a.start < b.start;
+    });
+
+    std::chrono::nanoseconds sum{0};
+    const PluginStartupTiming* critical = nullptr;
+    for (const auto& timing : report) {
+        if (!timing.initialized && timing.duration.count() == 0) {
+            APX_LOG_INFO(logger, logCategory) << "[PluginService] Startup: " << timing.name << " wave " << timing.wave
+                                              << ", skipped: " << timing.error << std::endl;
+            continue;
+        }
+        APX_LOG_INFO(logger, logCategory) << "[PluginService] Startup: " << timing.name << " wave " << timing.wave
+                                          << ", started at " << toMs(timing.start) << " ms, Init() took "
+                                          << toMs(timing.duration) << " ms" << (timing.initialized ? "" : ", failed") << std::endl;
+        sum += timing.duration;
+        if (critical == nullptr || timing.criticalPath > critical->criticalPath) {
+            critical = &timing;
+        }
+    }
+    APX_LOG_INFO(logger, logCategory) << "[PluginService] Startup took " << toMs(total) << " ms for " << report.size()
+                                      << " plugins, Init() total " << toMs(sum) << " ms, critical path "
+                                      << (critical ? toMs(critical->criticalPath) : 0.0) << " ms"
+                                      << (critical ? " ending at " + critical->name : std::string()) << std::endl;
+}
+
+std::shared_ptr<IPlugin> PluginService::OpenLibrary(const std::string& path, const PluginManifest& manifest, std::string& errorMessage, bool privateCopy) {
+    if (manifest.isolated) {
+        // A new process maps the library as it is on disk now, a private copy is never needed
+        auto plugin = std::make_shared<RemotePlugin>(eventService, logger, executor, path, manifest, stopTimeout);
+        if (!plugin->Start(config->GetString("isolation.host", RemotePlugin::DefaultHostPath()), config->GetString("isolation.config", ""), errorMessage)) {
+            return nullptr;
+        }
+        return plugin;
+    }
+
+    void* handle = nullptr;
+    ApertusPluginServices services{APERTUS_PLUGIN_API_VERSION, eventService, logger, executor};
+    auto plugin = PluginLoader::Load(path, services, errorMessage, handle, privateCopy);
+    if (handle != nullptr) {
+        std::lock_guard<std::mutex> lock(libraryMutex);
+        libraryHandles.push_back(handle);
+    }
+    if (plugin) {
+        APX_LOG_DEBUG(logger, logCategory) << "[PluginService] Loaded plugin " << plugin->GetName() << " from " << path << std::endl;
+    }
+    return plugin;
+}
+
+void PluginService::ActivateLibrary(PluginLibrary& library) {
+    // Runs on the executor while the activation events wait; once, whichever topic fired
+    std::call_once(library.activated, [this, &library] {
+        auto started = std::chrono::steady_clock::now();
+        LifecycleChange change(*this);
+        if (!change) {
+            return;
+        }
+
+        std::string error;
+        auto plugin = OpenLibrary(library.path, library.manifest, error);
+        if (!plugin) {
+            APX_LOG_ERROR(logger, logCategory) << "[PluginService] Cannot load plugin " << library.path << ": " << error << std::endl;
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(libraryMutex);
+            library.pluginName = plugin->GetName();
+        }
+
+        size_t index;
+        {
+            std::lock_guard<std::mutex> lock(initMutex);
+            index = plugins.size();
+            plugins.push_back(plugin);
+            totalPlugins++;
+            nodes.resize(plugins.size());  // Registered plugins get their nodes from BuildGraph()
+            nodes[index].reachable = true;
+            nodes[index].activated = true;
+            nodes[index].timing.name = plugin->GetName();
+            nodes[index].timing.library = library.path;
+            error = UnmetDependency(*plugin);
+        }
+
+        auto initStarted = std::chrono::steady_clock::now();
+        bool initialized = error.empty() && InitPlugin(*plugin, error);
+        auto finished = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> lock(initMutex);
+            PluginStartupTiming& timing = nodes[index].timing;
+            timing.start = SinceInitStart(initStarted);
+            timing.duration = finished - initStarted;
+            timing.criticalPath = timing.duration;
+            timing.initialized = initialized;
+            timing.error = error;
+            if (initialized) {
+                initOrder.push_back(index);
+                ChangeUpdaters();
+            }
+        }
+
+        if (!initialized) {
+            APX_LOG_ERROR(logger, logCategory) << "[PluginService] Cannot activate plugin " << plugin->GetName() << ": " << error << std::endl;
+            return;
+        }
+        RunPlugin(index);
+        APX_LOG_INFO(logger, logCategory) << "[PluginService] Activated plugin " << plugin->GetName() << " in "
+                                          << std::chrono::duration_cast<std::chrono::microseconds>(finished - started).count() / 1000.0
+                                          << " ms" << std::endl;
+    });
+}
+
+std::chrono::nanoseconds PluginService::SinceInitStart(std::chrono::steady_clock::time_point time) const {
+    if (initStart == std::chrono::steady_clock::time_point() || time < initStart) {
+        return std::chrono::nanoseconds(0);  // Activated before InitPlugins() was called
+    }
+    return time - initStart;
+}
+
+std::string PluginService::UnmetDependency(const IPlugin& plugin, size_t excluded) const {
+    std::unordered_set<std::string> names;
+    std::unordered_set<std::string> capabilities;
+    for (size_t index : initOrder) {
+        if (index == excluded) {
+            continue;
+        }
+        names.insert(plugins[index]->GetName());
+        for (const auto& capability : plugins[index]->GetProvides()) {
+            capabilities.insert(capability);
+        }
+    }
+    for (const auto& dependency : plugin.GetDependencies()) {
+        if (names.count(dependency) == 0) {
+            return "dependency " + dependency + " not initialized";
+        }
+    }
+    for (const auto& capability : plugin.GetRequires()) {
+        if (capabilities.count(capability) == 0) {
+            return "no initialized plugin provides " + capability;
+        }
+    }
+    return std::string();
+}
+
+PluginService::PluginLibrary* PluginService::FindLibrary(const std::string& pluginName) {
+    std::lock_guard<std::mutex> lock(libraryMutex);
+    for (const auto& library : libraries) {
+        if (library->pluginName == pluginName) {
+            return library.get();
+        }
+    }
+    return nullptr;
+}
+
+bool PluginService::FindPlugin(const std::string& name, size_t& index) const {
+    // Unloaded plugins keep their node, so they can be found by name and loaded again
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (nodes[i].timing.name == name) {
+            index = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+PluginService::LifecycleChange::LifecycleChange(PluginService& service) : service(service) {
+    std::lock_guard<std::mutex> lock(service.initMutex);
+    entered = !service.shutdownCalled;
+    if (entered) {
+        service.lifecycleChanges++;
+    }
+}
+
+PluginService::LifecycleChange::~LifecycleChange() {
+    if (entered) {
+        std::lock_guard<std::mutex> lock(service.initMutex);
+        service.lifecycleChanges--;
+        service.initCondition.notify_all();
+    }
+}
+
+std::string PluginService::StopPlugin(size_t index) {
+    std::shared_ptr<IPlugin> plugin;
+    bool initialized;
+    {
+        std::lock_guard<std::mutex> lock(initMutex);
+        plugin = plugins[index];
+        auto it = std::find(initOrder.begin(), initOrder.end(), index);
+        initialized = it != initOrder.end();
+        if (initialized) {
+            initOrder.erase(it);
+            ChangeUpdaters();
+        }
+    }
+    if (!plugin) {
+        return std::string();  // Unloaded already
+    }
+    {
+        // The next frame leaves the plugin out; let the current one finish its Update()
+        std::lock_guard<std::mutex> frameLock(frameMutex);
+    }
+
+    plugin->Destroy();
+    {
+        // Run() holds on to the plugin until it returns
+        std::unique_lock<std::mutex> lock(initMutex);
+        initCondition.wait(lock, [this, index] { return !nodes[index].running; });
+        plugins[index] = nullptr;
+        nodes[index].timing.initialized = false;
+        nodes[index].timing.error = "unloaded";
+    }
+
+    std::string state;
+    if (initialized) {
+        try {
+            state = plugin->SerializeState();
+        } catch (const std::exception& e) {
+            APX_LOG_ERROR(logger, logCategory) << "[PluginService] Plugin SerializeState() failed: " << e.what() << std::endl;
+        } catch (...) {
+            APX_LOG_ERROR(logger, logCategory) << "[PluginService] Plugin SerializeState() encountered an unknown error!" << std::endl;
+        }
+    }
+    APX_LOG_INFO(logger, logCategory) << "[PluginService] Unloaded plugin " << plugin->GetName() << std::endl;
+    return state;  // The last reference to plugin goes here; its library stays mapped
+}
+
+bool PluginService::DeferChange(const std::string& name, bool (PluginService::*change)(const std::string&)) {
+    // Counted from now on, so StopPlugins() waits for the task instead of destroying us under it
+    auto pending = std::make_shared<LifecycleChange>(*this);
+    if (!*pending) {
+        return false;
+    }
+    APX_LOG_DEBUG(logger, logCategory) << "[PluginService] Called from " << Plugin::Current()->GetName() << ", changing " << name << " on the executor" << std::endl;
+    executor->Submit([this, name, change, pending] { (this->*change)(name); });
+    return true;
+}
+
+bool PluginService::UnloadPlugin(const std::string& name) {
+    if (Plugin::Current() != nullptr) {
+        // Stopping a plugin waits for its handlers and for the frame, which may both be waiting for the caller
+        return DeferChange(name, &PluginService::UnloadPlugin);
+    }
+    std::lock_guard<std::mutex> changeLock(changeMutex);
+    LifecycleChange change(*this);
+    if (!change) {
+        return false;
+    }
+
+    size_t index;
+    {
+        std::lock_guard<std::mutex> lock(initMutex);
+        if (!FindPlugin(name, index) || !plugins[index]) {
+            APX_LOG_WARNING(logger, logCategory) << "[PluginService] Cannot unload " << name << ": no such plugin loaded" << std::endl;
+            return false;
+        }
+        for (size_t other : initOrder) {
+            if (other != index && !UnmetDependency(*plugins[other], index).empty()) {
+                APX_LOG_WARNING(logger, logCategory) << "[PluginService] Cannot unload " << name << ": "
+                                                     << plugins[other]->GetName() << " depends on it" << std::endl;
+                return false;
+            }
+        }
+    }
+    StopPlugin(index);
+    return true;
+}
+
+bool PluginService::ReloadPlugin(const std::string& name) {
+    if (Plugin::Current() != nullptr) {
+        return DeferChange(name, &PluginService::ReloadPlugin);
+    }
+    std::lock_guard<std::mutex> changeLock(changeMutex);
+    LifecycleChange change(*this);
+    if (!change) {
+        return false;
+    }
+
+    size_t index;
+    PluginLibrary* library = FindLibrary(name);
+    {
+        std::lock_guard<std::mutex> lock(initMutex);
+        if (!FindPlugin(name, index) || library == nullptr) {
+            APX_LOG_WARNING(logger, logCategory) << "[PluginService] Cannot reload " << name << ": not loaded from a shared library" << std::endl;
+            return false;
+        }
+    }
+
+    // Load the new version while the old one keeps running, so a broken build costs nothing
+    auto started = std::chrono::steady_clock::now();
+    std::string error;
+    auto plugin = OpenLibrary(library->path, PluginLoader::ReadManifest(library->path), error, true);
+    if (plugin && plugin->GetName() != name) {
+        error = "the library now contains plugin " + plugin->GetName();
+        plugin = nullptr;
+    }
+    if (plugin) {
+        std::lock_guard<std::mutex> lock(initMutex);
+        error = UnmetDependency(*plugin, index);
+        if (!error.empty()) {
+            plugin = nullptr;
+        }
+    }
+    if (!plugin) {
+        APX_LOG_ERROR(logger, logCategory) << "[PluginService] Cannot reload " << name << ", keeping the running instance: " << error << std::endl;
+        return false;
+    }
+
+    auto stopStarted = std::chrono::steady_clock::now();
+    std::string state = StopPlugin(index);
+    auto initStarted = std::chrono::steady_clock::now();
+    // Before Init(): its subscriptions deliver events from then on, and none may reach the plugin without its state
+    if (!state.empty()) {
+        try {
+            plugin->RestoreState(state);
+        } catch (const std::exception& e) {
+            APX_LOG_ERROR(logger, logCategory) << "[PluginService] Plugin RestoreState() failed: " << e.what() << std::endl;
+        } catch (...) {
+            APX_LOG_ERROR(logger, logCategory) << "[PluginService] Plugin RestoreState() encountered an unknown error!" << std::endl;
+        }
+    }
+    bool initialized = InitPlugin(*plugin, error);
+    auto finished = std::chrono::steady_clock::now();
+    {
+        // A failed instance keeps the slot, StopPlugins() destroys it like any other
+        std::lock_guard<std::mutex> lock(initMutex);
+        plugins[index] = plugin;
+        PluginStartupTiming& timing = nodes[index].timing;
+        timing.start = SinceInitStart(initStarted);
+        timing.duration = finished - initStarted;
+        timing.criticalPath = timing.duration;
+        timing.initialized = initialized;
+        timing.error = error;
+        if (initialized) {
+            initOrder.push_back(index);
+            ChangeUpdaters();
+        }
+    }
+
+    if (!initialized) {
+        APX_LOG_ERROR(logger, logCategory) << "[PluginService] Cannot reload " << name << ": " << error << std::endl;
+        return false;
+    }
+    RunPlugin(index);
+
+    auto toMs = [](std::chrono::steady_clock::duration duration) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(duration).count() / 1000.0;
+    };
+    APX_LOG_INFO(logger, logCategory) << "[PluginService] Reloaded plugin " << name << " in " << toMs(finished - started)
+                                      << " ms, " << toMs(finished - stopStarted) << " ms without a running instance"
+                                      << (state.empty() ? "" : ", state handed over") << std::endl;
+    return true;
+}
+
+void PluginService::SetFrameRate(double framesPerSecond) {
+    bool restart;
+    {
+        std::lock_guard<std::mutex> lock(clockMutex);
+        frameRate = std::max(0.0, framesPerSecond);
+        restart = frameClockRunning;
+    }
+    if (restart) {
+        StopFrameClock();
+        StartFrameClock();
+    }
+}
+
+void PluginService::StartFrameClock() {
+    std::lock_guard<std::mutex> lock(clockMutex);
+    if (frameRate <= 0 || frameClockRunning || shutdownCalled) {
+        return;
+    }
+    auto period = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>(1.0 / frameRate));
+    frameClockRunning = true;
+    frameThread = PolicyThread(PolicyThread::Named(framePolicy, "apx-frame"), [this, period] { FrameLoop(period); });
+    if (!frameThread.PolicyError().empty()) {
+        APX_LOG_WARNING(logger, logCategory) << "[PluginService] Frame thread policy not fully applied: " << frameThread.PolicyError() << std::endl;
+    }
+    APX_LOG_INFO(logger, logCategory) << "[PluginService] Frame clock started at " << frameRate << " Hz" << std::endl;
+}
+
+void PluginService::StopFrameClock() {
+    {
+        std::lock_guard<std::mutex> lock(clockMutex);
+        if (!frameClockRunning) {
+            return;
+        }
+        frameClockRunning = false;
+    }
+    clockCondition.notify_all();
+    frameThread.Join();
+    updateWaves.clear();
+    updatersChanged = true;
+
+    FrameStats stats = GetFrameStats();
+    if (stats.frames != 0) {
+        APX_LOG_INFO(logger, logCategory) << "[PluginService] Frames: " << stats.frames << ", frame time p50 " << ToMs(stats.frameTime.p50)
+                                          << " ms, p99 " << ToMs(stats.frameTime.p99) << " ms, max " << ToMs(stats.frameTime.max)
+                                          << " ms, jitter p50 " << ToMs(stats.jitter.p50) << " ms, p99 " << ToMs(stats.jitter.p99)
+                                          << " ms, max " << ToMs(stats.jitter.max) << " ms, " << stats.overruns << " overruns, "
+                                          << stats.skipped << " skipped" << std::endl;
+    }
+}
+
+void PluginService::FrameLoop(std::chrono::nanoseconds period) {
+    using Clock = std::chrono::steady_clock;
+    auto next = Clock::now() + period;
+    auto previous = Clock::now();
+    auto reported = previous;
+    uint64_t reportedOverruns = 0;
+
+    for (;;) {
+        bool idle;
+        {
+            std::lock_guard<std::mutex> frameLock(frameMutex);
+            if (updatersChanged.exchange(false)) {
+                CollectUpdaters();
+            }
+            idle = updateWaves.empty();
+        }
+        if (idle) {
+            // Nothing to tick; sleep until a plugin that wants updates is initialized
+            std::unique_lock<std::mutex> lock(clockMutex);
+            clockCondition.wait(lock, [this] { return !frameClockRunning || updatersChanged.load(); });
+            if (!frameClockRunning) {
+                break;
+            }
+            previous = Clock::now();
+            next = previous + period;
+            continue;
+        }
+        {
+            // Sleeping alone wakes up tens of microseconds late, yield through the last stretch
+            std::unique_lock<std::mutex> lock(clockMutex);
+            if (clockCondition.wait_until(lock, next - kFrameSpin, [this] { return !frameClockRunning; })) {
+                break;
+            }
+        }
+        while (Clock::now() < next) {
+            std::this_thread::yield();
+        }
+
+        auto started = Clock::now();
+        frameJitter.Record(static_cast<uint64_t>((started - next).count()));
+        {
+            std::lock_guard<std::mutex> frameLock(frameMutex);
+            RunFrame(started - previous);
+        }
+        previous = started;
+        auto finished = Clock::now();
+        frameTime.Record(static_cast<uint64_t>((finished - started).count()));
+        frames.fetch_add(1, std::memory_order_relaxed);
+        if (finished - started > period) {
+            frameOverruns.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // The grid stays fixed; frames missed entirely are dropped instead of run back to back
+        next += period;
+        if (finished - next >= period) {
+            auto behind = (finished - next) / period;
+            skippedFrames.fetch_add(static_cast<uint64_t>(behind), std::memory_order_relaxed);
+            next += behind * period;
+        }
+
+        if (finished - reported >= std::chrono::seconds(1)) {
+            uint64_t overruns = frameOverruns.load(std::memory_order_relaxed);
+            if (overruns != reportedOverruns) {
+                APX_LOG_WARNING(logger, logCategory) << "[PluginService] " << overruns - reportedOverruns
+                                                     << " frame overrun(s) in the last second, frame time p99 "
+                                                     << ToMs(frameTime.Snapshot().p99) << " ms" << std::endl;
+                reportedOverruns = overruns;
+            }
+            reported = finished;
+        }
+    }
+}
+
+void PluginService::RunFrame(std::chrono::nanoseconds deltaTime) {
+    if (updatersChanged.exchange(false)) {
+        CollectUpdaters();  // Under frameMutex, StopPlugin() relies on it
+    }
+    for (const auto& wave : updateWaves) {
+        auto done = std::make_shared<FrameWave>(wave.size());
+        for (const auto& updater : wave) {
+            auto tick = std::make_shared<const FrameTick>(deltaTime, done);
+            if (updater.mailbox != nullptr) {
+                // Block: the wave waits for every tick, none may be dropped
+                updater.mailbox->Deliver(frameTopic, updater.handler.get(), EventPayload(tick), DeliveryPolicy::Block);
+            } else {
+                executor->Submit([plugin = updater.plugin, tick] {
+                    Plugin::CallbackScope scope(plugin.get());
+                    plugin->Update(tick->deltaTime);
+                });
+            }
+        }
+        done->Wait();
+    }
+}
+
+void PluginService::ChangeUpdaters() {
+    updatersChanged = true;
+    {
+        // The frame thread checks the flag under clockMutex, so it cannot miss the notification
+        std::lock_guard<std::mutex> lock(clockMutex);
+    }
+    clockCondition.notify_all();
+}
+
+void PluginService::CollectUpdaters() {
+    std::vector<std::pair<size_t, std::shared_ptr<IPlugin>>> byWave;
+    {
+        std::lock_guard<std::mutex> lock(initMutex);
+        for (size_t index : initOrder) {
+            if (plugins[index]->WantsUpdate()) {
+                byWave.emplace_back(nodes[index].timing.wave, plugins[index]);
+            }
+        }
+    }
+    std::stable_sort(byWave.begin(), byWave.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    // No tick of the previous list is pending anymore, its handlers can go
+    updateWaves.clear();
+    for (size_t i = 0; i < byWave.size(); ++i) {
+        if (i == 0 || byWave[i].first != byWave[i - 1].first) {
+            updateWaves.emplace_back();
+        }
+        Updater updater;
+        updater.plugin = byWave[i].second;
+        updater.mailbox = dynamic_cast<IEventMailbox*>(updater.plugin.get());
+        IPlugin* plugin = updater.plugin.get();
+        updater.handler = std::make_unique<IEventService::PayloadCallback>([plugin](const EventPayload& payload) {
+            if (auto tick = payload.As<FrameTick>()) {
+                plugin->Update(tick->deltaTime);
+            }
+        });
+        updateWaves.back().push_back(std::move(updater));
+    }
+}
+
+FrameStats PluginService::GetFrameStats() const {
+    FrameStats stats;
+    {
+        std::lock_guard<std::mutex> lock(clockMutex);
+        stats.rate = frameClockRunning ? frameRate : 0;
+    }
+    stats.frames = frames.load(std::memory_order_relaxed);
+    stats.overruns = frameOverruns.load(std::memory_order_relaxed);
+    stats.skipped = skippedFrames.load(std::memory_order_relaxed);
+    stats.frameTime = frameTime.Snapshot();
+    stats.jitter = frameJitter.Snapshot();
+    return stats;
+}
+
+std::vector<PluginStartupTiming> PluginService::GetStartupReport() const {
     std::lock_guard<std::mutex> lock(initMutex);
+    std::vector<PluginStartupTiming> report;
+    for (const auto& node : nodes) {
+        report.push_back(node.timing);
+    }
+    return report;
+}
+
+void PluginService::StopPlugins() {
+    StopFrameClock();  // Before taking initMutex, a frame in progress may need it
+
+    std::unique_lock<std::mutex> lock(initMutex);
     if (shutdownCalled) return;
 
     shutdownCalled = true;
-    (*logger) << "[PluginService] Stopping plugins..." << std::endl;
+    APX_LOG_INFO(logger, logCategory) << "[PluginService] Stopping plugins..." << std::endl;
 
-    for (auto& plugin : plugins) {
+    // No more lazy loading; let an activation or reload in progress finish so its plugin is stopped as well
+    {
+        std::lock_guard<std::mutex> librariesLock(libraryMutex);
+        for (const auto& library : libraries) {
+            for (auto topic : library->activators) {
+                eventService->SetTopicActivator(topic, nullptr);
+            }
+        }
+    }
+    initCondition.wait(lock, [this] { return lifecycleChanges == 0; });
+
+    // Dependents go first, they may still use what their dependencies provide
+    std::vector<std::shared_ptr<IPlugin>> destroyOrder;
+    std::vector<bool> ordered(plugins.size(), false);
+    for (auto it = initOrder.rbegin(); it != initOrder.rend(); ++it) {
+        destroyOrder.push_back(plugins[*it]);
+        ordered[*it] = true;
+    }
+    for (size_t i = 0; i < plugins.size(); ++i) {
+        if (!ordered[i] && plugins[i]) {
+            destroyOrder.push_back(plugins[i]);
+        }
+    }
+
+    // Destroy() still handles the events queued for the plugin, whose handlers may call us. Each
+    // one gets the full timeout, a plugin that hangs must not cost the others theirs.
+    std::vector<std::pair<std::shared_ptr<IPlugin>, std::string>> abandoned;
+    lock.unlock();
+    for (auto& plugin : destroyOrder) {
+        if (!DestroyBefore(plugin, std::chrono::steady_clock::now() + stopTimeout)) {
+            abandoned.emplace_back(plugin, "Destroy() did not return within " + std::to_string(stopTimeout.count()) + " ms");
+        }
+    }
+    lock.lock();
+
+    // Run() tasks still going hold on to their plugin
+    auto stopped = [this] { return runningPlugins.load() == 0; };
+    if (stopTimeout.count() == 0) {
+        initCondition.wait(lock, stopped);
+    } else if (!initCondition.wait_for(lock, stopTimeout, stopped)) {
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            bool listed = std::any_of(abandoned.begin(), abandoned.end(), [&](const auto& entry) { return entry.first == plugins[i]; });
+            if (nodes[i].running && !listed) {
+                abandoned.emplace_back(plugins[i], "Run() did not return within " + std::to_string(stopTimeout.count()) + " ms");
+            }
+        }
+    }
+    lock.unlock();
+    StopWatchdog();
+
+    if (abandoned.empty()) {
+        APX_LOG_INFO(logger, logCategory) << "[PluginService] All plugins have been stopped." << std::endl;
+        return;
+    }
+
+    // Their threads still use them, and maybe us: keep them alive and let the process exit
+    for (auto& entry : abandoned) {
+        PluginHealth report;
+        report.name = entry.first->GetName();
+        report.state = PluginHealthState::Abandoned;
+        report.reason = entry.second;
+        {
+            std::lock_guard<std::mutex> healthLock(healthMutex);
+            auto it = std::find_if(health.begin(), health.end(), [&report](const PluginHealth& h) { return h.name == report.name; });
+            if (it != health.end()) {
+                *it = report;
+            } else {
+                health.push_back(report);
+            }
+        }
+        PublishHealth(report);
+        abandonedPlugins.push_back(std::move(entry.first));
+    }
+    APX_LOG_ERROR(logger, logCategory) << "[PluginService] Stopped with " << abandoned.size() << " plugin(s) abandoned." << std::endl;
+}
+
+bool PluginService::DestroyBefore(const std::shared_ptr<IPlugin>& plugin, std::chrono::steady_clock::time_point deadline) {
+    if (stopTimeout.count() == 0) {
         plugin->Destroy();
+        return true;
+    }
+
+    // A Destroy() that hangs must not take StopPlugins() with it; its thread is abandoned then
+    auto done = std::make_shared<std::promise<void>>();
+    std::future<void> destroyed = done->get_future();
+    PolicyThread destroyer(PolicyThread::Named(ThreadPolicy(), "apx-destroy"), [logger = logger, logCategory = logCategory, plugin = plugin, done]() mutable {
+        try {
+            plugin->Destroy();
+        } catch (const std::exception& e) {
+            APX_LOG_ERROR(logger, logCategory) << "[PluginService] Plugin Destroy() failed: " << e.what() << std::endl;
+        } catch (...) {
+            APX_LOG_ERROR(logger, logCategory) << "[PluginService] Plugin Destroy() encountered an unknown error!" << std::endl;
+        }
+        // Released before signalling, so the plugin is never freed here after StopPlugins() returned
+        plugin.reset();
+        done->set_value();
+    });
+    if (destroyed.wait_until(deadline) == std::future_status::ready) {
+        destroyer.Join();
+        return true;
     }
+    abandonedThreads.push_back(std::move(destroyer));
+    return false;
+}
 
-    for (auto& thread : pluginThreads) {
-        if (thread.joinable()) {
-            thread.join();
+void PluginService::StartWatchdog() {
+    std::lock_guard<std::mutex> lock(watchdogMutex);
+    if (watchdogInterval.count() == 0 || watchdogRunning || shutdownCalled) {
+        return;
+    }
+    watchdogRunning = true;
+    watchdogThread = PolicyThread(PolicyThread::Named(watchdogPolicy, "apx-watchdog"), [this] { WatchdogLoop(); });
+    if (!watchdogThread.PolicyError().empty()) {
+        APX_LOG_WARNING(logger, logCategory) << "[PluginService] Watchdog thread policy not fully applied: " << watchdogThread.PolicyError() << std::endl;
+    }
+}
+
+void PluginService::StopWatchdog() {
+    {
+        std::lock_guard<std::mutex> lock(watchdogMutex);
+        watchdogRunning = false;
+    }
+    watchdogCondition.notify_all();
+    watchdogThread.Join();
+}
+
+void PluginService::WatchdogLoop() {
+    auto last = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(watchdogMutex);
+    while (!watchdogCondition.wait_for(lock, watchdogInterval, [this] { return !watchdogRunning; })) {
+        lock.unlock();
+        auto now = std::chrono::steady_clock::now();
+        CheckPlugins(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - last).count()));
+        last = now;
+        lock.lock();
+    }
+}
+
+void PluginService::CheckPlugins(uint64_t elapsed) {
+    struct Watched {
+        std::shared_ptr<IPlugin> plugin;
+        std::string name;
+        uint64_t busySince;
+        const char* busyWith;
+    };
+    std::vector<Watched> watched;
+    {
+        std::lock_guard<std::mutex> lock(initMutex);
+        for (size_t i = 0; i < std::min(plugins.size(), nodes.size()); ++i) {
+            if (plugins[i]) {
+                watched.push_back({plugins[i], nodes[i].timing.name, nodes[i].busySince, nodes[i].busyWith});
+            }
         }
     }
 
-    for (auto& thread : eventThreads) {
-        if (thread.joinable()) {
-            thread.join();
+    uint64_t now = LatencyHistogram::Now();
+    std::unordered_map<const IPlugin*, WatchdogSample> checked;
+    std::vector<PluginHealth> reports;
+    for (const auto& entry : watched) {
+        const WatchdogBudget& budget = BudgetOf(entry.name);
+        PluginActivity activity = entry.plugin->GetActivity();
+
+        // A reloaded plugin may get the address of the old one; its counters start over
+        WatchdogSample sample;
+        auto previous = samples.find(entry.plugin.get());
+        bool known = previous != samples.end() && activity.cpuTime >= previous->second.cpuTime &&
+                     activity.handled >= previous->second.handled;
+        if (known) {
+            sample = previous->second;
+        }
+
+        PluginHealth report;
+        report.name = entry.name;
+        report.cpuTime = activity.cpuTime;
+        report.cpuLoad = known && elapsed != 0 ? static_cast<double>(activity.cpuTime - sample.cpuTime) / elapsed : 0;
+        report.handled = activity.handled;
+        report.backlog = activity.backlog;
+        report.busyFor = Since(now, entry.busySince != 0 ? entry.busySince : activity.busySince);
+        report.sinceHeartbeat = Since(now, activity.lastHeartbeat);
+        report.handlerTime = activity.handlerTime;
+        if (!known || activity.handled != sample.handled || activity.backlog == 0) {
+            sample.progress = now;
+        }
+
+        std::ostringstream reason;
+        if (budget.handler != 0 && report.busyFor > budget.handler) {
+            report.state = PluginHealthState::Stalled;
+            reason << (entry.busySince != 0 ? entry.busyWith : "event handler") << " running for " << ToMs(report.busyFor) << " ms";
+        } else if (budget.heartbeat != 0 && report.sinceHeartbeat > budget.heartbeat) {
+            report.state = PluginHealthState::Stalled;
+            reason << "no heartbeat for " << ToMs(report.sinceHeartbeat) << " ms";
+        } else if (budget.handler != 0 && now - sample.progress > budget.handler) {
+            report.state = PluginHealthState::Stalled;
+            reason << report.backlog << " events queued, none handled for " << ToMs(now - sample.progress) << " ms";
+        } else if (budget.backlog != 0 && report.backlog > budget.backlog) {
+            report.state = PluginHealthState::Overloaded;
+            reason << report.backlog << " events queued, budget " << budget.backlog;
+        } else if (budget.cpuLoad > 0 && report.cpuLoad > budget.cpuLoad) {
+            report.state = PluginHealthState::Overloaded;
+            reason << "using " << report.cpuLoad * 100 << "% CPU, budget " << budget.cpuLoad * 100 << "%";
         }
+        report.reason = reason.str();
+
+        if (report.state != sample.state) {
+            if (report.state == PluginHealthState::Healthy) {
+                APX_LOG_INFO(logger, logCategory) << "[PluginService] Plugin " << report.name << " is healthy again" << std::endl;
+            } else {
+                APX_LOG_WARNING(logger, logCategory) << "[PluginService] Plugin " << report.name << " " << ToString(report.state)
+                                                     << ": " << report.reason << std::endl;
+            }
+            PublishHealth(report);
+        }
+        sample.state = report.state;
+        sample.cpuTime = activity.cpuTime;
+        sample.handled = activity.handled;
+        checked[entry.plugin.get()] = sample;
+        reports.push_back(std::move(report));
     }
 
-    (*logger) << "[PluginService] All plugins have been stopped." << std::endl;
+    samples.swap(checked);  // Forgets plugins unloaded since
+    std::lock_guard<std::mutex> lock(healthMutex);
+    health.swap(reports);
+}
+
+const PluginService::WatchdogBudget& PluginService::BudgetOf(const std::string& pluginName) {
+    auto it = budgets.find(pluginName);
+    if (it != budgets.end()) {
+        return it->second;
+    }
+    auto setting = [this, &pluginName](const std::string& key, int64_t defaultValue) {
+        int64_t value = config->GetInt("watchdog." + pluginName + "." + key, config->GetInt("watchdog." + key, defaultValue));
+        return static_cast<uint64_t>(std::max<int64_t>(0, value));
+    };
+    WatchdogBudget budget;
+    budget.handler = setting("handler_ms", 1000) * 1000 * 1000;
+    budget.heartbeat = setting("heartbeat_ms", 5000) * 1000 * 1000;
+    budget.backlog = static_cast<size_t>(setting("backlog", Plugin::kMailboxCapacity / 2));
+    budget.cpuLoad = setting("cpu_percent", 0) / 100.0;
+    return budgets.emplace(pluginName, budget).first->second;
+}
+
+void PluginService::PublishHealth(const PluginHealth& report) {
+    eventService->TriggerPayload(healthTopic, EventPayload(std::make_shared<const PluginHealth>(report)));
+}
+
+std::vector<PluginHealth> PluginService::GetPluginHealth() const {
+    std::lock_guard<std::mutex> lock(healthMutex);
+    return health;
 }
 
 PluginService::~PluginService() {
     StopPlugins();
+
+    // Plugin libraries stay mapped until exit: payloads and callbacks created by plugin code can
+    // outlive the plugin in the EventService, and libraries like GStreamer cannot be unloaded anyway
+    plugins.clear();
+
+    // Destroying an abandoned plugin would wait for its stuck thread again; leave it to the exit
+    for (auto& plugin : abandonedPlugins) {
+        new std::shared_ptr<IPlugin>(std::move(plugin));
+    }
+    // Joining a thread stuck in Destroy() would hang the same way
+    for (auto& thread : abandonedThreads) {
+        new PolicyThread(std::move(thread));
+    }
 }
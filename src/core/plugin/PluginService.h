@@ -4,38 +4,198 @@
 #include "interfaces/IPluginService.h"
 #include "interfaces/IEventService.h"
 #include "interfaces/ILoggerService.h"
+#include "interfaces/IExecutorService.h"
+#include "interfaces/IConfigService.h"
+#include "concurrency/PolicyThread.h"
+#include "metrics/LatencyHistogram.h"
+#include "PluginLoader.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <unordered_map>
 #include <vector>
 #include <memory>
-#include <thread>
 #include <fruit/fruit.h>
 
 class PluginService : public IPluginService {
 public:
-    INJECT(PluginService(IEventService* eventService, ILoggerService* logger));
+    INJECT(PluginService(IEventService* eventService, ILoggerService* logger, IExecutorService* executor, IConfigService* config));
     ~PluginService() override;
 
     void RegisterPlugin(std::shared_ptr<IPlugin> plugin) override;
+    size_t LoadPlugins(const std::string& directory) override;
     void InitPlugins() override;
     void StopPlugins() override;
+    bool UnloadPlugin(const std::string& name) override;
+    bool ReloadPlugin(const std::string& name) override;
+    std::vector<PluginStartupTiming> GetStartupReport() const override;
+    void SetFrameRate(double framesPerSecond) override;
+    FrameStats GetFrameStats() const override;
+    std::vector<PluginHealth> GetPluginHealth() const override;
+
+    // The frame clock sleeps until this long before a frame, then yields until it is due
+    static constexpr std::chrono::microseconds kFrameSpin{100};
 
     // static void SignalHandler(int signal);
 
 private:
     IEventService* eventService;
     ILoggerService* logger;
+    IExecutorService* executor;
+    IConfigService* config;
+    LogCategory* logCategory;
+
+    struct PluginNode {
+        std::vector<size_t> dependencies;  // Indices into plugins
+        std::vector<size_t> dependents;
+        size_t remaining = 0;  // Dependencies whose Init() has not finished yet
+        bool reachable = false;  // Not on or behind a dependency cycle
+        bool running = false;    // Run() has not returned yet
+        bool activated = false;  // Loaded by ActivateLibrary(), which inits and runs it outside the graph
+        uint64_t busySince = 0;  // Start of the Init() or Run() call in progress, for the watchdog
+        const char* busyWith = "";
+        PluginStartupTiming timing;
+    };
+
+    // Fills nodes from the declared dependencies; returns how many plugins can be scheduled
+    size_t BuildGraph();
+    void StartInit(size_t index);
+    void FinishInit(size_t index, bool initialized, const std::string& error,
+                    std::chrono::steady_clock::time_point started, std::chrono::steady_clock::time_point finished);
+    void LogStartupReport(std::chrono::nanoseconds total) const;
+    bool InitPlugin(IPlugin& plugin, std::string& error);
+    void RunPlugin(size_t index);
+
+    // Destroys the plugin at index and empties its slot; returns its SerializeState()
+    std::string StopPlugin(size_t index);
+
+    // Runs UnloadPlugin() or ReloadPlugin() on the executor, for calls from plugin code; false once stopping
+    bool DeferChange(const std::string& name, bool (PluginService::*change)(const std::string&));
+    bool FindPlugin(const std::string& name, size_t& index) const;
+
+    // Counts an activation, unload or reload in progress, StopPlugins() waits for them; false once stopping
+    class LifecycleChange {
+    public:
+        explicit LifecycleChange(PluginService& service);
+        ~LifecycleChange();
+        explicit operator bool() const { return entered; }
+
+    private:
+        PluginService& service;
+        bool entered;
+    };
+
+    // Shared-library plugins
+    struct PluginLibrary {
+        std::string path;
+        PluginManifest manifest;
+        std::vector<IEventService::TopicId> activators;
+        std::once_flag activated;
+        std::string pluginName;  // Once loaded
+    };
+
+    // privateCopy loads the file as it is on disk now, even if an older version is mapped already.
+    // Isolated plugins get a RemotePlugin and a process of their own.
+    std::shared_ptr<IPlugin> OpenLibrary(const std::string& path, const PluginManifest& manifest, std::string& errorMessage,
+                                         bool privateCopy = false);
+    void ActivateLibrary(PluginLibrary& library);
+    PluginLibrary* FindLibrary(const std::string& pluginName);
+
+    // Why plugin cannot run with the initialized plugins, not counting the one at excluded
+    std::string UnmetDependency(const IPlugin& plugin, size_t excluded = SIZE_MAX) const;
+
+    // Frame clock
+    struct Updater {
+        std::shared_ptr<IPlugin> plugin;
+        IEventMailbox* mailbox = nullptr;  // The plugin, if Update() goes through its mailbox
+        std::unique_ptr<IEventService::PayloadCallback> handler;
+    };
+
+    void StartFrameClock();
+    void StopFrameClock();
+    void FrameLoop(std::chrono::nanoseconds period);
+    void RunFrame(std::chrono::nanoseconds deltaTime);
+    void CollectUpdaters();  // Frame thread only
+    void ChangeUpdaters();   // After initOrder changed, wakes an idle frame thread
+
+    const IEventService::TopicId frameTopic;
+    const ThreadPolicy framePolicy;
+    mutable std::mutex clockMutex;  // Guards frameRate and frameClockRunning, and runs the frame thread's sleep
+    std::condition_variable clockCondition;
+    double frameRate = 0;
+    bool frameClockRunning = false;
+    PolicyThread frameThread;
+    std::mutex frameMutex;  // Held by the frame thread during a frame
+    std::vector<std::vector<Updater>> updateWaves;  // Frame thread only
+    std::atomic<bool> updatersChanged{true};  // Set whenever initOrder changes, see ChangeUpdaters()
+    std::atomic<uint64_t> frames{0};
+    std::atomic<uint64_t> frameOverruns{0};
+    std::atomic<uint64_t> skippedFrames{0};
+    LatencyHistogram frameTime;
+    LatencyHistogram frameJitter;
+
+    // Watchdog
+    struct WatchdogBudget {
+        uint64_t handler = 0;    // Nanoseconds, 0 for no limit; also the longest a backlog may sit
+        uint64_t heartbeat = 0;  // Nanoseconds, 0 for no limit
+        size_t backlog = 0;      // 0 for no limit
+        double cpuLoad = 0;      // Share of one CPU, 0 for no limit
+    };
+
+    struct WatchdogSample {
+        uint64_t cpuTime = 0;
+        uint64_t handled = 0;
+        uint64_t progress = 0;  // Last check that found events handled or none queued
+        PluginHealthState state = PluginHealthState::Healthy;
+    };
+
+    void StartWatchdog();
+    void StopWatchdog();
+    void WatchdogLoop();
+    void CheckPlugins(uint64_t elapsed);
+    const WatchdogBudget& BudgetOf(const std::string& pluginName);  // Watchdog thread only
+    void PublishHealth(const PluginHealth& health);
+
+    // Destroys plugin on a thread of its own, joined once done; false if it has not returned by deadline
+    bool DestroyBefore(const std::shared_ptr<IPlugin>& plugin, std::chrono::steady_clock::time_point deadline);
+
+    const IEventService::TopicId healthTopic;
+    const ThreadPolicy watchdogPolicy;
+    const std::chrono::milliseconds watchdogInterval;  // 0 disables the watchdog
+    const std::chrono::milliseconds stopTimeout;       // 0 waits for StopPlugins() as long as it takes
+    std::mutex watchdogMutex;  // Guards watchdogRunning, and runs the watchdog's sleep
+    std::condition_variable watchdogCondition;
+    bool watchdogRunning = false;
+    PolicyThread watchdogThread;
+    std::unordered_map<std::string, WatchdogBudget> budgets;     // Watchdog thread only
+    std::unordered_map<const IPlugin*, WatchdogSample> samples;  // Watchdog thread only
+    mutable std::mutex healthMutex;
+    std::vector<PluginHealth> health;
+    std::vector<std::shared_ptr<IPlugin>> abandonedPlugins;  // Never destroyed, see StopPlugins()
+    std::vector<PolicyThread> abandonedThreads;  // Still in Destroy() of an abandoned plugin, never joined
+
+    std::vector<std::shared_ptr<IPlugin>> plugins;  // Empty slots for unloaded plugins
+    std::vector<PluginNode> nodes;   // Parallel to plugins, guarded by initMutex
+    std::vector<size_t> initOrder;   // Initialized plugins in the order Init() finished
+    std::chrono::steady_clock::time_point initStart;
+    std::chrono::nanoseconds SinceInitStart(std::chrono::steady_clock::time_point time) const;  // Under initMutex; 0 before InitPlugins()
 
-    std::vector<std::shared_ptr<IPlugin>> plugins;
-    std::vector<std::thread> pluginThreads;
-    std::vector<std::thread> eventThreads;
+    std::mutex libraryMutex;
+    std::vector<std::unique_ptr<PluginLibrary>> libraries;
+    std::vector<void*> libraryHandles;  // Never closed, see ~PluginService()
 
-    std::mutex initMutex;
+    std::mutex changeMutex;  // One UnloadPlugin() or ReloadPlugin() at a time
+    mutable std::mutex initMutex;
     std::condition_variable initCondition;
 
-    std::atomic<int> initializedPlugins{0};
+    std::atomic<int> initializedPlugins{0};  // Plugins whose Init() finished, failed or was skipped
     std::atomic<int> totalPlugins{0};
+    std::atomic<int> runningPlugins{0};  // Run() calls not returned yet
+    int lifecycleChanges = 0;            // See LifecycleChange, guarded by initMutex
     std::atomic<bool> shutdownCalled{false};
-    
-    void StartPluginEventListener(std::shared_ptr<IPlugin> plugin);
 };
 
 #endif // PLUGINSERVICE_H
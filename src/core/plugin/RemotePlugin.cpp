@@ -0,0 +1,389 @@
+#include "RemotePlugin.h"
+#include "metrics/LatencyHistogram.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+namespace {
+// Where the host finds the shared memory descriptor
+constexpr int kChildFd = 3;
+const char* const kHostName = "apertus_plugin_host";
+
+std::string DescribeExit(int status) {
+    if (status == -1) {
+        return "ended";
+    }
+    if (WIFEXITED(status)) {
+        return "exited with status " + std::to_string(WEXITSTATUS(status));
+    }
+    if (WIFSIGNALED(status)) {
+        return "was killed by signal " + std::to_string(WTERMSIG(status)) + " (" + ::strsignal(WTERMSIG(status)) + ")";
+    }
+    return "ended";
+}
+}
+
+RemotePlugin::RemotePlugin(IEventService* eventService, ILoggerService* logger, IExecutorService* executor,
+                           const std::string& libraryPath, const PluginManifest& manifest, std::chrono::milliseconds stopTimeout)
+    : Plugin(eventService, logger, executor), libraryPath(libraryPath), manifest(manifest), stopTimeout(stopTimeout) {}
+
+RemotePlugin::~RemotePlugin() {
+    Destroy();
+}
+
+std::string RemotePlugin::DefaultHostPath() {
+#if defined(__linux__)
+    char executable[4096];
+    ssize_t length = ::readlink("/proc/self/exe", executable, sizeof(executable) - 1);
+    if (length > 0) {
+        std::string path(executable, static_cast<size_t>(length));
+        path = path.substr(0, path.rfind('/') + 1) + kHostName;
+        if (::access(path.c_str(), X_OK) == 0) {
+            return path;
+        }
+    }
+#endif
+    return kHostName;
+}
+
+bool RemotePlugin::Start(const std::string& hostPath, const std::string& hostConfig, std::string& errorMessage) {
+    if (!memory.Create(EventBridge::RegionSize(), errorMessage)) {
+        return false;
+    }
+    in = std::make_unique<SharedRing>(EventBridge::ToParent(memory.Data(), true));
+    out = std::make_unique<SharedRing>(EventBridge::ToChild(memory.Data(), true));
+    // publish= is enforced here as well, the child may not be running the host it claims to
+    bridge = std::make_shared<EventBridge>(eventService, logger, &logger->Category("EventBridge"), *out, true, manifest.publishPatterns);
+
+    // Above the standard descriptors, so the dup2() in the child always clears close-on-exec
+    int childFd = ::fcntl(memory.Fd(), F_DUPFD_CLOEXEC, 10);
+    if (childFd < 0) {
+        errorMessage = std::string("cannot pass the shared memory: ") + std::strerror(errno);
+        return false;
+    }
+    std::vector<std::string> args = {hostPath, "--library", libraryPath, "--fd", std::to_string(kChildFd)};
+    if (!hostConfig.empty()) {
+        args.push_back("--config");
+        args.push_back(hostConfig);
+    }
+    std::vector<char*> argv;
+    for (auto& arg : args) {
+        argv.push_back(&arg[0]);
+    }
+    argv.push_back(nullptr);
+
+    posix_spawn_file_actions_t actions;
+    ::posix_spawn_file_actions_init(&actions);
+    ::posix_spawn_file_actions_adddup2(&actions, childFd, kChildFd);
+    int result = hostPath.find('/') == std::string::npos
+                     ? ::posix_spawnp(&child, hostPath.c_str(), &actions, nullptr, argv.data(), environ)
+                     : ::posix_spawn(&child, hostPath.c_str(), &actions, nullptr, argv.data(), environ);
+    ::posix_spawn_file_actions_destroy(&actions);
+    ::close(childFd);
+    if (result != 0) {
+        child = -1;
+        errorMessage = "cannot start " + hostPath + ": " + std::strerror(result);
+        return false;
+    }
+    readerThread = PolicyThread(PolicyThread::Named(ThreadPolicy(), "apx-remote"), [this] { ReadLoop(); });
+
+    std::unique_lock<std::mutex> lock(controlMutex);
+    controlCondition.wait_for(lock, kStartTimeout, [this] { return described || !startError.empty() || exited; });
+    if (described) {
+        APX_LOG_INFO(logger, logCategory) << "[RemotePlugin] Plugin " << description.name << " runs in process " << child << std::endl;
+        return true;
+    }
+    errorMessage = !startError.empty() ? startError
+                   : exited           ? "plugin process " + exitReason
+                                      : "plugin process did not answer within " + std::to_string(kStartTimeout.count()) + " s";
+    lock.unlock();
+    Kill();
+    return false;
+}
+
+void RemotePlugin::Init() {
+    Plugin::Init();
+    std::lock_guard<std::mutex> lock(callMutex);
+    std::string error = Call(EventBridge::Init);
+    if (!error.empty()) {
+        throw std::runtime_error(error);
+    }
+
+    // Straight from the dispatcher into the ring, no mailbox in between
+    auto forward = bridge;
+    for (const auto& name : manifest.subscribeTopics) {
+        IEventService::TopicId topic = eventService->RegisterTopic(name);
+        forwarders.push_back(eventService->SubscribePayload(topic, [forward, topic](const EventPayload& payload) {
+            forward->Publish(topic, payload);
+        }));
+    }
+}
+
+void RemotePlugin::Run() {
+    std::lock_guard<std::mutex> lock(callMutex);
+    std::string error = Call(EventBridge::Run);
+    if (!error.empty()) {
+        throw std::runtime_error(error);
+    }
+}
+
+void RemotePlugin::Destroy() {
+    std::lock_guard<std::mutex> lock(callMutex);
+    if (destroyed) {
+        return;
+    }
+    destroyed = true;
+    for (auto subscription : forwarders) {
+        eventService->Unsubscribe(subscription);
+    }
+    forwarders.clear();
+    Plugin::Destroy();  // Update() ticks still in the mailbox go out first
+    if (child < 0) {
+        return;  // Never started
+    }
+
+    bool running;
+    {
+        std::lock_guard<std::mutex> controlLock(controlMutex);
+        stopping = true;
+        running = !exited;
+    }
+    if (!running) {
+        Kill();  // Crashed or failed to start, that was reported already
+        return;
+    }
+    std::string error = Call(EventBridge::Destroy, std::string(), stopTimeout);
+    if (!error.empty()) {
+        APX_LOG_WARNING(logger, logCategory) << "[RemotePlugin] Destroy() of plugin " << GetName() << ": " << error << std::endl;
+    }
+    bridge->Close();
+    out->Close();  // The child leaves its loop and exits
+
+    bool ended;
+    {
+        std::unique_lock<std::mutex> controlLock(controlMutex);
+        auto done = [this] { return exited; };
+        if (stopTimeout.count() == 0) {
+            controlCondition.wait(controlLock, done);
+        }
+        ended = controlCondition.wait_for(controlLock, stopTimeout, done);
+    }
+    if (!ended) {
+        APX_LOG_WARNING(logger, logCategory) << "[RemotePlugin] Plugin process " << child << " did not exit within "
+                                             << stopTimeout.count() << " ms, killing it" << std::endl;
+    }
+    Kill();
+    if (bridge->Dropped() != 0) {
+        APX_LOG_INFO(logger, logCategory) << "[RemotePlugin] " << bridge->Dropped() << " events for plugin " << GetName() << " were dropped" << std::endl;
+    }
+}
+
+void RemotePlugin::Update(std::chrono::nanoseconds deltaTime) {
+    SharedRing::Message message;
+    message.type = EventBridge::Update;
+    message.value = static_cast<uint64_t>(deltaTime.count());
+    bridge->Send(message, std::chrono::milliseconds(0));  // Not waited for; a full ring skips the frame
+}
+
+bool RemotePlugin::WantsUpdate() const {
+    std::lock_guard<std::mutex> lock(controlMutex);
+    return description.wantsUpdate;
+}
+
+std::string RemotePlugin::GetName() const {
+    std::lock_guard<std::mutex> lock(controlMutex);
+    return description.name;
+}
+
+std::thread::id RemotePlugin::GetThreadId() const {
+    return std::thread::id();  // Its threads are in another process
+}
+
+std::vector<std::string> RemotePlugin::GetDependencies() const {
+    std::lock_guard<std::mutex> lock(controlMutex);
+    return description.dependencies;
+}
+
+std::vector<std::string> RemotePlugin::GetProvides() const {
+    std::lock_guard<std::mutex> lock(controlMutex);
+    return description.provides;
+}
+
+std::vector<std::string> RemotePlugin::GetRequires() const {
+    std::lock_guard<std::mutex> lock(controlMutex);
+    return description.required;
+}
+
+std::string RemotePlugin::SerializeState() const {
+    std::lock_guard<std::mutex> lock(controlMutex);
+    return childState;
+}
+
+void RemotePlugin::RestoreState(const std::string& state) {
+    // Answered before Init(), like in process, so no event reaches the plugin without its state
+    std::lock_guard<std::mutex> lock(callMutex);
+    std::string error = Call(EventBridge::State, state);
+    if (!error.empty()) {
+        throw std::runtime_error(error);
+    }
+}
+
+PluginActivity RemotePlugin::GetActivity() const {
+    std::lock_guard<std::mutex> lock(controlMutex);
+    PluginActivity activity = childActivity;
+    // The older of the plugin's own heartbeat and the host's, so a dead child goes silent too
+    activity.lastHeartbeat = activity.lastHeartbeat != 0 ? std::min(activity.lastHeartbeat, lastMessage) : lastMessage;
+    return activity;
+}
+
+std::string RemotePlugin::Call(uint16_t type, const std::string& data, std::chrono::milliseconds timeout) {
+    {
+        std::lock_guard<std::mutex> lock(controlMutex);
+        if (exited) {
+            return "plugin process " + exitReason;
+        }
+        replied = false;
+    }
+    SharedRing::Message message;
+    message.type = type;
+    message.data = data.data();
+    message.size = data.size();
+    if (!bridge->Send(message)) {
+        return "plugin process does not take " + std::to_string(data.size()) + " bytes";
+    }
+
+    std::unique_lock<std::mutex> lock(controlMutex);
+    auto answered = [this] { return replied || exited; };
+    if (timeout.count() == 0) {
+        controlCondition.wait(lock, answered);
+    } else if (!controlCondition.wait_for(lock, timeout, answered)) {
+        return "no answer within " + std::to_string(timeout.count()) + " ms";
+    }
+    return replied ? reply : "plugin process " + exitReason;
+}
+
+void RemotePlugin::ReadLoop() {
+    for (;;) {
+        bool readable = in->WaitReadable(kPollInterval);
+        SharedRing::Message message;
+        while (!corruptionHandled && in->TryRead(message)) {
+            Handle(message);
+            in->Release();
+            if (!bridge->Violation().empty()) {
+                break;
+            }
+        }
+        if ((in->Corrupt() || !bridge->Violation().empty()) && !corruptionHandled) {
+            // Handled as a crash: nothing more is read from the child, it is killed and reaped below
+            corruptionHandled = true;
+            killReason = in->Corrupt() ? "wrote a malformed message" : bridge->Violation();
+            APX_LOG_ERROR(logger, logCategory) << "[RemotePlugin] Plugin process " << child << " " << killReason << ", killing it" << std::endl;
+            {
+                std::lock_guard<std::mutex> lock(controlMutex);
+                if (!exited) {
+                    ::kill(child, SIGKILL);
+                }
+            }
+            in->Close();
+        }
+
+        // Closed by the child on its way out, by Kill() or as corrupt; either way it is about to be reaped
+        bool closed = in->Closed();
+        if (readable && !closed) {
+            continue;
+        }
+        siginfo_t info{};
+        int result = ::waitid(P_PID, static_cast<id_t>(child), &info, WEXITED | WNOWAIT | (closed ? 0 : WNOHANG));
+        if (result != 0 && errno == EINTR) {
+            continue;
+        }
+        if (result == 0 && info.si_pid != child) {
+            continue;  // Still running
+        }
+
+        // Reaped under the lock, so Kill() never signals a process id that was handed out again
+        int status = -1;
+        {
+            std::lock_guard<std::mutex> lock(controlMutex);
+            if (result == 0) {
+                ::waitpid(child, &status, 0);
+            }
+            exited = true;
+            exitReason = DescribeExit(status) + (killReason.empty() ? "" : " after it " + killReason);
+        }
+        ChildExited(status);
+        return;
+    }
+}
+
+void RemotePlugin::Handle(const SharedRing::Message& message) {
+    if (bridge->Handle(message)) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(controlMutex);
+    switch (message.type) {
+        case EventBridge::Hello:
+            description = PluginHost::ParseDescription(std::string(message.data, message.size));
+            described = true;
+            break;
+        case EventBridge::Error:
+            startError = message.size != 0 ? std::string(message.data, message.size) : "plugin could not be loaded";
+            break;
+        case EventBridge::Done:
+            reply.assign(message.data, message.size);
+            replied = true;
+            break;
+        case EventBridge::State:
+            childState.assign(message.data, message.size);
+            return;
+        case EventBridge::Heartbeat:
+            if (message.size == sizeof(PluginActivity)) {
+                std::memcpy(&childActivity, message.data, sizeof(PluginActivity));
+            }
+            lastMessage = LatencyHistogram::Now();
+            return;
+        default:
+            return;
+    }
+    controlCondition.notify_all();
+}
+
+void RemotePlugin::ChildExited(int status) {
+    bool expected;
+    std::string name;
+    {
+        std::lock_guard<std::mutex> lock(controlMutex);
+        expected = stopping;
+        name = description.name;
+    }
+    controlCondition.notify_all();
+    bridge->Close();  // Nobody reads the ring anymore
+    if (expected) {
+        APX_LOG_DEBUG(logger, logCategory) << "[RemotePlugin] Plugin process " << child << " " << DescribeExit(status) << std::endl;
+    } else {
+        APX_LOG_ERROR(logger, logCategory) << "[RemotePlugin] Plugin process of " << (name.empty() ? libraryPath : name) << " " << DescribeExit(status)
+                                           << "; its events are dropped until the plugin is reloaded" << std::endl;
+    }
+}
+
+void RemotePlugin::Kill() {
+    {
+        std::lock_guard<std::mutex> lock(controlMutex);
+        stopping = true;
+        if (!exited && child > 0) {
+            ::kill(child, SIGKILL);
+        }
+    }
+    if (in) {
+        in->Close();  // Wakes the reader, which reaps the child
+    }
+    readerThread.Join();
+}
@@ -0,0 +1,110 @@
+#ifndef REMOTEPLUGIN_H
+#define REMOTEPLUGIN_H
+
+#include "Plugin.h"
+#include "PluginHost.h"
+#include "PluginLoader.h"
+#include "ipc/EventBridge.h"
+#include "ipc/SharedMemory.h"
+#include "ipc/SharedRing.h"
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+/**
+ * @class RemotePlugin
+ * @brief Stands in for a plugin that runs in a child process, see PluginHost.
+ * @details Loaded for libraries whose manifest says process=isolated. The child gets the library
+ * path and a shared memory region with two SharedRings; events of the manifest's subscribe= topics
+ * are copied into one, the plugin's own events come back through the other and are triggered here.
+ * Init(), Run() and Destroy() are forwarded and wait for the child's answer. A crash of the child
+ * only ends the child: it is logged, its heartbeats stop, and ReloadPlugin() starts a new one.
+ */
+class RemotePlugin : public Plugin {
+public:
+    /**
+     * @param stopTimeout How long Destroy() waits for the child before killing it.
+     */
+    RemotePlugin(IEventService* eventService, ILoggerService* logger, IExecutorService* executor,
+                 const std::string& libraryPath, const PluginManifest& manifest, std::chrono::milliseconds stopTimeout);
+    ~RemotePlugin() override;
+
+    /**
+     * @brief Starts the host process and waits until it has loaded the plugin.
+     * @param hostPath The host executable; without a '/' it is looked up in PATH.
+     * @param hostConfig Config file for the host, empty for none.
+     * @return false with errorMessage set if the child could not be started or the plugin not loaded.
+     */
+    bool Start(const std::string& hostPath, const std::string& hostConfig, std::string& errorMessage);
+
+    void Init() override;
+    void Run() override;
+    void Destroy() override;
+    void Update(std::chrono::nanoseconds deltaTime) override;
+    bool WantsUpdate() const override;
+
+    std::string GetName() const override;
+    std::thread::id GetThreadId() const override;
+    std::vector<std::string> GetDependencies() const override;
+    std::vector<std::string> GetProvides() const override;
+    std::vector<std::string> GetRequires() const override;
+
+    // The child's state is taken while it is destroyed, so this works after Destroy() as usual
+    std::string SerializeState() const override;
+    void RestoreState(const std::string& state) override;
+
+    // The child's activity; heartbeats stop with the child
+    PluginActivity GetActivity() const override;
+
+    // apertus_plugin_host next to the running executable, or from PATH if there is none
+    static std::string DefaultHostPath();
+
+    static constexpr std::chrono::seconds kStartTimeout{5};
+    static constexpr std::chrono::milliseconds kPollInterval{100};
+
+private:
+    // Sends a control message and waits for Done; returns the error, empty on success. 0 waits for good.
+    std::string Call(uint16_t type, const std::string& data = std::string(), std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+    void ReadLoop();
+    void Handle(const SharedRing::Message& message);
+    void ChildExited(int status);
+    void Kill();
+
+    const std::string libraryPath;
+    const PluginManifest manifest;
+    const std::chrono::milliseconds stopTimeout;
+
+    SharedMemory memory;
+    std::unique_ptr<SharedRing> in;   // From the child, read by readerThread only
+    std::unique_ptr<SharedRing> out;  // To the child, written through bridge
+    std::shared_ptr<EventBridge> bridge;
+    PolicyThread readerThread;
+    bool corruptionHandled = false;  // Reader thread only, see SharedRing::Corrupt() and EventBridge::Violation()
+    std::string killReason;          // Reader thread only, why corruptionHandled killed the child
+    pid_t child = -1;
+    std::vector<IEventService::SubscriptionId> forwarders;
+
+    // Guards everything below, controlCondition signals changes
+    mutable std::mutex controlMutex;
+    std::condition_variable controlCondition;
+    PluginHost::Description description;
+    bool described = false;
+    std::string startError;
+    bool replied = false;
+    std::string reply;
+    std::string childState;
+    bool exited = false;
+    std::string exitReason;
+    bool stopping = false;  // Destroy() called; the child ending is expected from then on
+    PluginActivity childActivity;
+    uint64_t lastMessage = 0;  // When the last heartbeat arrived
+
+    std::mutex callMutex;  // One Init(), Run() or Destroy() at a time
+    bool destroyed = false;  // Guarded by callMutex
+};
+
+#endif // REMOTEPLUGIN_H
@@ -0,0 +1,65 @@
+#include "di/DependencyInjection.h"
+#include "plugin/PluginHost.h"
+#include "interfaces/IEventService.h"
+#include "interfaces/IExecutorService.h"
+
+// std
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#if defined(__linux__)
+#include <csignal>
+#include <sys/prctl.h>
+#endif
+
+// 3rd party
+#include <fruit/fruit.h>
+
+// Started by RemotePlugin for plugins whose manifest says process=isolated:
+// apertus_plugin_host --library <path> --fd <shared memory descriptor> [--config <file>]
+int main(int argc, char** argv) {
+#if defined(__linux__)
+    // Never outlive the node; the plugin would keep running with nobody to talk to
+    ::prctl(PR_SET_PDEATHSIG, SIGKILL);
+#endif
+
+    std::string libraryPath;
+    std::string configPath;
+    int fd = -1;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--library" && i + 1 < argc) {
+            libraryPath = argv[++i];
+        } else if (arg == "--fd" && i + 1 < argc) {
+            fd = std::atoi(argv[++i]);
+        } else if (arg == "--config" && i + 1 < argc) {
+            configPath = argv[++i];
+        }
+    }
+    if (libraryPath.empty() || fd < 0) {
+        std::cerr << "Usage: " << argv[0] << " --library <path> --fd <descriptor> [--config <file>]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    fruit::Injector<IEventService, ILoggerService, IConfigService, IPluginService, IExecutorService> injector(getApertusComponent);
+    auto configService = injector.get<IConfigService*>();
+    if (!configPath.empty()) {
+        configService->LoadConfig(configPath);
+    }
+    auto eventService = injector.get<IEventService*>();
+    auto loggerService = injector.get<ILoggerService*>();
+    auto executorService = injector.get<IExecutorService*>();
+    eventService->Start();
+
+    int result;
+    {
+        PluginHost host(eventService, loggerService, executorService);
+        result = host.Run(libraryPath, fd);
+    }
+
+    eventService->Stop();
+    executorService->Stop();
+    loggerService->Flush();
+    return result;
+}
@@ -1,124 +1,282 @@
 #include "di/DependencyInjection.h"
+#include "logger/FileSink.h"
 #include "interfaces/IEventService.h"
 #include "interfaces/IPluginService.h"
 #include "interfaces/IPlugin.h"
+#include "interfaces/IExecutorService.h"
 
 // std
 #include <atomic>
+#include <cerrno>
 #include <csignal>
+#include <cstdlib>
+#include <iostream>
 #include <mutex>
 #include <condition_variable>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
 
 // plugins
 #include "myplugin/MyPlugin.h"
-#include "gstreamer/GStreamerPlugin.h"
 
 // 3rd party
 #include <fruit/fruit.h>
 
 std::atomic<bool> isRunning(true);
+std::atomic<bool> reloadRequested(false);
 std::mutex shutdownMutex;
 std::condition_variable shutdownCondition;
 
+// The handler only writes the signal number here, write() is async-signal-safe. SignalLoop() reads it
+// on a thread of its own, where printing, locking and notifying are safe.
+int signalPipe[2] = {-1, -1};
+
 void SignalHandler(int signal) {
-    std::cout << "[Main] Signal " << signal << " received! Stopping..." << std::endl;
-    {
-        std::lock_guard<std::mutex> lock(shutdownMutex);
-        isRunning = false;
+    int savedErrno = errno;
+    unsigned char number = static_cast<unsigned char>(signal);
+    ssize_t written = ::write(signalPipe[1], &number, 1);  // Non-blocking; if the pipe is full, the signal is pending already
+    (void)written;
+    errno = savedErrno;
+}
+
+void SignalLoop() {
+    for (;;) {
+        unsigned char signal = 0;
+        ssize_t result = ::read(signalPipe[0], &signal, 1);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result != 1) {
+            return;
+        }
+#ifdef SIGHUP
+        if (signal == SIGHUP) {
+            std::cout << "[Main] Signal " << static_cast<int>(signal) << " received! Reloading plugins..." << std::endl;
+            {
+                std::lock_guard<std::mutex> lock(shutdownMutex);
+                reloadRequested = true;
+            }
+            shutdownCondition.notify_one();
+            continue;
+        }
+#endif
+        std::cout << "[Main] Signal " << static_cast<int>(signal) << " received! Stopping..." << std::endl;
+        {
+            std::lock_guard<std::mutex> lock(shutdownMutex);
+            isRunning = false;
+        }
+        shutdownCondition.notify_one();
     }
-    shutdownCondition.notify_one();
-    // shutdownCondition.notify_all();
 }
 
-int main() {
-    std::signal(SIGINT, SignalHandler);
-    std::signal(SIGTERM, SignalHandler);
+int main(int argc, char** argv) {
+    if (::pipe(signalPipe) == 0) {
+        for (int fd : signalPipe) {
+            ::fcntl(fd, F_SETFD, FD_CLOEXEC);  // Not for the isolated plugin processes
+        }
+        ::fcntl(signalPipe[1], F_SETFL, ::fcntl(signalPipe[1], F_GETFL) | O_NONBLOCK);
+        std::thread(SignalLoop).detach();
+        std::signal(SIGINT, SignalHandler);
+        std::signal(SIGTERM, SignalHandler);
+#ifdef SIGHUP
+        std::signal(SIGHUP, SignalHandler);
+#endif
+    } else {
+        std::cerr << "[Main] Cannot create the signal pipe, signals stop the process without cleanup" << std::endl;
+    }
+
+    // --record <file>: journal every event; --replay <file> [--fast]: trigger a recorded session again
+    // --log-level <level> or --log-level <component>=<level>, repeatable; --log-file <file>: also log to a rotated file
+    // --plugin-dir <dir>: where shared-library plugins are loaded from; --config <file>: key = value settings
+    std::string configPath;
+    std::string recordPath;
+    std::string pluginDir = "plugins";
+    std::string logPath;
+    std::string replayPath;
+    bool replayFast = false;
+    std::vector<std::string> logLevels;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--record" && i + 1 < argc) {
+            recordPath = argv[++i];
+        } else if (arg == "--replay" && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else if (arg == "--config" && i + 1 < argc) {
+            configPath = argv[++i];
+        } else if (arg == "--plugin-dir" && i + 1 < argc) {
+            pluginDir = argv[++i];
+        } else if (arg == "--fast") {
+            replayFast = true;
+        } else if (arg == "--log-level" && i + 1 < argc) {
+            logLevels.push_back(argv[++i]);
+        } else if (arg == "--log-file" && i + 1 < argc) {
+            logPath = argv[++i];
+        }
+    }
     
     // initialize DI container
-    fruit::Injector<IEventService, ILoggerService, IConfigService, IPluginService> injector(getApertusComponent);
+    fruit::Injector<IEventService, ILoggerService, IConfigService, IPluginService, IExecutorService> injector(getApertusComponent);
+
+    // Services are created on first use; the config comes first, their thread policies are read from it
+    auto configService = injector.get<IConfigService*>();
+    if (!configPath.empty()) {
+        configService->LoadConfig(configPath);
+    }
 
     // load services from DI container
     auto eventService = injector.get<IEventService*>();
     auto pluginService = injector.get<IPluginService*>();
     auto loggerService = injector.get<ILoggerService*>();
+    auto executorService = injector.get<IExecutorService*>();
+
+    for (const auto& setting : logLevels) {
+        size_t separator = setting.find('=');
+        LogLevel level;
+        if (!ParseLogLevel(separator == std::string::npos ? setting : setting.substr(separator + 1), level)) {
+            std::cerr << "[Main] Unknown log level: " << setting << std::endl;
+        } else if (separator == std::string::npos) {
+            loggerService->SetLevel(level);
+        } else {
+            loggerService->SetLevel(setting.substr(0, separator), level);
+        }
+    }
+    if (!logPath.empty()) {
+        auto fileSink = std::make_shared<FileSink>(logPath);
+        std::string errorMessage;
+        if (fileSink->Open(errorMessage)) {
+            loggerService->AddSink(fileSink);
+        } else {
+            std::cerr << "[Main] Cannot log to file: " << errorMessage << std::endl;
+        }
+    }
 
     // Start event processing
     eventService->Start();
+    if (!recordPath.empty()) {
+        eventService->StartRecording(recordPath);
+    }
 
     // subscribe to events
     {
-        eventService->Subscribe("PlaybackStarted", [](const std::string& message) {
+        eventService->Subscribe("playback/started", [](const std::string& message) {
             std::cout << "[Event] Playback started: " << message << std::endl;
         });
 
-        eventService->Subscribe("PlaybackStopped", [](const std::string& message) {
+        eventService->Subscribe("playback/stopped", [](const std::string& message) {
             std::cout << "[Event] Playback stopped: " << message << std::endl;
         });
 
-        eventService->Subscribe("PlaybackFinished", [](const std::string& message) {
+        eventService->Subscribe("playback/finished", [](const std::string& message) {
             std::cout << "[Event] Playback finished: " << message << std::endl;
         });
 
-        eventService->Subscribe("PlaybackError", [](const std::string& error) {
+        eventService->Subscribe("playback/error", [](const std::string& error) {
             std::cerr << "[Event] Playback error: " << error << std::endl;
         });
 
-        eventService->Subscribe("PlaybackStateChanged", [](const std::string& stateChange) {
+        auto stateChangedTopic = eventService->RegisterTopic("playback/state");
+        eventService->SetTopicPolicy(stateChangedTopic, DeliveryPolicy::CoalesceLatest);
+        eventService->Subscribe(stateChangedTopic, [](const std::string& stateChange) {
             std::cout << "[Event] Playback state change:" << stateChange << std::endl;
         });
 
-        eventService->Subscribe("OnUpdate", [](const std::string&) {
+        // Traces every playback event, including ones added later
+        eventService->SubscribePattern("playback/#", [eventService](IEventService::TopicId topic, const EventPayload&) {
+            std::cout << "[Event] Playback event traced: " << eventService->GetTopicName(topic) << std::endl;
+        });
+
+        auto positionTopic = eventService->RegisterTopic("playback/position");
+        eventService->Subscribe("OnUpdate", [eventService, positionTopic](const std::string&) {
             std::cout << "[Event] OnUpdate event catched!" << std::endl;
+            eventService->Request(positionTopic, EventPayload(), [](RequestStatus status, const EventPayload& response) {
+                const int64_t* position = response.Get<int64_t>();
+                if (status == RequestStatus::Ok && position != nullptr && *position >= 0) {
+                    std::cout << "[Event] Playback position: " << *position / 1000000 << " ms" << std::endl;
+                }
+            }, std::chrono::milliseconds(500));
         });
     }
 
     (*loggerService) << "[Main] Apertus started!" << std::endl;
 
     // register and start plugins
-    auto myPlugin = std::make_shared<MyPlugin>(eventService, loggerService);
+    auto myPlugin = std::make_shared<MyPlugin>(eventService, loggerService, executorService);
     pluginService->RegisterPlugin(myPlugin);
 
-    auto gstreamerPlugin = std::make_shared<GStreamerPlugin>(eventService, loggerService);
-    pluginService->RegisterPlugin(gstreamerPlugin);
+    // GStreamerPlugin is a shared library, loaded on the first PlayAudio
+    pluginService->LoadPlugins(pluginDir);
 
     // initialize and start plugins
     pluginService->InitPlugins();
 
     (*loggerService) << "[Main] Plugins initialized and started." << std::endl;
 
-    // trigger start event
-    eventService->Trigger("OnStart");
-    eventService->Trigger("PlayAudio", "file:///Users/aklen/Music/Ableton/Projects/647 Project/export/647.mp3");
-
-    std::this_thread::sleep_for(std::chrono::seconds(3));
-    eventService->Trigger("PauseAudio");
+    if (!replayPath.empty()) {
+        // Trigger the recorded session instead of the scripted one
+        eventService->Replay(replayPath, !replayFast);
+    } else {
+        // trigger start event
+        eventService->Trigger("OnStart");
+        eventService->Trigger("PlayAudio", "file:///Users/aklen/Music/Ableton/Projects/647 Project/export/647.mp3");
 
-    std::this_thread::sleep_for(std::chrono::seconds(3));
-    eventService->Trigger("ResumeAudio");
+        // Schedule the rest from one base time, so the commands keep their spacing exactly
+        auto start = std::chrono::steady_clock::now();
+        eventService->TriggerAt(start + std::chrono::seconds(3), eventService->RegisterTopic("PauseAudio"));
+        eventService->TriggerAt(start + std::chrono::seconds(6), eventService->RegisterTopic("ResumeAudio"));
+        eventService->TriggerAt(start + std::chrono::seconds(9), eventService->RegisterTopic("StopAudio"));
+    }
 
-    std::this_thread::sleep_for(std::chrono::seconds(3));
-    eventService->Trigger("StopAudio");
+    auto customEventTopic = eventService->RegisterTopic("CustomEvent");
+    eventService->SetTopicPriority(customEventTopic, EventPriority::Bulk);
+    if (replayPath.empty()) {
+        eventService->TriggerEvery(std::chrono::seconds(1), customEventTopic);
+    }
 
-    // Wait for termination signal using condition_variable
-    while (isRunning) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(1000));
-        (*loggerService) << "[Main] Running..." << std::endl;
-        eventService->Trigger("CustomEvent");
+    // Wait for termination signal using condition_variable; SIGHUP swaps the shared-library plugins
+    // for the versions now on disk without a restart
+    {
+        (*loggerService) << "[Main] Running, waiting for shutdown signal..." << std::endl;
+        std::unique_lock<std::mutex> lock(shutdownMutex);
+        for (;;) {
+            shutdownCondition.wait(lock, [] { return !isRunning || reloadRequested; });
+            if (!isRunning) {
+                break;
+            }
+            reloadRequested = false;
+            lock.unlock();
+            for (const auto& plugin : pluginService->GetStartupReport()) {
+                if (!plugin.library.empty()) {
+                    pluginService->ReloadPlugin(plugin.name);
+                }
+            }
+            lock.lock();
+        }
     }
-    // {
-    //     std::cout << "[Main] Waiting for shutdown signal..." << std::endl;
-    //     std::unique_lock<std::mutex> lock(shutdownMutex);
-    //     shutdownCondition.wait(lock, [] { return !isRunning; });
-    // }
 
     (*loggerService) << "[Main] Stopping plugins in correct order..." << std::endl;
 
     pluginService->StopPlugins();
 
+    // A plugin that did not stop still runs on our workers; joining them would hang as well
+    for (const auto& health : pluginService->GetPluginHealth()) {
+        if (health.state == PluginHealthState::Abandoned) {
+            (*loggerService) << "[Main] Plugin " << health.name << " did not stop, exiting without further cleanup." << std::endl;
+            loggerService->Flush();
+            std::_Exit(EXIT_FAILURE);
+        }
+    }
+
     (*loggerService) << "[Main] Stopping EventService..." << std::endl;
     eventService->Stop();  // Stop the event loop
+    eventService->StopRecording();
     (*loggerService) << "[Main] EventService stopped." << std::endl;
 
+    (*loggerService) << "[Main] Stopping ExecutorService..." << std::endl;
+    executorService->Stop();
+
     (*loggerService) << "[Main] Destroying PluginService..." << std::endl;
     pluginService = nullptr;
 
@@ -1,16 +1,22 @@
 #include "GStreamerPlugin.h"
+#include <chrono>
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <regex>
 #include <iomanip>
 #include <gst/gst.h>
 #include <curl/curl.h>
 #include "UrlUtils.h"
+#include "interfaces/PluginApi.h"
 
-GStreamerPlugin::GStreamerPlugin(IEventService* eventService, ILoggerService* logger) 
-    : Plugin(eventService, logger), pipeline(nullptr), gStreamerIsRunning(false) {
-    gst_init(nullptr, nullptr);
-}
+APERTUS_PLUGIN(GStreamerPlugin, "GStreamerPlugin")
+
+GStreamerPlugin::GStreamerPlugin(IEventService* eventService, ILoggerService* logger, IExecutorService* executor) 
+    : Plugin(eventService, logger, executor), pipeline(nullptr), gStreamerIsRunning(false),
+      playbackStartedTopic(eventService->RegisterTopic("playback/started")),
+      playbackStoppedTopic(eventService->RegisterTopic("playback/stopped")),
+      playbackPositionTopic(eventService->RegisterTopic("playback/position")) {}
 
 std::string GStreamerPlugin::GetName() const {
     return "GStreamerPlugin";
@@ -20,143 +26,236 @@ std::thread::id GStreamerPlugin::GetThreadId() const {
     return std::this_thread::get_id();
 }
 
+std::vector<std::string> GStreamerPlugin::GetProvides() const {
+    return {"audio/playback"};
+}
+
+std::string GStreamerPlugin::SerializeState() const {
+    return handoverState;
+}
+
+void GStreamerPlugin::RestoreState(const std::string& state) {
+    // uri, position in nanoseconds and paused flag, one per line
+    std::istringstream lines(state);
+    std::string uri;
+    gint64 position = 0;
+    bool wasPaused = false;
+    if (std::getline(lines, uri) && lines >> position >> wasPaused) {
+        APX_LOG_INFO(logger, logCategory) << "[GStreamerPlugin]::RestoreState() Continuing " << uri << " at "
+                                          << position / GST_MSECOND << " ms" << (wasPaused ? ", paused" : "") << std::endl;
+        // Called before Init(), which starts the playback
+        restoredUri = uri;
+        restoredPosition = position;
+        restoredPaused = wasPaused;
+    }
+}
+
 void GStreamerPlugin::Init() {
     Plugin::Init();  // call base class method to start event listener thread
-    (*logger) << "[GStreamerPlugin]::Init() Initialized." << std::endl;
+
+    // Loads the GStreamer registry, by far the slowest part of startup; here it runs in parallel
+    // with the Init() of other plugins and shows up in the startup report
+    auto gstStart = std::chrono::steady_clock::now();
+    gst_init(nullptr, nullptr);
+    APX_LOG_DEBUG(logger, logCategory) << "[GStreamerPlugin]::Init() gst_init took "
+                                       << std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - gstStart).count() / 1000.0
+                                       << " ms" << std::endl;
+    APX_LOG_INFO(logger, logCategory) << "[GStreamerPlugin]::Init() Initialized." << std::endl;
+
+    // Ahead of the first subscription, so playback commands act on the restored playback
+    if (!restoredUri.empty()) {
+        post([this, uri = restoredUri, position = restoredPosition, wasPaused = restoredPaused] { Play(uri, position, wasPaused); });
+        restoredUri.clear();
+    }
+
+    // Playback control must never wait behind telemetry
+    for (const char* control : {"PlayAudio", "PauseAudio", "ResumeAudio", "StopAudio"}) {
+        eventService->SetTopicPriority(eventService->RegisterTopic(control), EventPriority::Control);
+    }
 
     subscribe("PlayAudio", [this](const std::string& uri) {
-        (*this->logger) << "[GStreamerPlugin]::Init() PlayAudio event received: " << uri << std::endl;
+        APX_LOG_DEBUG(this->logger, this->logCategory) << "[GStreamerPlugin]::Init() PlayAudio event received: " << uri << std::endl;
         this->Play(uri);
     });
 
     subscribe("PauseAudio", [this](const std::string&) {
-        (*this->logger) << "[GStreamerPlugin]::Init() PauseAudio event received." << std::endl;
+        APX_LOG_DEBUG(this->logger, this->logCategory) << "[GStreamerPlugin]::Init() PauseAudio event received." << std::endl;
         this->Pause();
     });
 
     subscribe("ResumeAudio", [this](const std::string&) {
-        (*this->logger) << "[GStreamerPlugin]::Init() ResumeAudio event received." << std::endl;
+        APX_LOG_DEBUG(this->logger, this->logCategory) << "[GStreamerPlugin]::Init() ResumeAudio event received." << std::endl;
         this->Resume();
     });
 
     subscribe("StopAudio", [this](const std::string&) {
-        (*this->logger) << "[GStreamerPlugin]::Init() StopAudio event received." << std::endl;
+        APX_LOG_DEBUG(this->logger, this->logCategory) << "[GStreamerPlugin]::Init() StopAudio event received." << std::endl;
         this->Stop();
     });
+
+    // Request: answers with the position in nanoseconds as int64_t, -1 when nothing is playing
+    subscribePayload(playbackPositionTopic, [this](const EventPayload& request) {
+        gint64 position = -1;
+        if (!pipeline || !gStreamerIsRunning || !gst_element_query_position(pipeline, GST_FORMAT_TIME, &position)) {
+            position = -1;
+        }
+        eventService->Respond(request, EventPayload(std::make_shared<const int64_t>(position)));
+    });
 }
 
 void GStreamerPlugin::Run() {
-    (*logger) << "[GStreamerPlugin]::Run() Running on thread ID: " << GetThreadId() << std::endl;
+    APX_LOG_INFO(logger, logCategory) << "[GStreamerPlugin]::Run() Running on thread ID: " << GetThreadId() << std::endl;
     // while (running)
 	// {
 	// 	std::this_thread::sleep_for(std::chrono::milliseconds(20));
 	// }
 }
 
-void GStreamerPlugin::Play(const std::string& uri) {
+void GStreamerPlugin::Play(const std::string& uri, gint64 startPosition, bool startPaused) {
     std::string cleanedUri = UrlUtils::ToFileUri(uri);
     if (cleanedUri.empty()) {
-        (*logger) << "[GStreamerPlugin]::Play() Invalid file path: " << cleanedUri << std::endl;
+        APX_LOG_ERROR(logger, logCategory) << "[GStreamerPlugin]::Play() Invalid file path: " << cleanedUri << std::endl;
         return;
     }
 
-    (*logger) << "[GStreamerPlugin]::Play() Original URI: " << uri << std::endl;
-    (*logger) << "[GStreamerPlugin]::Play() Cleaned URI: " << cleanedUri << std::endl;
+    APX_LOG_DEBUG(logger, logCategory) << "[GStreamerPlugin]::Play() Original URI: " << uri << std::endl;
+    APX_LOG_DEBUG(logger, logCategory) << "[GStreamerPlugin]::Play() Cleaned URI: " << cleanedUri << std::endl;
+
+    if (pipeline) {
+        Stop(true);  // Replaces the current playback, its pipeline and bus watch go first
+    }
 
     pipeline = gst_parse_launch(("playbin uri=" + cleanedUri).c_str(), nullptr);
     if (!pipeline) {
-        (*logger) << "[GStreamerPlugin]::Play() Failed to create pipeline!" << std::endl;
+        APX_LOG_ERROR(logger, logCategory) << "[GStreamerPlugin]::Play() Failed to create pipeline!" << std::endl;
         return;
     }
 
-    (*logger) << "[GStreamerPlugin]::Play() Setting up GStreamer bus..." << std::endl;
+    APX_LOG_DEBUG(logger, logCategory) << "[GStreamerPlugin]::Play() Setting up GStreamer bus..." << std::endl;
     GstBus* bus = gst_element_get_bus(pipeline);
     gst_bus_add_watch(bus, (GstBusFunc)OnBusMessage, this);
     gst_object_unref(bus);
-    (*logger) << "[GStreamerPlugin]::Play() Bus watch added." << std::endl;
-
-    // start playback in a separate thread
-    std::thread([this] {
-        (*logger) << "[GStreamerPlugin]::Play() Changing state to PLAYING..." << std::endl;
-        gst_element_set_state(pipeline, GST_STATE_PLAYING);
-        gStreamerIsRunning = true;
-
-        eventService->Trigger("PlaybackStarted", "Playback started");
-        (*logger) << "[GStreamerPlugin]::Play() Playback started." << std::endl;
+    APX_LOG_DEBUG(logger, logCategory) << "[GStreamerPlugin]::Play() Bus watch added." << std::endl;
+    currentUri = uri;
+    paused = startPaused;
+    gStreamerIsRunning = true;  // A Stop, Pause or Resume handled after this one applies to this pipeline
+
+    if (startPosition <= 0) {
+        // playbin changes state asynchronously, this returns at once
+        APX_LOG_DEBUG(logger, logCategory) << "[GStreamerPlugin]::Play() Changing state to " << (startPaused ? "PAUSED" : "PLAYING") << "..." << std::endl;
+        gst_element_set_state(pipeline, startPaused ? GST_STATE_PAUSED : GST_STATE_PLAYING);
+        eventService->TriggerSync(playbackStartedTopic, "Playback started");
+        APX_LOG_INFO(logger, logCategory) << "[GStreamerPlugin]::Play() Playback started." << std::endl;
+        return;
+    }
 
-        // gstThread = std::thread(&GStreamerPlugin::GStreamerMainLoop, this);
-        // (*logger) << "[GStreamerPlugin]::Play() GStreamer main loop thread started." << std::endl;
-    }).detach();
+    // Preroll paused, so the seek happens before anything is heard. Waiting for the preroll can take
+    // seconds: it runs on the executor with a reference of its own, the seek comes back through the
+    // mailbox and only applies if this pipeline is still the current one
+    gst_element_set_state(pipeline, GST_STATE_PAUSED);
+    std::shared_ptr<GstElement> prerolling(static_cast<GstElement*>(gst_object_ref(pipeline)), [](GstElement* element) {
+        gst_object_unref(element);
+    });
+    seekPending = true;
+    submit([this, prerolling, startPosition] {
+        gst_element_get_state(prerolling.get(), nullptr, nullptr, 5 * GST_SECOND);
+        post([this, prerolling, startPosition] {
+            if (pipeline != prerolling.get() || !gStreamerIsRunning) {
+                APX_LOG_DEBUG(logger, logCategory) << "[GStreamerPlugin]::Play() Stopped while prerolling, not seeking." << std::endl;
+                return;
+            }
+            seekPending = false;
+            gst_element_seek_simple(pipeline, GST_FORMAT_TIME, static_cast<GstSeekFlags>(GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_KEY_UNIT), startPosition);
+            // Pause() or Resume() may have been handled meanwhile, they only set the flag
+            APX_LOG_DEBUG(logger, logCategory) << "[GStreamerPlugin]::Play() Changing state to " << (paused ? "PAUSED" : "PLAYING") << "..." << std::endl;
+            gst_element_set_state(pipeline, paused ? GST_STATE_PAUSED : GST_STATE_PLAYING);
+            eventService->TriggerSync(playbackStartedTopic, "Playback started");
+            APX_LOG_INFO(logger, logCategory) << "[GStreamerPlugin]::Play() Playback started." << std::endl;
+        });
+    });
 }
 
 void GStreamerPlugin::Stop(bool force) {
     if (!gStreamerIsRunning && !force) {
-        (*logger) << "[GStreamerPlugin]::Stop() Stop called, but playback is already stopped." << std::endl;
+        APX_LOG_DEBUG(logger, logCategory) << "[GStreamerPlugin]::Stop() Stop called, but playback is already stopped." << std::endl;
         return;
     }
 
-    (*logger) << "[GStreamerPlugin]::Stop() Stopping playback..." << std::endl;
+    APX_LOG_INFO(logger, logCategory) << "[GStreamerPlugin]::Stop() Stopping playback..." << std::endl;
     gStreamerIsRunning = false; // Mark playback as stopped
+    currentUri.clear();
+    seekPending = false;
 
     if (pipeline) {
-        (*logger) << "[GStreamerPlugin]::Stop() Changing state to NULL..." << std::endl;
+        APX_LOG_DEBUG(logger, logCategory) << "[GStreamerPlugin]::Stop() Changing state to NULL..." << std::endl;
         gst_element_set_state(pipeline, GST_STATE_NULL); // Stop the pipeline
-        (*logger) << "[GStreamerPlugin]::Stop() Pipeline state changed to NULL." << std::endl;
+        APX_LOG_DEBUG(logger, logCategory) << "[GStreamerPlugin]::Stop() Pipeline state changed to NULL." << std::endl;
 
 
-        (*logger) << "[GStreamerPlugin]::Stop() Removing bus watch..." << std::endl;
+        APX_LOG_DEBUG(logger, logCategory) << "[GStreamerPlugin]::Stop() Removing bus watch..." << std::endl;
         GstBus* bus = gst_element_get_bus(pipeline);
         gst_bus_remove_watch(bus);
         gst_object_unref(bus);
-        (*logger) << "[GStreamerPlugin]::Stop() Bus watch removed." << std::endl;
+        APX_LOG_DEBUG(logger, logCategory) << "[GStreamerPlugin]::Stop() Bus watch removed." << std::endl;
 
         // Send a final message to the pipeline
         gst_element_post_message(pipeline, gst_message_new_application(GST_OBJECT(pipeline), gst_structure_new_empty("shutdown")));
 
-        (*logger) << "[GStreamerPlugin]::Stop() Unref'ing pipeline..." << std::endl;
+        APX_LOG_DEBUG(logger, logCategory) << "[GStreamerPlugin]::Stop() Unref'ing pipeline..." << std::endl;
         gst_object_unref(pipeline); // Unref the pipeline
         pipeline = nullptr; // Set the pipeline to null, prevent double-free
-        (*logger) << "[GStreamerPlugin]::Stop() Pipeline stopped and freed." << std::endl;
+        APX_LOG_INFO(logger, logCategory) << "[GStreamerPlugin]::Stop() Pipeline stopped and freed." << std::endl;
 
 
-        eventService->Trigger("PlaybackStopped", "Playback stopped");
+        eventService->TriggerSync(playbackStoppedTopic, "Playback stopped");
     }
 
-    (*logger) << "[GStreamerPlugin]::Stop() Checking if GStreamer thread should join..." << std::endl;
+    APX_LOG_DEBUG(logger, logCategory) << "[GStreamerPlugin]::Stop() Checking if GStreamer thread should join..." << std::endl;
     if (gstThread.joinable()) {
-        (*logger) << "[GStreamerPlugin]::Stop() Joining playback thread..." << std::endl;
+        APX_LOG_DEBUG(logger, logCategory) << "[GStreamerPlugin]::Stop() Joining playback thread..." << std::endl;
         gstThread.join();
-        (*logger) << "[GStreamerPlugin]::Stop() Playback thread joined." << std::endl;
+        APX_LOG_DEBUG(logger, logCategory) << "[GStreamerPlugin]::Stop() Playback thread joined." << std::endl;
     } else {
-        (*logger) << "[GStreamerPlugin]::Stop() No thread to join." << std::endl;
+        APX_LOG_DEBUG(logger, logCategory) << "[GStreamerPlugin]::Stop() No thread to join." << std::endl;
     }
-    (*logger) << "[GStreamerPlugin]::Stop() Playback stopped." << std::endl;
+    APX_LOG_INFO(logger, logCategory) << "[GStreamerPlugin]::Stop() Playback stopped." << std::endl;
 }
 
 void GStreamerPlugin::Destroy() {
-    (*logger) << "[GStreamerPlugin]::Destroy() Destroying..." << std::endl;
+    APX_LOG_INFO(logger, logCategory) << "[GStreamerPlugin]::Destroy() Destroying..." << std::endl;
+    Plugin::Destroy();  // Handles the playback commands still queued, so they come before Stop()
+
+    gint64 position = 0;
+    if (pipeline && gStreamerIsRunning && !currentUri.empty() && gst_element_query_position(pipeline, GST_FORMAT_TIME, &position)) {
+        handoverState = currentUri + "\n" + std::to_string(position) + "\n" + (paused ? "1" : "0");
+    }
     Stop(true);
-    Plugin::Destroy();
-    (*logger) << "[GStreamerPlugin]::Destroy() Destroyed." << std::endl;
+    APX_LOG_INFO(logger, logCategory) << "[GStreamerPlugin]::Destroy() Destroyed." << std::endl;
 }
 
 GStreamerPlugin::~GStreamerPlugin() {
-    (*logger) << "[GStreamerPlugin]::~GStreamerPlugin() Destructor called." << std::endl;
+    APX_LOG_DEBUG(logger, logCategory) << "[GStreamerPlugin]::~GStreamerPlugin() Destructor called." << std::endl;
     Destroy();
-    (*logger) << "[GStreamerPlugin]::~GStreamerPlugin() Destroyed." << std::endl;
+    APX_LOG_INFO(logger, logCategory) << "[GStreamerPlugin]::~GStreamerPlugin() Destroyed." << std::endl;
 }
 
 void GStreamerPlugin::Pause() {
     if (pipeline && gStreamerIsRunning) {
-        (*logger) << "[GStreamerPlugin]::Pause() Pausing playback..." << std::endl;
-        gst_element_set_state(pipeline, GST_STATE_PAUSED);
+        APX_LOG_INFO(logger, logCategory) << "[GStreamerPlugin]::Pause() Pausing playback..." << std::endl;
+        if (!seekPending) {
+            gst_element_set_state(pipeline, GST_STATE_PAUSED);
+        }
+        paused = true;
     }
 }
 
 void GStreamerPlugin::Resume() {
     if (pipeline && gStreamerIsRunning) {
-        (*logger) << "[GStreamerPlugin]::Resume() Resuming playback..." << std::endl;
-        gst_element_set_state(pipeline, GST_STATE_PLAYING);
+        APX_LOG_INFO(logger, logCategory) << "[GStreamerPlugin]::Resume() Resuming playback..." << std::endl;
+        if (!seekPending) {
+            gst_element_set_state(pipeline, GST_STATE_PLAYING);  // Otherwise after the seek
+        }
+        paused = false;
     }
 }
 
@@ -171,15 +270,15 @@ void GStreamerPlugin::GStreamerMainLoop() {
     GstMessage* msg;
 
     while (gStreamerIsRunning) {
-        (*logger) << "[GStreamerPlugin]::GStreamerMainLoop() Waiting for messages..." << std::endl;
+        APX_LOG_TRACE(logger, logCategory) << "[GStreamerPlugin]::GStreamerMainLoop() Waiting for messages..." << std::endl;
         msg = gst_bus_timed_pop_filtered(bus, GST_SECOND, static_cast<GstMessageType>(GST_MESSAGE_ERROR | GST_MESSAGE_EOS | GST_MESSAGE_STATE_CHANGED | GST_MESSAGE_APPLICATION));
 
         if (msg != nullptr) {
-            (*logger) << "[GStreamerPlugin]::GStreamerMainLoop() Message received: " << GST_MESSAGE_TYPE_NAME(msg) << std::endl;
+            APX_LOG_TRACE(logger, logCategory) << "[GStreamerPlugin]::GStreamerMainLoop() Message received: " << GST_MESSAGE_TYPE_NAME(msg) << std::endl;
 
             // 🔥 Ha a shutdown üzenetet kapjuk, kilépünk a loopból!
             if (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_APPLICATION) {
-                (*logger) << "[GStreamerPlugin]::GStreamerMainLoop() Shutdown message received, exiting..." << std::endl;
+                APX_LOG_DEBUG(logger, logCategory) << "[GStreamerPlugin]::GStreamerMainLoop() Shutdown message received, exiting..." << std::endl;
                 gst_message_unref(msg);
                 break;
             }
@@ -187,17 +286,17 @@ void GStreamerPlugin::GStreamerMainLoop() {
             OnBusMessage(bus, msg, this);
             gst_message_unref(msg);
         } else {
-            (*logger) << "[GStreamerPlugin]::GStreamerMainLoop() Timeout, checking running flag..." << std::endl;
+            APX_LOG_TRACE(logger, logCategory) << "[GStreamerPlugin]::GStreamerMainLoop() Timeout, checking running flag..." << std::endl;
         }
 
         if (!gStreamerIsRunning) {
-            (*logger) << "[GStreamerPlugin]::GStreamerMainLoop() Exiting loop..." << std::endl;
+            APX_LOG_DEBUG(logger, logCategory) << "[GStreamerPlugin]::GStreamerMainLoop() Exiting loop..." << std::endl;
             break;
         }
     }
 
     gst_object_unref(bus);
-    (*logger) << "[GStreamerPlugin]::GStreamerMainLoop() Exiting..." << std::endl;
+    APX_LOG_DEBUG(logger, logCategory) << "[GStreamerPlugin]::GStreamerMainLoop() Exiting..." << std::endl;
     
 }
 
@@ -206,19 +305,19 @@ void GStreamerPlugin::OnBusMessage(GstBus* bus, GstMessage* msg, gpointer data)
 
     switch (GST_MESSAGE_TYPE(msg)) {
         case GST_MESSAGE_EOS:
-            (*plugin->logger) << "[GStreamerPlugin]::OnBusMessage End of stream reached!" << std::endl;
-            plugin->Stop();
-            // plugin->eventService->Trigger("PlaybackFinished", "Playback completed successfully");
+            APX_LOG_INFO(plugin->logger, plugin->logCategory) << "[GStreamerPlugin]::OnBusMessage End of stream reached!" << std::endl;
+            plugin->post([plugin] { plugin->Stop(); });  // Not from the bus thread, next to the commands
+            // plugin->eventService->Trigger("playback/finished", "Playback completed successfully");
             break;
         case GST_MESSAGE_ERROR: {
             GError* err;
             gchar* debug;
             gst_message_parse_error(msg, &err, &debug);
-            (*plugin->logger) << "[GStreamerPlugin]::OnBusMessage Error: " << err->message << std::endl;
-            // (*plugin->eventService).Trigger("PlaybackError", err->message);
+            APX_LOG_ERROR(plugin->logger, plugin->logCategory) << "[GStreamerPlugin]::OnBusMessage Error: " << err->message << std::endl;
+            // (*plugin->eventService).Trigger("playback/error", err->message);
             g_error_free(err);
             g_free(debug);
-            plugin->Stop();
+            plugin->post([plugin] { plugin->Stop(); });
             break;
         }
         // case GST_MESSAGE_STATE_CHANGED: {
@@ -228,7 +327,7 @@ void GStreamerPlugin::OnBusMessage(GstBus* bus, GstMessage* msg, gpointer data)
         //         gst_message_parse_state_changed(msg, &old_state, &new_state, &pending);
 
         //         // Log state change
-        //         (*plugin->logger) << "[GStreamerPlugin] State changed from "
+        //         APX_LOG_INFO(plugin->logger, plugin->logCategory) << "[GStreamerPlugin] State changed from "
         //                           << gst_element_state_get_name(old_state) << " to "
         //                           << gst_element_state_get_name(new_state) << std::endl;
 
@@ -236,7 +335,7 @@ void GStreamerPlugin::OnBusMessage(GstBus* bus, GstMessage* msg, gpointer data)
         //         std::string stateChangeEvent = "StateChanged_" + std::string(gst_element_state_get_name(new_state));
         //         std::string stateTransition = std::string(gst_element_state_get_name(old_state)) +
         //                                       " → " + std::string(gst_element_state_get_name(new_state));
-        //         plugin->eventService->Trigger("PlaybackStateChanged", stateTransition);
+        //         plugin->eventService->Trigger("playback/state", stateTransition);
         //     }
         //     break;
         // }
@@ -5,15 +5,17 @@
 #include "core/plugin/Plugin.h"
 #include "interfaces/IEventService.h"
 #include "interfaces/ILoggerService.h"
+#include "interfaces/IExecutorService.h"
 #include <string>
 #include <thread>
+#include <vector>
 #include <atomic>
 #include <fruit/fruit.h>
 #include <gst/gst.h>
 
 class GStreamerPlugin : public Plugin {
 public:
-    INJECT(GStreamerPlugin(IEventService* eventService, ILoggerService* logger));
+    INJECT(GStreamerPlugin(IEventService* eventService, ILoggerService* logger, IExecutorService* executor));
     ~GStreamerPlugin() override;
 
     void Init() override;
@@ -22,8 +24,13 @@ public:
     
     std::string GetName() const override;
     std::thread::id GetThreadId() const override;
+    std::vector<std::string> GetProvides() const override;
 
-    void Play(const std::string& uri);  // Play a file or URL
+    // Hands the playing URI, position and pause state over to a reloaded instance
+    std::string SerializeState() const override;
+    void RestoreState(const std::string& state) override;
+
+    void Play(const std::string& uri, gint64 startPosition = 0, bool startPaused = false);  // Play a file or URL
     void Stop(bool force = false);  // Stop the current playback
     void Pause();  // Pause the current playback
     void Resume();  // Resume the current playback
@@ -33,6 +40,18 @@ private:
     std::atomic<bool> gStreamerIsRunning;
     std::thread gstThread;
 
+    std::string currentUri;  // Empty when stopped
+    bool paused = false;
+    bool seekPending = false;  // Prerolling for the start position; Pause() and Resume() only set paused
+    std::string handoverState;  // Captured by Destroy() before the pipeline goes away
+    std::string restoredUri;    // From RestoreState(), played once Init() has set GStreamer up
+    gint64 restoredPosition = 0;
+    bool restoredPaused = false;
+
+    IEventService::TopicId playbackStartedTopic;
+    IEventService::TopicId playbackStoppedTopic;
+    IEventService::TopicId playbackPositionTopic;
+
     static void OnBusMessage(GstBus* bus, GstMessage* msg, gpointer data);
     void GStreamerMainLoop();
 };
@@ -1,11 +1,14 @@
 #include "MyPlugin.h"
 #include <iostream>
 
-MyPlugin::MyPlugin(IEventService* eventService, ILoggerService* logger)
-    : Plugin(eventService, logger) {}
+MyPlugin::MyPlugin(IEventService* eventService, ILoggerService* logger, IExecutorService* executor)
+    : Plugin(eventService, logger, executor), onUpdateTopic(eventService->RegisterTopic("OnUpdate")) {
+    eventService->SetTopicPriority(onUpdateTopic, EventPriority::Bulk);
+    eventService->SetTopicPolicy(onUpdateTopic, DeliveryPolicy::CoalesceLatest);  // Only the latest tick matters
+}
 
 MyPlugin::~MyPlugin() {
-    (*logger) << "[MyPlugin] Destructor called." << std::endl;
+    APX_LOG_DEBUG(logger, logCategory) << "[MyPlugin] Destructor called." << std::endl;
 }
 
 std::string MyPlugin::GetName() const {
@@ -18,28 +21,30 @@ std::thread::id MyPlugin::GetThreadId() const {
 
 void MyPlugin::Init() {
     Plugin::Init();  // call base class method to start event listener thread
-    (*logger) << "[MyPlugin]::Init() Initialized." << std::endl;
+    APX_LOG_INFO(logger, logCategory) << "[MyPlugin]::Init() Initialized." << std::endl;
 
     subscribe("OnStart", [this](const std::string& param) {
-        (*logger) << "[MyPlugin]::Init() Handling OnStart event, param: " << param << std::endl;
+        APX_LOG_INFO(logger, logCategory) << "[MyPlugin]::Init() Handling OnStart event, param: " << param << std::endl;
     });
 
     subscribe("CustomEvent", [this](const std::string& param) {
-        (*logger) << "[MyPlugin]::Init() Handling CustomEvent, param: " << param << std::endl;
+        APX_LOG_DEBUG(logger, logCategory) << "[MyPlugin]::Init() Handling CustomEvent, param: " << param << std::endl;
     });
 }
 
 void MyPlugin::Run() {
-    running = true;
-    (*logger) << "[MyPlugin]::Run() Running on thread ID: " << GetThreadId() << std::endl;
-    while (running) {
-        eventService->Trigger("OnUpdate");
-        std::this_thread::sleep_for(std::chrono::seconds(1)); // simulate work
-    }
-    (*logger) << "[MyPlugin]::Run() Stopped." << std::endl;
+    APX_LOG_INFO(logger, logCategory) << "[MyPlugin]::Run() Running on thread ID: " << GetThreadId() << std::endl;
 }
 
-void MyPlugin::Destroy() {
-    running = false;
-    Plugin::Destroy();
+bool MyPlugin::WantsUpdate() const {
+    return true;
+}
+
+void MyPlugin::Update(std::chrono::nanoseconds deltaTime) {
+    // The frame clock calls us every frame; OnUpdate stays a once-a-second event
+    sinceUpdate += deltaTime;
+    if (sinceUpdate >= std::chrono::seconds(1)) {
+        sinceUpdate %= std::chrono::seconds(1);
+        eventService->Trigger(onUpdateTopic);
+    }
 }
@@ -5,23 +5,27 @@
 #include "core/plugin/Plugin.h"
 #include "interfaces/IEventService.h"
 #include "interfaces/ILoggerService.h"
+#include "interfaces/IExecutorService.h"
 #include <memory>
 #include <atomic>
 #include <fruit/fruit.h>
 
 class MyPlugin : public Plugin {
 public:
-    INJECT(MyPlugin(IEventService* eventService, ILoggerService* logger));
+    INJECT(MyPlugin(IEventService* eventService, ILoggerService* logger, IExecutorService* executor));
     ~MyPlugin() override;
 
     void Init() override;
     void Run() override;
-    void Destroy() override;
+    bool WantsUpdate() const override;
+    void Update(std::chrono::nanoseconds deltaTime) override;
 
     std::string GetName() const override;
     std::thread::id GetThreadId() const override;
 
 private:
+    IEventService::TopicId onUpdateTopic;
+    std::chrono::nanoseconds sinceUpdate{0};  // Only touched by Update(), which the mailbox serializes
 };
 
 #endif // MYPLUGIN_H
@@ -0,0 +1,126 @@
+#include "TestCheck.h"
+#include "event/EventService.h"
+#include "logger/LoggerService.h"
+
+// std
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Delivery policies of EventService topics
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// A stuck subscriber must not block the publisher; once it moves again it sees the newest maxPending events in order
+void DropOldestNeverBlocks(ILoggerService* logger) {
+    EventService eventService(logger);
+    auto topic = eventService.RegisterTopic("Test/DropOldest");
+    auto other = eventService.RegisterTopic("Test/Other");
+    const size_t maxPending = 16;
+    eventService.SetTopicPolicy(topic, DeliveryPolicy::DropOldest, maxPending);
+
+    std::atomic<bool> stuck{true};
+    std::atomic<bool> entered{false};
+    std::mutex mutex;
+    std::vector<int> received;
+    eventService.Subscribe(topic, [&](const std::string& payload) {
+        entered = true;
+        while (stuck) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        received.push_back(std::stoi(payload));
+    });
+    std::atomic<int> others{0};
+    eventService.Subscribe(other, [&](const std::string&) { ++others; });
+    eventService.Start(1);
+
+    // Far more than a lane holds; every Trigger() has to return without the subscriber making progress
+    const int published = 200000;
+    eventService.Trigger(topic, "0");
+    APX_CHECK(test::WaitFor([&] { return entered.load(); }));
+    auto start = Clock::now();
+    for (int i = 1; i < published; ++i) {
+        eventService.Trigger(topic, std::to_string(i));
+    }
+    APX_CHECK(Clock::now() - start < std::chrono::seconds(5));
+    APX_CHECK(eventService.GetTopicStats(topic).pending == maxPending);
+
+    stuck = false;
+    // The shared lane holds one token for the topic, other topics flow behind it
+    eventService.Trigger(other, "x");
+    APX_CHECK(test::WaitFor([&] { return others.load() == 1; }));
+    APX_CHECK(test::WaitFor([&] {
+        std::lock_guard<std::mutex> lock(mutex);
+        return received.size() == maxPending + 1;
+    }));
+
+    eventService.Stop();
+    EventTopicStats stats = eventService.GetTopicStats(topic);
+    std::lock_guard<std::mutex> lock(mutex);
+    APX_CHECK(received.size() + stats.dropped == static_cast<size_t>(published));
+    APX_CHECK(stats.pending == 0);
+    APX_CHECK(!received.empty() && received.front() == 0);
+    for (size_t i = 1; i < received.size(); ++i) {
+        APX_CHECK(received[i] == published - static_cast<int>(received.size() - i));
+    }
+}
+
+// A stuck subscriber of a CoalesceLatest topic gets the newest payload once it moves again, nothing in between
+void CoalesceLatestKeepsNewest(ILoggerService* logger) {
+    EventService eventService(logger);
+    auto topic = eventService.RegisterTopic("Test/Coalesce");
+    eventService.SetTopicPolicy(topic, DeliveryPolicy::CoalesceLatest);
+
+    std::atomic<bool> stuck{true};
+    std::atomic<bool> entered{false};
+    std::mutex mutex;
+    std::vector<int> received;
+    eventService.Subscribe(topic, [&](const std::string& payload) {
+        entered = true;
+        while (stuck) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        received.push_back(std::stoi(payload));
+    });
+    eventService.Start(1);
+
+    const int published = 10000;
+    eventService.Trigger(topic, "0");
+    APX_CHECK(test::WaitFor([&] { return entered.load(); }));
+    for (int i = 1; i < published; ++i) {
+        eventService.Trigger(topic, std::to_string(i));
+    }
+    APX_CHECK(eventService.GetTopicStats(topic).pending == 1);
+
+    stuck = false;
+    APX_CHECK(test::WaitFor([&] {
+        std::lock_guard<std::mutex> lock(mutex);
+        return received.size() == 2;
+    }));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    eventService.Stop();
+    EventTopicStats stats = eventService.GetTopicStats(topic);
+    std::lock_guard<std::mutex> lock(mutex);
+    APX_CHECK(received.size() == 2);
+    APX_CHECK(!received.empty() && received.back() == published - 1);
+    APX_CHECK(stats.coalesced == static_cast<uint64_t>(published - 2));
+    APX_CHECK(stats.pending == 0);
+}
+
+}  // namespace
+
+int main() {
+    LoggerService logger;
+    logger.SetLevel(LogLevel::Warning);
+
+    DropOldestNeverBlocks(&logger);
+    CoalesceLatestKeepsNewest(&logger);
+    return test::Result("EventPolicyTest");
+}
@@ -0,0 +1,189 @@
+#include "TestCheck.h"
+#include "config/ConfigService.h"
+#include "event/EventService.h"
+#include "executor/ExecutorService.h"
+#include "logger/LoggerService.h"
+#include "plugin/PluginService.h"
+
+// std
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Dependency graph and reload of PluginService
+
+namespace {
+
+// Records the order of Init() calls; declares whatever the test asks for
+class GraphPlugin : public IPlugin {
+public:
+    GraphPlugin(std::string name, std::vector<std::string>& initOrder, std::mutex& mutex)
+        : name(std::move(name)), initOrder(initOrder), mutex(mutex) {}
+
+    void Init() override {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            initOrder.push_back(name);
+        }
+        if (fails) {
+            throw std::runtime_error("refused");
+        }
+    }
+    void Run() override {}
+    void Destroy() override {}
+
+    std::string GetName() const override { return name; }
+    std::thread::id GetThreadId() const override { return std::this_thread::get_id(); }
+    std::vector<std::string> GetDependencies() const override { return dependsOn; }
+    std::vector<std::string> GetProvides() const override { return provided; }
+    std::vector<std::string> GetRequires() const override { return required; }
+
+    std::vector<std::string> dependsOn;
+    std::vector<std::string> provided;
+    std::vector<std::string> required;
+    bool fails = false;
+
+private:
+    std::string name;
+    std::vector<std::string>& initOrder;
+    std::mutex& mutex;
+};
+
+const PluginStartupTiming* Find(const std::vector<PluginStartupTiming>& report, const std::string& name) {
+    auto it = std::find_if(report.begin(), report.end(), [&](const PluginStartupTiming& timing) { return timing.name == name; });
+    return it == report.end() ? nullptr : &*it;
+}
+
+size_t Position(const std::vector<std::string>& order, const std::string& name) {
+    return static_cast<size_t>(std::find(order.begin(), order.end(), name) - order.begin());
+}
+
+// Init() follows dependencies and capabilities; cycles, missing and failed dependencies skip their dependents
+void DependencyGraph(ConfigService* config, ILoggerService* logger) {
+    ExecutorService executor(logger, config);
+    EventService eventService(logger, config);
+    eventService.Start();
+
+    std::vector<std::string> initOrder;
+    std::mutex mutex;
+    {
+        PluginService pluginService(&eventService, logger, &executor, config);
+        auto add = [&](const std::string& name) {
+            auto plugin = std::make_shared<GraphPlugin>(name, initOrder, mutex);
+            pluginService.RegisterPlugin(plugin);
+            return plugin;
+        };
+        add("C")->dependsOn = {"B"};
+        add("B")->dependsOn = {"A"};
+        add("A")->provided = {"storage"};
+        add("D")->required = {"storage"};
+        add("X")->dependsOn = {"Y"};
+        add("Y")->dependsOn = {"X"};
+        add("Z")->dependsOn = {"X"};
+        add("M")->dependsOn = {"Nowhere"};
+        add("F")->fails = true;
+        add("G")->dependsOn = {"F"};
+
+        pluginService.InitPlugins();
+        auto report = pluginService.GetStartupReport();
+        std::lock_guard<std::mutex> lock(mutex);
+
+        APX_CHECK(initOrder.size() == 5);
+        APX_CHECK(Position(initOrder, "A") < Position(initOrder, "B"));
+        APX_CHECK(Position(initOrder, "B") < Position(initOrder, "C"));
+        APX_CHECK(Position(initOrder, "A") < Position(initOrder, "D"));
+        APX_CHECK(Position(initOrder, "F") < initOrder.size());
+
+        for (const char* name : {"A", "B", "C", "D"}) {
+            const PluginStartupTiming* timing = Find(report, name);
+            APX_CHECK(timing != nullptr && timing->initialized && timing->error.empty());
+        }
+        APX_CHECK(Find(report, "A")->wave == 0);
+        APX_CHECK(Find(report, "B")->wave == 1);
+        APX_CHECK(Find(report, "C")->wave == 2);
+        APX_CHECK(Find(report, "D")->wave == 1);
+
+        for (const char* name : {"X", "Y", "Z"}) {
+            const PluginStartupTiming* timing = Find(report, name);
+            APX_CHECK(timing != nullptr && !timing->initialized && timing->error == "dependency cycle");
+        }
+        const PluginStartupTiming* missing = Find(report, "M");
+        APX_CHECK(missing != nullptr && !missing->initialized && missing->error == "missing dependency Nowhere");
+        const PluginStartupTiming* failed = Find(report, "F");
+        APX_CHECK(failed != nullptr && !failed->initialized && failed->error == "refused");
+        const PluginStartupTiming* skipped = Find(report, "G");
+        APX_CHECK(skipped != nullptr && !skipped->initialized && skipped->error == "dependency F not initialized");
+
+        pluginService.StopPlugins();
+    }
+    eventService.Stop();
+    executor.Stop();
+}
+
+// A reloaded plugin gets the state of the instance it replaces before its Init(), and keeps counting from there
+void ReloadHandsOverState(ConfigService* config, ILoggerService* logger) {
+    ExecutorService executor(logger, config);
+    EventService eventService(logger, config);
+    eventService.Start();
+
+    std::mutex mutex;
+    std::vector<std::string> ready;
+    std::string counted;
+    eventService.Subscribe("test/ready", [&](const std::string& payload) {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready.push_back(payload);
+    });
+    eventService.Subscribe("test/counted", [&](const std::string& payload) {
+        std::lock_guard<std::mutex> lock(mutex);
+        counted = payload;
+    });
+    auto countedIs = [&](const std::string& value) {
+        return test::WaitFor([&] {
+            std::lock_guard<std::mutex> lock(mutex);
+            return counted == value;
+        });
+    };
+    {
+        PluginService pluginService(&eventService, logger, &executor, config);
+        APX_CHECK(pluginService.LoadPlugins(APERTUS_TEST_PLUGIN_DIR) == 1);
+        pluginService.InitPlugins();
+
+        auto countTopic = eventService.RegisterTopic("test/count");
+        for (int i = 0; i < 5; ++i) {
+            eventService.Trigger(countTopic);
+        }
+        APX_CHECK(countedIs("5"));
+
+        APX_CHECK(pluginService.ReloadPlugin("TestCounterPlugin"));
+        eventService.Trigger(countTopic);
+        APX_CHECK(countedIs("6"));
+        APX_CHECK(test::WaitFor([&] {
+            std::lock_guard<std::mutex> lock(mutex);
+            return ready.size() == 2;
+        }));
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            APX_CHECK(ready.size() == 2 && ready[0] == "0" && ready[1] == "5");
+        }
+
+        pluginService.StopPlugins();
+    }
+    eventService.Stop();
+    executor.Stop();
+}
+
+}  // namespace
+
+int main() {
+    ConfigService config;
+    LoggerService logger(&config);
+    logger.SetLevel(LogLevel::Warning);
+
+    DependencyGraph(&config, &logger);
+    ReloadHandsOverState(&config, &logger);
+
+    return test::Result("PluginServiceTest");
+}
@@ -0,0 +1,126 @@
+#include "TestCheck.h"
+#include "ipc/SharedRing.h"
+
+// std
+#include <cstring>
+#include <string>
+#include <vector>
+
+// SharedRing, within one process; the reader checks everything the other side wrote
+
+namespace {
+
+constexpr size_t kCapacity = 4096;
+
+// Stands in for the shared memory, aligned like a mapping
+struct alignas(64) Block {
+    char bytes[64];
+};
+
+struct Region {
+    Region() : blocks((SharedRing::RegionSize(kCapacity) + sizeof(Block) - 1) / sizeof(Block)) {}
+
+    void* Memory() { return blocks.data(); }
+    char* Data() { return reinterpret_cast<char*>(blocks.data()) + SharedRing::RegionSize(kCapacity) - kCapacity; }
+
+    std::vector<Block> blocks;
+};
+
+SharedRing::Message Text(uint16_t type, const std::string& text) {
+    SharedRing::Message message;
+    message.type = type;
+    message.data = text.data();
+    message.size = text.size();
+    return message;
+}
+
+// Messages arrive whole and in order, also across many wraps of the ring with records that do not fit at its end
+void RoundTrip() {
+    Region region;
+    SharedRing writer(region.Memory(), kCapacity, true);
+    SharedRing reader(region.Memory(), kCapacity, false);
+
+    for (int i = 0; i < 2000; ++i) {
+        std::string text(static_cast<size_t>(i % 300), static_cast<char>('a' + i % 26));
+        SharedRing::Message message = Text(1, text);
+        message.flags = static_cast<uint16_t>(i);
+        message.topic = static_cast<uint32_t>(i * 7);
+        message.value = static_cast<uint64_t>(i) << 40;
+        APX_CHECK(writer.Write(message, std::chrono::milliseconds(0)));
+
+        SharedRing::Message read;
+        APX_CHECK(reader.TryRead(read));
+        APX_CHECK(read.type == 1 && read.flags == message.flags && read.topic == message.topic && read.value == message.value);
+        APX_CHECK(std::string(read.data, read.size) == text);
+        reader.Release();
+    }
+    SharedRing::Message read;
+    APX_CHECK(!reader.TryRead(read));
+    APX_CHECK(reader.Used() == 0);
+    APX_CHECK(!reader.Corrupt());
+}
+
+// A full ring drops the message after the timeout; one larger than half the ring is never written
+void WriteLimits() {
+    Region region;
+    SharedRing writer(region.Memory(), kCapacity, true);
+
+    std::string large(kCapacity / 2, 'x');
+    APX_CHECK(!writer.Write(Text(1, large), std::chrono::milliseconds(0)));
+
+    std::string text(1000, 'y');
+    int written = 0;
+    while (writer.Write(Text(1, text), std::chrono::milliseconds(10))) {
+        ++written;
+    }
+    APX_CHECK(written == 4);
+    APX_CHECK(writer.Used() <= kCapacity);
+}
+
+// A record claiming more bytes than were written closes the ring for good
+void OversizedRecordIsCorrupt() {
+    Region region;
+    SharedRing writer(region.Memory(), kCapacity, true);
+    SharedRing reader(region.Memory(), kCapacity, false);
+
+    APX_CHECK(writer.Write(Text(1, "hello"), std::chrono::milliseconds(0)));
+    uint32_t size = 1u << 20;
+    std::memcpy(region.Data(), &size, sizeof(size));  // The size field of the first record
+
+    SharedRing::Message read;
+    APX_CHECK(!reader.TryRead(read));
+    APX_CHECK(reader.Corrupt());
+    APX_CHECK(reader.Closed());
+    APX_CHECK(!writer.Write(Text(1, "again"), std::chrono::milliseconds(0)));
+    APX_CHECK(!reader.TryRead(read));
+}
+
+// A record of a type the reader does not know is corrupt as well; the ones before it still arrive
+void UnknownTypeIsCorrupt() {
+    Region region;
+    const uint16_t lastType = 3;
+    SharedRing writer(region.Memory(), kCapacity, true);
+    SharedRing reader(region.Memory(), kCapacity, false, lastType);
+
+    APX_CHECK(writer.Write(Text(lastType, "known"), std::chrono::milliseconds(0)));
+    APX_CHECK(writer.Write(Text(lastType + 1, "unknown"), std::chrono::milliseconds(0)));
+
+    SharedRing::Message read;
+    APX_CHECK(reader.TryRead(read));
+    APX_CHECK(std::string(read.data, read.size) == "known");
+    reader.Release();
+    APX_CHECK(!reader.TryRead(read));
+    APX_CHECK(reader.Corrupt());
+    APX_CHECK(reader.Closed());
+}
+
+}  // namespace
+
+int main() {
+    RoundTrip();
+    WriteLimits();
+    OversizedRecordIsCorrupt();
+    UnknownTypeIsCorrupt();
+
+    return test::Result("SharedRingTest");
+}
@@ -0,0 +1,49 @@
+#ifndef TESTCHECK_H
+#define TESTCHECK_H
+
+// std
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <thread>
+
+// Minimal checks for the behavior tests: report every failure, exit non-zero at the end
+namespace test {
+
+inline int& Failures() {
+    static int failures = 0;
+    return failures;
+}
+
+/** @brief Polls condition until it holds or timeout passes; returns its last value. */
+inline bool WaitFor(const std::function<bool()>& condition, std::chrono::milliseconds timeout = std::chrono::seconds(5)) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!condition()) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return condition();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+inline int Result(const char* name) {
+    if (Failures() == 0) {
+        std::cout << "[" << name << "] passed" << std::endl;
+        return 0;
+    }
+    std::cout << "[" << name << "] " << Failures() << " check(s) failed" << std::endl;
+    return 1;
+}
+
+}  // namespace test
+
+#define APX_CHECK(condition)                                                                          \
+    do {                                                                                              \
+        if (!(condition)) {                                                                           \
+            std::cout << __FILE__ << ":" << __LINE__ << ": check failed: " #condition << std::endl;   \
+            ++test::Failures();                                                                       \
+        }                                                                                             \
+    } while (false)
+
+#endif // TESTCHECK_H
@@ -0,0 +1,37 @@
+#include "core/plugin/Plugin.h"
+#include "interfaces/PluginApi.h"
+
+// std
+#include <atomic>
+#include <string>
+
+// Counts test/count events and hands the count to its reloaded instance; loaded by PluginServiceTest
+class TestCounterPlugin : public Plugin {
+public:
+    TestCounterPlugin(IEventService* eventService, ILoggerService* logger, IExecutorService* executor)
+        : Plugin(eventService, logger, executor),
+          countedTopic(eventService->RegisterTopic("test/counted")),
+          readyTopic(eventService->RegisterTopic("test/ready")) {}
+
+    void Init() override {
+        Plugin::Init();
+        // Published before any test/count reaches this instance: the state has to be here already
+        eventService->Trigger(readyTopic, std::to_string(count.load()));
+        subscribe("test/count", [this](const std::string&) {
+            eventService->Trigger(countedTopic, std::to_string(++count));
+        });
+    }
+
+    std::string GetName() const override { return "TestCounterPlugin"; }
+    std::thread::id GetThreadId() const override { return std::this_thread::get_id(); }
+
+    std::string SerializeState() const override { return std::to_string(count.load()); }
+    void RestoreState(const std::string& state) override { count = std::stoi(state); }
+
+private:
+    IEventService::TopicId countedTopic;
+    IEventService::TopicId readyTopic;
+    std::atomic<int> count{0};
+};
+
+APERTUS_PLUGIN(TestCounterPlugin, "TestCounterPlugin")
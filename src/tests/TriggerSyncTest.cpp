@@ -0,0 +1,134 @@
+#include "TestCheck.h"
+#include "event/EventService.h"
+#include "logger/LoggerService.h"
+
+// std
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+// TriggerSync() and inline subscribers
+
+namespace {
+
+// Every TriggerSync() reaches each inline and each queued subscriber exactly once
+void InlineAndQueuedRunOnce(ILoggerService* logger, DeliveryPolicy policy) {
+    EventService eventService(logger);
+    auto topic = eventService.RegisterTopic("Test/Sync");
+    eventService.SetTopicPolicy(topic, policy);
+
+    std::atomic<int> inlined{0};
+    std::atomic<int> queued{0};
+    const auto caller = std::this_thread::get_id();
+    std::atomic<bool> onCaller{true};
+    eventService.SubscribeInline(topic, [&](const std::string&) {
+        onCaller = onCaller && std::this_thread::get_id() == caller;
+        ++inlined;
+    });
+    eventService.Subscribe(topic, [&](const std::string&) { ++queued; });
+    eventService.Start(2);
+
+    const int published = 1000;
+    for (int i = 0; i < published; ++i) {
+        eventService.TriggerSync(topic, std::to_string(i));
+        APX_CHECK(inlined.load() == i + 1);
+    }
+    APX_CHECK(onCaller.load());
+    if (policy == DeliveryPolicy::CoalesceLatest) {
+        APX_CHECK(test::WaitFor([&] {
+            EventTopicStats stats = eventService.GetTopicStats(topic);
+            return stats.pending == 0 && queued.load() + static_cast<int>(stats.coalesced) == published;
+        }));
+    } else {
+        APX_CHECK(test::WaitFor([&] { return queued.load() == published; }));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    APX_CHECK(inlined.load() == published);
+
+    eventService.Stop();
+}
+
+// An inline subscriber publishing its own topic again nests only up to kMaxInlineDepth, then goes through the queue
+void ReentrantTriggerSyncIsBounded(ILoggerService* logger) {
+    EventService eventService(logger);
+    auto topic = eventService.RegisterTopic("Test/Reentrant");
+
+    const int published = 100;
+    std::atomic<int> handled{0};
+    std::atomic<int> maxDepth{0};
+    int callerDepth = 0;  // Deepest nesting on this thread
+    const auto caller = std::this_thread::get_id();
+    thread_local int depth = 0;
+    eventService.SubscribeInline(topic, [&](const std::string&) {
+        ++depth;
+        if (std::this_thread::get_id() == caller) {
+            callerDepth = std::max(callerDepth, depth);
+        }
+        int deepest = maxDepth.load();
+        while (depth > deepest && !maxDepth.compare_exchange_weak(deepest, depth)) {
+        }
+        if (++handled < published) {
+            eventService.TriggerSync(topic);
+        }
+        --depth;
+    });
+    eventService.Start(1);
+
+    eventService.TriggerSync(topic);
+    APX_CHECK(test::WaitFor([&] { return handled.load() == published; }));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    APX_CHECK(handled.load() == published);
+    APX_CHECK(callerDepth == EventService::kMaxInlineDepth);
+    // A dispatcher runs the inline subscriber of a queued event, which may nest as deep again
+    APX_CHECK(maxDepth.load() <= EventService::kMaxInlineDepth + 1);
+
+    eventService.Stop();
+}
+
+// Subscribing and unsubscribing inline callbacks while other threads publish is safe
+void SubscribeWhilePublishing(ILoggerService* logger) {
+    EventService eventService(logger);
+    auto topic = eventService.RegisterTopic("Test/Churn");
+
+    std::atomic<int> stable{0};
+    std::atomic<int> churned{0};
+    eventService.SubscribeInline(topic, [&](const std::string&) { ++stable; });
+    eventService.Start(2);
+
+    const int publishers = 4;
+    const int perPublisher = 5000;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < publishers; ++i) {
+        threads.emplace_back([&] {
+            for (int n = 0; n < perPublisher; ++n) {
+                eventService.TriggerSync(topic);
+            }
+        });
+    }
+    for (int i = 0; i < 100; ++i) {
+        auto subscription = eventService.SubscribeInline(topic, [&](const std::string&) { ++churned; });
+        eventService.Unsubscribe(subscription);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    APX_CHECK(stable.load() == publishers * perPublisher);
+    eventService.Stop();
+}
+
+}  // namespace
+
+int main() {
+    LoggerService logger;
+    logger.SetLevel(LogLevel::Warning);
+
+    InlineAndQueuedRunOnce(&logger, DeliveryPolicy::Block);
+    InlineAndQueuedRunOnce(&logger, DeliveryPolicy::CoalesceLatest);
+    ReentrantTriggerSyncIsBounded(&logger);
+    SubscribeWhilePublishing(&logger);
+
+    return test::Result("TriggerSyncTest");
+}